@@ -0,0 +1,182 @@
+#define _GNU_SOURCE
+#include "defs.h"
+#include <sched.h>
+#include <sys/syscall.h>
+
+/*
+    Agent threads can be pinned to cores in one of two orders built from the sysfs topology:
+    compact fills every hardware thread of a core, then the next core, then the next package,
+    scatter spreads consecutive agents over packages first, then cores, then hardware threads.
+    With NUMA local placement each agent's state gets pages of its own, which the agent moves
+    to its local node once it is pinned.
+*/
+
+#define MPOL_MF_MOVE (1 << 1)
+
+typedef struct {
+    int cpu;                        // logical cpu number
+    int package;                    // physical package (socket) of the cpu
+    int core;                       // dense rank of the core within its package
+    int smt;                        // rank of the cpu among the hardware threads of its core
+} CpuInfo;
+
+static enum AffinityMode affinityMode = AF_NONE;
+static int numaLocal = C_FALSE;
+static int cpuOrder[CPU_SETSIZE];
+static int cpuCount = 0;
+
+/*
+    Reads a single integer from the topology file 'name' of cpu 'cpu', returns 0 if missing.
+*/
+static int readTopology(int cpu, char* name) {
+    char path[MAX_STR * 2];
+    int value = 0;
+    FILE* file;
+
+    sprintf(path, "/sys/devices/system/cpu/cpu%d/topology/%s", cpu, name);
+    file = fopen(path, "r");
+    if (file != NULL) {
+        if (fscanf(file, "%d", &value) != 1) {
+            value = 0;
+        }
+        fclose(file);
+    }
+    return value;
+}
+
+/*
+    Returns true if cpu 'j' is the lowest numbered cpu of its core.
+*/
+static int firstOfCore(CpuInfo* cpus, int* coreIds, int j) {
+    for (int k = 0; k < j; k++) {
+        if (cpus[k].package == cpus[j].package && coreIds[k] == coreIds[j]) {
+            return C_FALSE;
+        }
+    }
+    return C_TRUE;
+}
+
+/*
+    Orders cpus by package, core and hardware thread.
+*/
+static int compareCompact(const void* a, const void* b) {
+    const CpuInfo* x = a;
+    const CpuInfo* y = b;
+    if (x->package != y->package) return x->package - y->package;
+    if (x->core != y->core) return x->core - y->core;
+    return x->smt - y->smt;
+}
+
+/*
+    Orders cpus by hardware thread, core and package.
+*/
+static int compareScatter(const void* a, const void* b) {
+    const CpuInfo* x = a;
+    const CpuInfo* y = b;
+    if (x->smt != y->smt) return x->smt - y->smt;
+    if (x->core != y->core) return x->core - y->core;
+    return x->package - y->package;
+}
+
+/*  Function: void initAffinity(enum AffinityMode mode, int local)
+    Purpose: Builds the order in which agent threads are pinned to the cpus this process may
+        run on, and records whether agent state should be moved to the agent's NUMA node
+*/
+void initAffinity(enum AffinityMode mode, int local) {
+    CpuInfo cpus[CPU_SETSIZE];
+    int coreIds[CPU_SETSIZE];
+    cpu_set_t set;
+
+    affinityMode = mode;
+    numaLocal = local;
+    cpuCount = 0;
+    if (mode == AF_NONE || sched_getaffinity(0, sizeof(set), &set) != 0) {
+        affinityMode = AF_NONE;
+        return;
+    }
+
+    // Read the topology of every allowed cpu
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &set)) {
+            cpus[cpuCount].cpu = cpu;
+            cpus[cpuCount].package = readTopology(cpu, "physical_package_id");
+            coreIds[cpuCount] = readTopology(cpu, "core_id");
+            cpuCount++;
+        }
+    }
+
+    // Rank each cpu's core among the distinct cores of its package, and the cpu within its core
+    for (int i = 0; i < cpuCount; i++) {
+        cpus[i].core = 0;
+        cpus[i].smt = 0;
+        for (int j = 0; j < cpuCount; j++) {
+            if (cpus[j].package != cpus[i].package) {
+                continue;
+            }
+            if (coreIds[j] == coreIds[i] && j < i) {
+                cpus[i].smt++;
+            }
+            if (coreIds[j] < coreIds[i] && firstOfCore(cpus, coreIds, j)) {
+                cpus[i].core++;
+            }
+        }
+    }
+
+    qsort(cpus, cpuCount, sizeof(CpuInfo), (mode == AF_SCATTER) ? compareScatter : compareCompact);
+    for (int i = 0; i < cpuCount; i++) {
+        cpuOrder[i] = cpus[i].cpu;
+    }
+}
+
+/*  Function: void* allocCacheAligned(size_t size)
+    Purpose: Allocates memory starting on a cache line boundary, padded to whole cache lines
+*/
+void* allocCacheAligned(size_t size) {
+    return aligned_alloc(CACHE_LINE, (size + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE);
+}
+
+/*  Function: void* allocAgent(size_t size)
+    Purpose: Allocates zeroed memory for the state of one agent, padded to whole cache lines
+        so no two agents share a line, or to whole pages when agents move their state to
+        their local NUMA node
+*/
+void* allocAgent(size_t size) {
+    size_t align = numaLocal ? (size_t) sysconf(_SC_PAGESIZE) : CACHE_LINE;
+    size_t padded = (size + align - 1) / align * align;
+    void* state = aligned_alloc(align, padded);
+
+    memset(state, 0, padded);
+    return state;
+}
+
+/*  Function: void pinAgent(int index, void* state, size_t size)
+    Purpose: Pins the calling agent thread to the cpu at position 'index' of the pinning order,
+        then moves the agent's state at the pointer 'state' to the cpu's NUMA node if requested
+*/
+void pinAgent(int index, void* state, size_t size) {
+    cpu_set_t set;
+    unsigned int cpu, node;
+
+    if (affinityMode == AF_NONE || cpuCount == 0) {
+        return;
+    }
+
+    CPU_ZERO(&set);
+    CPU_SET(cpuOrder[index % cpuCount], &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+
+    // Move every page of the agent's state to the node we now run on
+    if (numaLocal && state != NULL && syscall(SYS_getcpu, &cpu, &node, NULL) == 0) {
+        long page = sysconf(_SC_PAGESIZE);
+        int count = (size + page - 1) / page;
+        void* pages[count];
+        int nodes[count];
+        int status[count];
+
+        for (int i = 0; i < count; i++) {
+            pages[i] = (char*) state + i * page;
+            nodes[i] = node;
+        }
+        syscall(SYS_move_pages, 0, count, pages, nodes, status, MPOL_MF_MOVE);
+    }
+}
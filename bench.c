@@ -0,0 +1,1019 @@
+#include "defs.h"
+
+/*
+    Benchmarks run the simulation's own hot paths with logging off and print one csv row per
+    configuration so results can be compared or plotted.
+
+    contention:  many hunter threads move between the rooms of one house as fast as they can,
+                 once with hunters packed next to each other in a single array (the layout small
+                 separate mallocs tend to produce) and once with each hunter on its own cache lines
+
+    locks:       hunter threads leave and collect evidence in a small house, taking the room and
+                 shared evidence locks every turn, for each lock backend and 1, 2, 4 ... hunters
+
+    proximity:   hunter threads move through a house while keeping the proximity index up to
+                 date, then k-hop hunter counts are queried from the index and, for comparison,
+                 by searching the connection lists
+
+    scaling:     whole simulations run on the threaded engine, with the waits given by
+                 --hunter-wait and --ghost-wait, for 1, 2, 4 ... hunters in a crowded house of
+                 four rooms and in a sparse house of 64 rooms per hunter, reporting agent turns
+                 per second, mean and p99 turn latency and the fraction of turn time spent
+                 waiting for locks
+
+    policy:      the hunter and ghost policies decide for --turns observations per hunter, in
+                 batches of 1, 4, 16 ... observations, reporting the cost of one decision next to
+                 calling the random action functions directly
+
+    lanes:       whole simulations of a roster with one hunter of each equipment, on the
+                 threaded engine with no waits and on the lane engine, reporting runs per
+                 second of cpu time and the fraction the hunters won
+
+    locality:    a house of --rooms rooms (default 1000000) is built in creation order and in a
+                 shuffled order, standing in for a house loaded in no particular order, then
+                 numbered in each room order while hunter threads scattered over it move as in
+                 contention, reporting the average id distance of connected rooms before and
+                 after, the time the reordering took and hunter turns per second
+
+    equivalence: a roster with one hunter of each equipment plays --runs runs (default 400) on
+                 the threaded engine, as configured, and ten times as many on the lane engine.
+                 The outcomes of both are tested for coming from the same game (see stats.c)
+                 and the runs per wall and cpu second of each engine are reported. Exits with
+                 status 1 when a test fails, so a change that alters the game is caught
+
+    shared:      --runs run states (default 16) are set up and held at once on a house of --rooms
+                 rooms (default 100000), each building its own topology and all of them on one
+                 shared topology, reporting the shared bytes, the bytes each run adds and the
+                 setup time per run
+
+    roster:      a bulk roster of --runs hunters (default 1000000), every other one with a start
+                 room and thresholds, is written to a temporary file and loaded, reporting hunters
+                 and megabytes loaded per second
+*/
+
+typedef struct {
+    HunterType*        hunter;      // hunter driven by the thread
+    int                index;       // position of the thread in the pinning order
+    int                turns;       // turns to take
+    int                padded;      // whether the hunter owns its cache lines
+    pthread_barrier_t* start;       // released once every thread is ready
+} BenchAgent;
+
+static volatile long benchSink;     // keeps the results of timed loops from being optimised away
+
+/*
+    Returns the current monotonic time in seconds.
+*/
+static double benchNow(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/*
+    Hunter thread of the contention benchmark, takes moving turns without sleeping and updates
+    fear and boredom like runHunter does.
+*/
+static void* contentionHunter(void* ptr) {
+    BenchAgent* agent = (BenchAgent*) ptr;
+    HunterType* hunter = agent->hunter;
+
+    // Only a hunter that owns its pages can move them to its node
+    pinAgent(agent->index, agent->padded ? hunter : NULL, sizeof(HunterType));
+    seedRandom(mixSeed(agent->index, 0));
+    pthread_barrier_wait(agent->start);
+
+    for (int i = 0; i < agent->turns; i++) {
+        moveHunterRooms(hunter);
+        if (roomHasGhost(hunter->house, hunter->room)) {
+            hunter->fear = (hunter->fear + 1) % FEAR_MAX;
+            hunter->boredom = 0;
+        } else {
+            hunter->boredom++;
+        }
+        hunter->turns++;
+    }
+    return NULL;
+}
+
+/*
+    Hunter thread of the locks benchmark, leaves evidence it can collect in its room like the
+    ghost does and then collects it, moving rooms every eighth turn.
+*/
+static void* lockHunter(void* ptr) {
+    BenchAgent* agent = (BenchAgent*) ptr;
+    HunterType* hunter = agent->hunter;
+
+    pinAgent(agent->index, hunter, sizeof(HunterType));
+    seedRandom(mixSeed(agent->index, 0));
+    pthread_barrier_wait(agent->start);
+
+    for (int i = 0; i < agent->turns; i++) {
+        RoomType* room = hunter->room;
+        EvidenceList* list = evidenceIn(hunter->house, room);
+        acquireLock(&(list->lock));
+        addEvidence(list, hunter->equipment);
+        setRoomEvidence(hunter->house, room, roomEvidence(hunter->house, room) | (1 << hunter->equipment));
+        releaseLock(&(list->lock));
+
+        collectEvidence(hunter);
+        if (i % 8 == 7) {
+            moveHunterRooms(hunter);
+        }
+        hunter->turns++;
+    }
+    return NULL;
+}
+
+/*
+    Counts the hunters within PROXIMITY_HOPS hops of 'room' by a breadth first search over the
+    connection lists, the way a ghost would without the proximity index.
+*/
+static int searchHunters(HouseType* house, RoomId room, uint32_t* seen, uint32_t stamp, RoomId* queue, uint8_t* hops) {
+    uint32_t head = 0, tail = 0;
+    int total = 0;
+
+    seen[room] = stamp;
+    hops[room] = 0;
+    queue[tail++] = room;
+    while (head < tail) {
+        RoomType* current = house->roomById[queue[head++]];
+        total += roomOccupancy(house, current);
+        if (hops[current->id] == PROXIMITY_HOPS) {
+            continue;
+        }
+        for (RoomNode* next = current->connectedRooms.head; next != NULL; next = next->next) {
+            if (seen[next->data->id] != stamp) {
+                seen[next->data->id] = stamp;
+                hops[next->data->id] = hops[current->id] + 1;
+                queue[tail++] = next->data->id;
+            }
+        }
+    }
+    return total;
+}
+
+/*
+    Finds the room nearest 'room' holding evidence of 'type' by a breadth first search over the
+    packed connections, the way a hunter would without the evidence summary. Sets 'hops' to
+    its distance and 'targetHops' to the distance of 'target', searching on until both are found
+    when 'target' is a room. Returns the nearest room, or ROOM_NONE if no room holds the type.
+*/
+static RoomId searchEvidence(HouseType* house, RoomId room, int type, RoomId target, uint32_t* seen, uint32_t stamp,
+    RoomId* queue, uint32_t* dist, uint32_t* hops, uint32_t* targetHops) {
+    RoutingType* routing = house->routing;
+    RoomId nearest = ROOM_NONE;
+    uint32_t head = 0, tail = 0;
+
+    *targetHops = UINT32_MAX;
+    seen[room] = stamp;
+    dist[room] = 0;
+    queue[tail++] = room;
+    while (head < tail) {
+        RoomId current = queue[head++];
+        if (nearest == ROOM_NONE && (roomEvidence(house, house->roomById[current]) >> type) & 1) {
+            nearest = current;
+            *hops = dist[current];
+        }
+        if (current == target) {
+            *targetHops = dist[current];
+        }
+        if (nearest != ROOM_NONE && (target == ROOM_NONE || *targetHops != UINT32_MAX)) {
+            break;
+        }
+        for (uint32_t e = routing->offsets[current]; e < routing->offsets[current + 1]; e++) {
+            RoomId next = routing->neighbors[e];
+            if (seen[next] != stamp) {
+                seen[next] = stamp;
+                dist[next] = dist[current] + 1;
+                queue[tail++] = next;
+            }
+        }
+    }
+    return nearest;
+}
+
+/*
+    Starts one thread per agent running 'agentMain', releases them together and returns the
+    seconds until the last one finished.
+*/
+static double runAgents(BenchAgent* agents, int count, void* (*agentMain)(void*)) {
+    pthread_t* threads = malloc(count * sizeof(pthread_t));
+    pthread_barrier_t start;
+    double begin, elapsed;
+
+    pthread_barrier_init(&start, NULL, count + 1);
+    for (int i = 0; i < count; i++) {
+        agents[i].start = &start;
+        pthread_create(&threads[i], NULL, agentMain, &agents[i]);
+    }
+    begin = benchNow();
+    pthread_barrier_wait(&start);
+    for (int i = 0; i < count; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    elapsed = benchNow() - begin;
+
+    pthread_barrier_destroy(&start);
+    free(threads);
+    return elapsed;
+}
+
+/*
+    Runs the locks benchmark with 'count' hunters and returns critical section turns per second.
+*/
+static double runLocks(OptionsType* options, int count) {
+    HouseType house;
+    GhostType* ghost;
+    BenchAgent* agents = malloc(count * sizeof(BenchAgent));
+    double elapsed;
+
+    // Build the house, the ghost only sits in its room
+    seedRandom(mixSeed(options->seed, 0));
+    initHouse(&house, options->rooms, options->roomOrder);
+    initGhost(&house, &ghost);
+
+    // Give hunters every kind of equipment so they collect in different rooms
+    for (int i = 0; i < count; i++) {
+        agents[i].hunter = allocAgent(sizeof(HunterType));
+        placeHunter(agents[i].hunter, &house, house.rooms.head->data, i % EV_COUNT, "Bench");
+        agents[i].hunter->id = i;
+        agents[i].index = i;
+        agents[i].turns = options->benchTurns;
+        agents[i].padded = C_TRUE;
+    }
+    elapsed = runAgents(agents, count, lockHunter);
+
+    for (int i = 0; i < count; i++) {
+        free(agents[i].hunter);
+    }
+    free(agents);
+    cleanUp(&house);
+
+    return (double) count * options->benchTurns / elapsed;
+}
+
+/*
+    Runs one configuration of the contention benchmark and returns hunter turns per second.
+*/
+static double runContention(OptionsType* options, int padded) {
+    int count = options->benchHunters;
+    HouseType house;
+    GhostType* ghost;
+    HunterType* packed = NULL;
+    BenchAgent* agents = malloc(count * sizeof(BenchAgent));
+    double elapsed;
+
+    // Build the house and put a ghost that never moves in it
+    seedRandom(mixSeed(options->seed, 0));
+    initHouse(&house, options->rooms, options->roomOrder);
+    initGhost(&house, &ghost);
+
+    // Place every hunter in the van, packed back to back or on lines of their own
+    if (!padded) {
+        packed = calloc(count, sizeof(HunterType));
+    }
+    for (int i = 0; i < count; i++) {
+        agents[i].hunter = padded ? allocAgent(sizeof(HunterType)) : &packed[i];
+        placeHunter(agents[i].hunter, &house, house.rooms.head->data, EMF, "Bench");
+        agents[i].hunter->id = i;
+        agents[i].index = i;
+        agents[i].turns = options->benchTurns;
+        agents[i].padded = padded;
+    }
+    elapsed = runAgents(agents, count, contentionHunter);
+
+    // Free the hunters, the house never owned them
+    for (int i = 0; i < count && padded; i++) {
+        free(agents[i].hunter);
+    }
+    free(packed);
+    free(agents);
+    cleanUp(&house);
+
+    return (double) count * options->benchTurns / elapsed;
+}
+
+/*
+    Runs the proximity benchmark, printing build time, indexed moves per second and queries per
+    second from the index and by search. Every query is checked against the search.
+*/
+static void runProximity(OptionsType* options) {
+    int count = options->benchHunters;
+    int queries = options->benchTurns;
+    HouseType house;
+    RoutingType routing;
+    BenchAgent* agents = malloc(count * sizeof(BenchAgent));
+    uint32_t* seen;
+    RoomId* queue;
+    uint8_t* hops;
+    RoomId* rooms = malloc(queries * sizeof(RoomId));
+    double begin, build, moves, indexed, searched;
+    long indexTotal = 0, searchTotal = 0;
+    int mismatches = 0;
+
+    // Build the house, its routing data and neighbourhoods
+    seedRandom(mixSeed(options->seed, 0));
+    initHouse(&house, options->rooms, options->roomOrder);
+    begin = benchNow();
+    buildRouting(&routing, &house);
+    buildNeighborhoods(&routing);
+    build = benchNow() - begin;
+    routing.topology = NULL;                // The house holds its own topology
+    house.routing = &routing;
+    initProximity(&house);
+
+    // Scatter the hunters over the house and let them move, updating the index
+    for (int i = 0; i < count; i++) {
+        agents[i].hunter = allocAgent(sizeof(HunterType));
+        placeHunter(agents[i].hunter, &house, randomRoom(&(house.rooms), 0), EMF, "Bench");
+        agents[i].hunter->id = i;
+        trackHunter(&house, ROOM_NONE, agents[i].hunter->room->id);
+        agents[i].index = i;
+        agents[i].turns = options->benchTurns;
+        agents[i].padded = C_TRUE;
+    }
+    moves = (double) count * options->benchTurns / runAgents(agents, count, contentionHunter);
+
+    // Query the same random rooms from the index and by searching
+    seen = malloc(house.roomCount * sizeof(uint32_t));
+    queue = malloc(house.roomCount * sizeof(RoomId));
+    hops = malloc(house.roomCount);
+    for (uint32_t i = 0; i < house.roomCount; i++) {
+        seen[i] = UINT32_MAX;
+    }
+    for (int i = 0; i < queries; i++) {
+        rooms[i] = randInt(0, house.roomCount);
+    }
+    begin = benchNow();
+    for (int i = 0; i < queries; i++) {
+        indexTotal += huntersWithin(&house, rooms[i], PROXIMITY_HOPS) + nearestHunter(&house, rooms[i]);
+    }
+    indexed = queries / (benchNow() - begin);
+    begin = benchNow();
+    for (int i = 0; i < queries; i++) {
+        searchTotal += searchHunters(&house, rooms[i], seen, i, queue, hops);
+    }
+    searched = queries / (benchNow() - begin);
+    for (int i = 0; i < queries; i++) {
+        if (huntersWithin(&house, rooms[i], PROXIMITY_HOPS) != searchHunters(&house, rooms[i], seen, queries + i, queue, hops)) {
+            mismatches++;
+        }
+    }
+
+    printf("rooms,hunters,neighbourhood_rooms,build_sec,moves_per_sec,index_queries_per_sec,search_queries_per_sec,mismatches\n");
+    printf("%u,%d,%u,%.3f,%.0f,%.0f,%.0f,%d\n", house.roomCount, count, routing.ballOffsets[house.roomCount],
+        build, moves, indexed, searched, mismatches);
+    benchSink = indexTotal + searchTotal;
+
+    for (int i = 0; i < count; i++) {
+        free(agents[i].hunter);
+    }
+    free(agents);
+    free(rooms);
+    free(seen);
+    free(queue);
+    free(hops);
+    cleanUp(&house);
+    cleanRouting(&routing);
+}
+
+/*
+    Runs simulations of 'count' hunters in a generated house of 'rooms' rooms until the agents
+    took the benchmark's turns per hunter, merging every agent's turn statistics into 'total'
+    and counting simulations in 'runs'. Returns the seconds the agent threads ran for.
+*/
+static double runScalingPoint(OptionsType* options, int rooms, int count, TurnStatsType* total, int* runs) {
+    pthread_t* threads = malloc((count + NUM_GHOSTS) * sizeof(pthread_t));
+    HunterType** hunters = malloc(count * sizeof(HunterType*));
+    uint64_t target = (uint64_t) count * options->benchTurns;
+    double elapsed = 0;
+
+    initTurnStats(total);
+    for (*runs = 0; total->turns < target; (*runs)++) {
+        uint64_t seed = options->seed + *runs;
+        HouseType house;
+        GhostType* ghost;
+        double begin;
+
+        // Set up the simulation like runSimulation, with every agent recording its turns
+        seedRandom(mixSeed(seed, 0));
+        initHouse(&house, rooms, options->roomOrder);
+        house.hunterWait = options->hunterWait;
+        house.ghostWait = options->ghostWait;
+        house.pacing = options->pacing;
+        initGhost(&house, &ghost);
+        ghost->id = count;
+        ghost->seed = mixSeed(seed, 1);
+        ghost->stats = allocAgent(sizeof(TurnStatsType));
+        for (int i = 0; i < count; i++) {
+            hunters[i] = allocAgent(sizeof(HunterType));
+            placeHunter(hunters[i], &house, house.rooms.head->data, i % EV_COUNT, "Bench");
+            hunters[i]->id = i;
+            hunters[i]->seed = mixSeed(seed, i + 2);
+            hunters[i]->termination = &(house.termination);
+            hunters[i]->stats = allocAgent(sizeof(TurnStatsType));
+        }
+        initTermination(&(house.termination), count);
+
+        begin = benchNow();
+        pthread_create(&threads[count], NULL, runGhost, ghost);
+        for (int i = 0; i < count; i++) {
+            pthread_create(&threads[i], NULL, runHunter, hunters[i]);
+        }
+        for (int i = 0; i < count + NUM_GHOSTS; i++) {
+            pthread_join(threads[i], NULL);
+        }
+        elapsed += benchNow() - begin;
+
+        // Collect the statistics, the house frees the ghost but never owned the hunters
+        mergeTurnStats(total, ghost->stats);
+        free(ghost->stats);
+        for (int i = 0; i < count; i++) {
+            mergeTurnStats(total, hunters[i]->stats);
+            free(hunters[i]->stats);
+            free(hunters[i]);
+        }
+        cleanUp(&house);
+    }
+
+    free(threads);
+    free(hunters);
+    return elapsed;
+}
+
+/*
+    Runs the policy benchmark, printing nanoseconds per decision for each role and batch size.
+*/
+static void runPolicy(OptionsType* options) {
+    static char* roles[] = {"hunter", "ghost"};
+    int count = POLICY_BATCH_MAX;
+    long decisions = (long) options->benchHunters * options->benchTurns;
+    ObservationType* observations = malloc(count * sizeof(ObservationType));
+    uint8_t* actions = malloc(count);
+    long total = 0;
+    double begin, direct;
+
+    // Observations of agents scattered over a house, as a batched engine would gather them
+    seedRandom(mixSeed(options->seed, 0));
+    for (int i = 0; i < count; i++) {
+        observations[i].agent = i;
+        observations[i].turn = randInt(1, 1000);
+        observations[i].seed = mixSeed(options->seed, i + 2);
+        observations[i].room = randInt(0, 1024);
+        observations[i].hunters = randInt(0, 4);
+        observations[i].fear = randInt(0, FEAR_MAX);
+        observations[i].boredom = randInt(0, BOREDOM_MAX);
+        observations[i].evidence = randInt(0, 1 << EV_COUNT);
+        observations[i].ghost = randInt(0, 8) == 0;
+        observations[i].equipment = randInt(0, EV_COUNT);
+    }
+
+    printf("role,policy,batch,decisions,ns_per_decision\n");
+    begin = benchNow();
+    for (long i = 0; i < decisions; i++) {
+        total += randomHunterAction();
+    }
+    direct = benchNow() - begin;
+    printf("hunter,direct,1,%ld,%.2f\n", decisions, direct * 1e9 / decisions);
+
+    for (int role = 0; role < PR_COUNT; role++) {
+        for (int batch = 1; batch <= count; batch *= 4) {
+            begin = benchNow();
+            for (long done = 0; done < decisions; done += batch) {
+                const ObservationType* first = observations + (done % count / batch) * batch;
+                if (role == PR_HUNTER) {
+                    decideHunters(first, batch, actions);
+                } else {
+                    decideGhosts(first, batch, actions);
+                }
+                total += actions[0];
+            }
+            printf("%s,%s,%d,%ld,%.2f\n", roles[role], policyName(role), batch, decisions,
+                (benchNow() - begin) * 1e9 / decisions);
+        }
+    }
+    benchSink = total;
+
+    free(observations);
+    free(actions);
+}
+
+/*
+    Returns the cpu time the process has used in seconds.
+*/
+static double benchCpu(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/*
+    Runs the lanes benchmark, printing the runs per cpu second of the threaded and the lane
+    engine. The lane engine runs a hundred times as many runs, --runs sets the threaded count.
+*/
+static void runLaneEngines(OptionsType* options) {
+    OptionsType threaded = *options;
+    RosterType roster;
+    RoutingType routing;
+    RunRecord record;
+    int runs = (options->runs > 1) ? options->runs : 1000;
+    int wins = 0;
+    double begin, elapsed;
+
+    initRoster(&roster);
+    for (int i = 0; i < NUM_HUNTERS; i++) {
+        addHunterSpec(&roster, "Bench", i % EV_COUNT);
+    }
+
+    // Threads sleep through their waits, so time the threaded engine without them
+    threaded.hunterWait = 0;
+    threaded.ghostWait = 0;
+    prepareRouting(&threaded, &routing);
+    printf("engine,lanes,runs,cpu_seconds,runs_per_cpu_sec,hunter_win_fraction\n");
+    begin = benchCpu();
+    for (int i = 0; i < runs; i++) {
+        runSimulation(&threaded, &roster, &routing, NULL, options->seed + i, i + 1, &record, C_FALSE);
+        wins += record.outcome;
+    }
+    elapsed = benchCpu() - begin;
+    printf("threads,1,%d,%.3f,%.0f,%.4f\n", runs, elapsed, runs / elapsed, (double) wins / runs);
+    cleanRouting(&routing);
+
+    threaded = *options;
+    threaded.runs = runs * 100;
+    begin = benchCpu();
+    wins = runLanes(&threaded, &roster, NULL, C_FALSE);
+    elapsed = benchCpu() - begin;
+    printf("lanes,%d,%d,%.3f,%.0f,%.4f\n", SIMD_LANES, threaded.runs, elapsed, threaded.runs / elapsed,
+        (double) wins / threaded.runs);
+    cleanRoster(&roster);
+}
+
+/*
+    Runs the locality benchmark, printing one row per source order and room order.
+*/
+static void runLocality(OptionsType* options) {
+    static char* sources[] = {"generated", "shuffled"};
+    int rooms = (options->rooms > 0) ? options->rooms : 1000000;
+    int count = options->benchHunters;
+    BenchAgent* agents = malloc(count * sizeof(BenchAgent));
+
+    printf("source,order,rooms,hunters,spread_before,spread_after,order_sec,turns_per_sec\n");
+    for (int source = 0; source < 2; source++) {
+        for (int order = RO_CREATION; order <= RO_RCM; order++) {
+            TopologyType* topology;
+            HouseType house;
+            double begin, ordered, rate;
+
+            // Build the rooms, shuffling every room but the Van for the second source
+            seedRandom(mixSeed(options->seed, 0));
+            topology = createTopology(rooms, RO_CREATION);
+            if (source == 1) {
+                RoomType** shuffled = malloc(topology->roomCount * sizeof(RoomType*));
+                memcpy(shuffled, topology->roomById, topology->roomCount * sizeof(RoomType*));
+                for (uint32_t i = topology->roomCount - 1; i > 1; i--) {
+                    uint32_t j = randInt(1, i + 1);
+                    RoomType* swap = shuffled[i];
+                    shuffled[i] = shuffled[j];
+                    shuffled[j] = swap;
+                }
+                relocateRooms(topology, shuffled);
+                free(shuffled);
+            }
+            begin = benchNow();
+            orderRooms(topology, order);
+            ordered = benchNow() - begin;
+            initSharedHouse(&house, topology);
+
+            // Scatter the hunters over the house and let them move
+            seedRandom(mixSeed(options->seed, 1));
+            for (int i = 0; i < count; i++) {
+                agents[i].hunter = allocAgent(sizeof(HunterType));
+                placeHunter(agents[i].hunter, &house, house.roomById[randInt(0, house.roomCount)], EMF, "Bench");
+                agents[i].hunter->id = i;
+                agents[i].index = i;
+                agents[i].turns = options->benchTurns;
+                agents[i].padded = C_TRUE;
+            }
+            rate = (double) count * options->benchTurns / runAgents(agents, count, contentionHunter);
+
+            printf("%s,%s,%u,%d,%.1f,%.1f,%.3f,%.0f\n", sources[source], roomOrderName(order), house.roomCount,
+                count, topology->createdSpread, neighborSpread(topology), ordered, rate);
+            fflush(stdout);
+            for (int i = 0; i < count; i++) {
+                free(agents[i].hunter);
+            }
+            cleanUp(&house);
+            releaseTopology(topology);
+        }
+    }
+    free(agents);
+}
+
+/*
+    Runs the equivalence benchmark, returns the number of tests that failed.
+*/
+static int runEquivalence(OptionsType* options) {
+    static char* engines[] = {"threads", "lanes"};
+    OptionsType candidate = *options;
+    RunTally* tallies = malloc(2 * sizeof(RunTally));
+    RosterType roster;
+    RoutingType routing;
+    RunRecord record;
+    ResultWriter writer;
+    int runs[2];
+    double wall[2], cpu[2], begin, beginCpu;
+    int failed;
+
+    initRoster(&roster);
+    for (int i = 0; i < NUM_HUNTERS; i++) {
+        addHunterSpec(&roster, "Bench", i % EV_COUNT);
+    }
+    initTally(&tallies[0]);
+    initTally(&tallies[1]);
+
+    // The reference, every run on its own threads
+    runs[0] = (options->runs > 1) ? options->runs : 400;
+    prepareRouting(options, &routing);
+    begin = benchNow();
+    beginCpu = benchCpu();
+    for (int i = 0; i < runs[0]; i++) {
+        runSimulation(options, &roster, &routing, NULL, options->seed + i, i + 1, &record, C_FALSE);
+        tallyRun(&tallies[0], &record);
+    }
+    wall[0] = benchNow() - begin;
+    cpu[0] = benchCpu() - beginCpu;
+    cleanRouting(&routing);
+
+    // The candidate, many runs at once in vector lanes
+    runs[1] = runs[0] * 10;
+    candidate.runs = runs[1];
+    openResultTally(&writer, &tallies[1]);
+    begin = benchNow();
+    beginCpu = benchCpu();
+    runLanes(&candidate, &roster, &writer, C_FALSE);
+    wall[1] = benchNow() - begin;
+    cpu[1] = benchCpu() - beginCpu;
+    closeResultWriter(&writer);
+
+    failed = compareTallies(&tallies[0], &tallies[1], 0.01);
+    printf("\nengine,runs,wall_seconds,cpu_seconds,runs_per_wall_sec,runs_per_cpu_sec\n");
+    for (int e = 0; e < 2; e++) {
+        printf("%s,%d,%.3f,%.3f,%.0f,%.0f\n", engines[e], runs[e], wall[e], cpu[e], runs[e] / wall[e], runs[e] / cpu[e]);
+    }
+    printf("\n%s: %d of 6 tests failed, lanes ran %.1fx the runs per wall second and %.1fx per cpu second\n",
+        failed ? "DIFFERENT" : "EQUIVALENT", failed, (runs[1] / wall[1]) / (runs[0] / wall[0]),
+        (runs[1] / cpu[1]) / (runs[0] / cpu[0]));
+
+    cleanRoster(&roster);
+    free(tallies);
+    return failed;
+}
+
+/*
+    Live bytes counted by memory accounting over all subsystems.
+*/
+static int64_t liveTotal(void) {
+    MemoryTotals totals;
+    int64_t live = 0;
+
+    memoryTotals(&totals);
+    for (int s = 0; s < MEM_COUNT; s++) {
+        live += totals.live[s];
+    }
+    return live;
+}
+
+/*
+    Runs the shared topology benchmark, printing one row for private and one for shared
+    topologies.
+*/
+static void runShared(OptionsType* options) {
+    static char* modes[] = {"private", "shared"};
+    OptionsType setup = *options;
+    int states = (options->runs > 1) ? options->runs : 16;
+    HouseType* houses = malloc(states * sizeof(HouseType));
+    int accounting = memoryAccounting();
+    RosterType roster;
+
+    if (setup.rooms == 0) {
+        setup.rooms = 100000;
+    }
+    initRoster(&roster);
+    for (int i = 0; i < NUM_HUNTERS; i++) {
+        addHunterSpec(&roster, "Bench", i % EV_COUNT);
+    }
+
+    setMemoryAccounting(C_TRUE);
+    printf("mode,rooms,runs,shared_bytes,bytes_per_run,setup_us_per_run\n");
+    for (int mode = 0; mode < 2; mode++) {
+        RoutingType routing;
+        GhostType* ghost;
+        int64_t before = liveTotal(), shared;
+        double begin, elapsed;
+
+        // Private runs build their topology in setupSimulation, shared runs are handed one
+        memset(&routing, 0, sizeof(RoutingType));
+        if (mode == 1) {
+            prepareRouting(&setup, &routing);
+        }
+        shared = liveTotal() - before;
+
+        // Hold every run's state at once
+        begin = benchNow();
+        for (int i = 0; i < states; i++) {
+            setupSimulation(&setup, &roster, &routing, setup.seed + i, &houses[i], &ghost);
+        }
+        elapsed = benchNow() - begin;
+        printf("%s,%d,%d,%lld,%.0f,%.1f\n", modes[mode], houses[0].roomCount, states, (long long) shared,
+            (double) (liveTotal() - before - shared) / states, elapsed * 1e6 / states);
+        fflush(stdout);
+
+        for (int i = 0; i < states; i++) {
+            cleanUp(&houses[i]);
+        }
+        cleanRouting(&routing);
+    }
+    setMemoryAccounting(accounting);
+
+    cleanRoster(&roster);
+    free(houses);
+}
+
+/*
+    Runs the roster loading benchmark.
+*/
+static void runRosterLoad(OptionsType* options) {
+    static char* equipment[] = {"EMF", "TEMPERATURE", "FINGERPRINTS", "SOUND"};
+    char path[] = "/tmp/ghosthunt-roster-XXXXXX";
+    int count = (options->runs > 1) ? options->runs : 1000000;
+    int fd = mkstemp(path);
+    FILE* file = (fd < 0) ? NULL : fdopen(fd, "w");
+    RosterType roster;
+    long bytes;
+    double begin, elapsed;
+    int loaded;
+
+    if (file == NULL) {
+        perror(path);
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        if (i % 2) {
+            fprintf(file, "Hunter%d %s room=%d fear=%d boredom=%d\n", i, equipment[i % EV_COUNT], i % STANDARD_ROOMS,
+                FEAR_MAX + i % 5, BOREDOM_MAX + i % 7);
+        } else {
+            fprintf(file, "Hunter%d %s\n", i, equipment[i % EV_COUNT]);
+        }
+    }
+    bytes = ftell(file);
+    fclose(file);
+
+    initRoster(&roster);
+    begin = benchNow();
+    loaded = loadRoster(&roster, path, STANDARD_ROOMS);
+    elapsed = benchNow() - begin;
+    printf("hunters,bytes,load_sec,hunters_per_sec,mb_per_sec\n");
+    printf("%d,%ld,%.3f,%.0f,%.1f\n", loaded ? roster.size : 0, bytes, elapsed, roster.size / elapsed, bytes / elapsed / 1e6);
+
+    cleanRoster(&roster);
+    unlink(path);
+}
+
+/*
+    Runs the evidence summary benchmark on a generated house: at each density of evidence, the
+    share of room and type pairs holding evidence, it times evidence being left and collected
+    with the summary updated, then queries for the nearby room holding a type from the summary
+    and by search. Every search query is checked against the summary, the mean distance to the
+    room the summary found is shown next to the distance to the nearest one where both lie in
+    the same part of the house, and the counts of
+    the root are checked against the rooms after the updates.
+*/
+static void runSummary(OptionsType* options) {
+    static double densities[] = {0.0001, 0.01, 0.1};
+    int rooms = (options->rooms > 0) ? options->rooms : 1000000;
+    int updates = options->benchTurns * 50;
+    int queries = options->benchTurns;
+    int searches = (queries < 1000) ? queries : 1000;
+    HouseType house;
+    RoutingType routing;
+    uint32_t* pairs = malloc(updates * sizeof(uint32_t));
+    uint32_t* asked = malloc(queries * sizeof(uint32_t));
+    uint32_t* seen;
+    uint32_t* dist;
+    RoomId* queue;
+    uint32_t stamp = 0;
+    double begin, build;
+
+    // Build the house, its routing data and the summary tree
+    seedRandom(mixSeed(options->seed, 0));
+    initHouse(&house, rooms, options->roomOrder);
+    buildRouting(&routing, &house);
+    begin = benchNow();
+    buildSummary(&routing);
+    build = benchNow() - begin;
+    routing.topology = NULL;                // The house holds its own topology
+    house.routing = &routing;
+    initSummary(&house);
+    seen = malloc(house.roomCount * sizeof(uint32_t));
+    dist = malloc(house.roomCount * sizeof(uint32_t));
+    queue = malloc(house.roomCount * sizeof(RoomId));
+    for (uint32_t i = 0; i < house.roomCount; i++) {
+        seen[i] = UINT32_MAX;
+    }
+
+    printf("density,rooms,clusters,levels,build_sec,updates_per_sec,index_queries_per_sec,search_queries_per_sec,"
+        "index_hops,nearest_hops,mismatches,count_errors\n");
+    for (size_t d = 0; d < sizeof(densities) / sizeof(densities[0]); d++) {
+        uint32_t held = densities[d] * house.roomCount * EV_COUNT;
+        uint32_t* ring;
+        double updated, indexed, searched, indexHops = 0, nearestHops = 0;
+        long total = 0;
+        int mismatches = 0, countErrors = 0, found = 0;
+
+        // Start from an empty house, then leave evidence in 'held' random room and type pairs
+        held = (held > 0) ? held : 1;
+        ring = malloc(held * sizeof(uint32_t));
+        for (uint32_t r = 0; r < house.roomCount; r++) {
+            if (roomEvidence(&house, house.roomById[r]) != 0) {
+                setRoomEvidence(&house, house.roomById[r], 0);
+            }
+        }
+        for (uint32_t i = 0; i < held; i++) {
+            RoomType* room = house.roomById[randInt(0, house.roomCount)];
+            int type = randInt(0, EV_COUNT);
+            setRoomEvidence(&house, room, roomEvidence(&house, room) | (1 << type));
+            ring[i] = room->id * EV_COUNT + type;
+        }
+
+        // Each update collects the oldest evidence and leaves new evidence elsewhere
+        for (int i = 0; i < updates; i++) {
+            pairs[i] = randInt(0, house.roomCount) * EV_COUNT + randInt(0, EV_COUNT);
+        }
+        begin = benchNow();
+        for (int i = 0; i < updates; i++) {
+            uint32_t slot = i % held;
+            RoomType* room = house.roomById[ring[slot] / EV_COUNT];
+            setRoomEvidence(&house, room, roomEvidence(&house, room) & ~(1 << (ring[slot] % EV_COUNT)));
+            room = house.roomById[pairs[i] / EV_COUNT];
+            setRoomEvidence(&house, room, roomEvidence(&house, room) | (1 << (pairs[i] % EV_COUNT)));
+            ring[slot] = pairs[i];
+        }
+        updated = 2.0 * updates / (benchNow() - begin);
+
+        // Query the same random rooms and types from the summary and by searching
+        for (int i = 0; i < queries; i++) {
+            asked[i] = randInt(0, house.roomCount) * EV_COUNT + randInt(0, EV_COUNT);
+        }
+        begin = benchNow();
+        for (int i = 0; i < queries; i++) {
+            total += findEvidence(&house, asked[i] / EV_COUNT, asked[i] % EV_COUNT);
+        }
+        indexed = queries / (benchNow() - begin);
+        begin = benchNow();
+        for (int i = 0; i < searches; i++) {
+            uint32_t hops, targetHops;
+            total += searchEvidence(&house, asked[i] / EV_COUNT, asked[i] % EV_COUNT, ROOM_NONE, seen, stamp++, queue, dist,
+                &hops, &targetHops);
+        }
+        searched = searches / (benchNow() - begin);
+
+        for (int i = 0; i < searches; i++) {
+            RoomId from = asked[i] / EV_COUNT, room = findEvidence(&house, from, asked[i] % EV_COUNT);
+            uint32_t hops, targetHops;
+            RoomId nearest = searchEvidence(&house, from, asked[i] % EV_COUNT, room, seen, stamp++, queue, dist, &hops, &targetHops);
+            // The summary may find evidence in a part of the house the search cannot reach
+            if ((room == ROOM_NONE && nearest != ROOM_NONE)
+                || (room != ROOM_NONE && !((roomEvidence(&house, house.roomById[room]) >> (asked[i] % EV_COUNT)) & 1))) {
+                mismatches++;
+            } else if (nearest != ROOM_NONE && targetHops != UINT32_MAX) {
+                indexHops += targetHops;
+                nearestHops += hops;
+                found++;
+            }
+        }
+        for (int type = 0; type < EV_COUNT; type++) {
+            uint32_t holding = 0;
+            for (uint32_t r = 0; r < house.roomCount; r++) {
+                holding += (roomEvidence(&house, house.roomById[r]) >> type) & 1;
+            }
+            countErrors += holding != house.clusterEvidence[(size_t) (routing.clusterCount - 1) * EV_COUNT + type];
+        }
+
+        printf("%g,%u,%u,%u,%.3f,%.0f,%.0f,%.0f,%.2f,%.2f,%d,%d\n", densities[d], house.roomCount, routing.clusterCount,
+            routing.summaryLevels, build, updated, indexed, searched, found ? indexHops / found : 0,
+            found ? nearestHops / found : 0, mismatches, countErrors);
+        fflush(stdout);
+        benchSink = total;
+        free(ring);
+    }
+
+    free(pairs);
+    free(asked);
+    free(seen);
+    free(dist);
+    free(queue);
+    cleanUp(&house);
+    cleanRouting(&routing);
+}
+
+/*  Function: int runBenchmark(OptionsType* options)
+    Purpose: Runs the benchmark named in 'options' and prints its results as csv, returns
+        0 on success and 1 if the benchmark is unknown
+*/
+int runBenchmark(OptionsType* options) {
+    static char* affinityNames[] = {"none", "compact", "scatter"};
+
+    setLogging(C_FALSE);
+    if (!strcmp(options->bench, "contention")) {
+        printf("layout,affinity,numa_local,rooms,hunters,turns_per_sec\n");
+        for (int padded = C_FALSE; padded <= C_TRUE; padded++) {
+            double rate = runContention(options, padded);
+            printf("%s,%s,%d,%d,%d,%.0f\n", padded ? "padded" : "packed", affinityNames[options->affinity],
+                options->numaLocal, options->rooms, options->benchHunters, rate);
+        }
+        return 0;
+    }
+
+    if (!strcmp(options->bench, "locks")) {
+        enum LockBackend selected = currentLockBackend();
+        printf("lock,hunters,turns_per_sec\n");
+        for (int backend = 0; backend < LK_COUNT; backend++) {
+            if (!options->lockSweep && backend != (int) selected) {
+                continue;
+            }
+            setLockBackend(lockBackendName(backend));
+            for (int count = 1; count <= options->benchHunters; count *= 2) {
+                printf("%s,%d,%.0f\n", lockBackendName(backend), count, runLocks(options, count));
+            }
+        }
+        setLockBackend(lockBackendName(selected));
+        return 0;
+    }
+
+    if (!strcmp(options->bench, "scaling")) {
+        static char* scenarios[] = {"crowded", "sparse"};
+        TurnStatsType* total = malloc(sizeof(TurnStatsType));
+
+        setLockTiming(C_TRUE);
+        printf("scenario,lock,padding,hunter_wait,ghost_wait,hunters,rooms,runs,agent_turns_per_sec,mean_turn_ns,p99_turn_ns,lock_wait_fraction\n");
+        for (int scenario = 0; scenario < 2; scenario++) {
+            for (int count = 1; count <= options->benchHunters; count *= 2) {
+                int rooms = (scenario == 0) ? 4 : 64 * count;
+                int runs;
+                double elapsed = runScalingPoint(options, rooms, count, total, &runs);
+                printf("%s,%s,%d,%ld,%ld,%d,%d,%d,%.0f,%.0f,%llu,%.4f\n", scenarios[scenario],
+                    lockBackendName(currentLockBackend()), CACHE_PADDING, options->hunterWait, options->ghostWait,
+                    count, rooms, runs, total->turns / elapsed, (double) total->busyNanos / total->turns,
+                    (unsigned long long) turnPercentile(total, 0.99), (double) total->lockNanos / total->busyNanos);
+                fflush(stdout);
+            }
+        }
+        setLockTiming(C_FALSE);
+        free(total);
+        return 0;
+    }
+
+    if (!strcmp(options->bench, "policy")) {
+        runPolicy(options);
+        return 0;
+    }
+
+    if (!strcmp(options->bench, "lanes")) {
+        runLaneEngines(options);
+        return 0;
+    }
+
+    if (!strcmp(options->bench, "equivalence")) {
+        return runEquivalence(options) > 0;
+    }
+
+    if (!strcmp(options->bench, "roster")) {
+        runRosterLoad(options);
+        return 0;
+    }
+
+    if (!strcmp(options->bench, "shared")) {
+        runShared(options);
+        return 0;
+    }
+
+    if (!strcmp(options->bench, "locality")) {
+        runLocality(options);
+        return 0;
+    }
+
+    if (!strcmp(options->bench, "proximity")) {
+        runProximity(options);
+        return 0;
+    }
+
+    if (!strcmp(options->bench, "summary")) {
+        runSummary(options);
+        return 0;
+    }
+
+    fprintf(stderr, "unknown benchmark '%s'\n", options->bench);
+    return 1;
+}
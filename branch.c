@@ -0,0 +1,200 @@
+#include "defs.h"
+#include <limits.h>
+#include <sys/wait.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+/*
+    Branching runs many continuations of one simulation from a shared starting point. The
+    simulation runs normally until the branch event, when the ghost leaves its first evidence
+    or reaches a chosen turn. Each agent then parks at the start of its next turn. Once every
+    agent still in the house is parked, the house is in a consistent state: no agent is in the
+    middle of a turn or holds a lock.
+
+    The parent then forks one child per branch. A child shares the parent's memory copy on
+    write, so a branch only pays for the pages its continuation touches. Only the forking
+    thread exists in a child, so the child reseeds every agent with its branch's streams,
+    starts a new thread for each agent still in the house, and sends its outcome back over
+    a pipe. The parent's own continuation is stopped once every branch has finished.
+*/
+
+/*
+    Returns the seed of branch 'branch' of the run seeded with 'seed'.
+*/
+static uint64_t branchSeed(uint64_t seed, int branch) {
+    return ((uint64_t) mixSeed(seed, BRANCH_STREAM) << 32) ^ (uint64_t) branch;
+}
+
+/*
+    Waits until every agent still in the house is parked, returns C_FALSE if the simulation
+    ended without reaching the branch event.
+*/
+static int waitForPause(HouseType* house) {
+    struct timespec poll = {0, BRANCH_POLL * 1000};
+
+    for (;;) {
+        int active = atomic_load(&(house->termination.activeHunters)) + atomic_load(&(house->termination.activeGhosts));
+        if (atomic_load(&(house->pausing)) && atomic_load(&(house->parked)) == active) {
+            return C_TRUE;
+        }
+        if (!atomic_load(&(house->pausing)) && active == 0) {
+            return C_FALSE;
+        }
+        nanosleep(&poll, NULL);
+    }
+}
+
+/*
+    Lets every parked agent carry on.
+*/
+static void releaseAgents(HouseType* house) {
+    atomic_store(&(house->pausing), C_FALSE);
+    syscall(SYS_futex, &(house->pausing), FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+
+/*
+    Body of a child process: runs the continuation of branch 'branch' from the paused house
+    and writes its outcome to the file descriptor 'out'. Never returns.
+*/
+static void runBranch(HouseType* house, uint64_t seed, uint32_t run, int branch, int out) {
+    pthread_t threadIDS[NUM_HUNTERS + NUM_GHOSTS];
+    uint64_t continuation = branchSeed(seed, branch);
+    int threads = 0;
+    RunRecord record;
+
+    // None of the parked threads exist here, start a fresh one for each agent still inside.
+    // Their turn deadlines passed while they were parked, so each starts a new grid
+    setLogging(C_FALSE);
+    atomic_store(&(house->pausing), C_FALSE);
+    atomic_store(&(house->parked), 0);
+    if (atomic_load(&(house->termination.activeGhosts)) > 0) {
+        house->ghost->seed = mixSeed(continuation, 1);
+        house->ghost->pacer.next = 0;
+        pthread_create(&threadIDS[threads++], NULL, runGhost, house->ghost);
+    }
+    for (int i = 0; i < house->hunters.size; i++) {
+        HunterType* hunter = house->hunters.elements[i];
+        if (hunter->exitReason == LOG_UNKNOWN) {
+            hunter->seed = mixSeed(continuation, i + 2);
+            hunter->pacer.next = 0;
+            pthread_create(&threadIDS[threads++], NULL, runHunter, hunter);
+        }
+    }
+    for (int i = 0; i < threads; i++) {
+        pthread_join(threadIDS[i], NULL);
+    }
+
+    // A record is far smaller than PIPE_BUF, so it arrives in one piece
+    recordRun(house, continuation, run, &record);
+    if (write(out, &record, sizeof(RunRecord)) != sizeof(RunRecord)) {
+        _exit(1);
+    }
+    _exit(0);
+}
+
+/*  Function: void parkAgent(HouseType* house)
+    Purpose: Called by every agent at the start of its turn, waits while the house at the
+        pointer 'house' is paused for branching
+*/
+void parkAgent(HouseType* house) {
+    if (!atomic_load_explicit(&(house->pausing), memory_order_relaxed)) {
+        return;
+    }
+    atomic_fetch_add(&(house->parked), 1);
+    while (atomic_load(&(house->pausing))) {
+        syscall(SYS_futex, &(house->pausing), FUTEX_WAIT_PRIVATE, C_TRUE, NULL, NULL, 0);
+    }
+    atomic_fetch_sub(&(house->parked), 1);
+}
+
+/*  Function: void branchEvent(HouseType* house)
+    Purpose: Called by the ghost when the branch event happens, pauses the house at the
+        pointer 'house' the first time it is called
+*/
+void branchEvent(HouseType* house) {
+    if (house->branching && !atomic_exchange(&(house->branched), C_TRUE)) {
+        atomic_store(&(house->pausing), C_TRUE);
+    }
+}
+
+/*  Function: int runBranches(OptionsType* options, RosterType* roster, RoutingType* routing, uint64_t seed, uint32_t run, ResultWriter* writer)
+    Purpose: Runs the simulation seeded with 'seed' up to the branch event, then runs the
+        continuations of options->branches forked branches and writes their outcomes to 'writer',
+        or summarises them on the console when 'writer' is NULL. Branch b of run 'run' is
+        recorded as run run * branches + b. Returns the number of branches that finished
+*/
+int runBranches(OptionsType* options, RosterType* roster, RoutingType* routing, uint64_t seed, uint32_t run, ResultWriter* writer) {
+    HouseType house;
+    GhostType* ghost;
+    pthread_t threadIDS[NUM_HUNTERS + NUM_GHOSTS];
+    int* pipes = trackedMalloc(MEM_AGENTS, options->branches * sizeof(int));
+    pid_t* children = trackedMalloc(MEM_AGENTS, options->branches * sizeof(pid_t));
+    int launched = 0, finished = 0, hunterWins = 0;
+    uint32_t ghostTurn;
+
+    setupSimulation(options, roster, routing, seed, &house, &ghost);
+    house.branching = C_TRUE;
+    house.branchTurn = options->branchTurn;
+
+    pthread_create(threadIDS, NULL, runGhost, ghost);
+    for (int i = 0; i < house.hunters.size; i++) {
+        pthread_create(threadIDS + i + 1, NULL, runHunter, house.hunters.elements[i]);
+    }
+
+    // Fork the branches once every agent is parked, keeping up to BRANCH_JOBS running
+    if (waitForPause(&house)) {
+        ghostTurn = ghost->turns;
+        fflush(stdout);
+        while (finished < launched || launched < options->branches) {
+            RunRecord record;
+
+            while (launched < options->branches && launched - finished < BRANCH_JOBS) {
+                int ends[2];
+                if (pipe(ends) != 0) {
+                    break;
+                }
+                children[launched] = fork();
+                if (children[launched] < 0) {
+                    close(ends[0]);
+                    close(ends[1]);
+                    break;
+                }
+                if (children[launched] == 0) {
+                    close(ends[0]);
+                    runBranch(&house, seed, run * options->branches + launched, launched, ends[1]);
+                }
+                close(ends[1]);
+                pipes[launched++] = ends[0];
+            }
+            if (finished == launched) {
+                break;                              // no branch could be started
+            }
+
+            // Collect the oldest branch, a child that died never writes its record
+            if (read(pipes[finished], &record, sizeof(RunRecord)) == sizeof(RunRecord)) {
+                hunterWins += record.outcome;
+                if (writer != NULL) {
+                    writeResult(writer, &record);
+                }
+            }
+            close(pipes[finished]);
+            waitpid(children[finished], NULL, 0);
+            finished++;
+        }
+        printf("[BRANCHES] run %u: %d continuations from ghost turn %u, hunters won %d\n", run, finished, ghostTurn, hunterWins);
+    } else {
+        printf("[BRANCHES] run %u: ended before the branch event\n", run);
+    }
+
+    // The parent's own continuation is not needed
+    stopSimulation(&(house.termination));
+    releaseAgents(&house);
+    for (int i = 0; i < house.hunters.size + NUM_GHOSTS; i++) {
+        pthread_join(threadIDS[i], NULL);
+    }
+
+    trackedFree(MEM_AGENTS, pipes, options->branches * sizeof(int));
+    trackedFree(MEM_AGENTS, children, options->branches * sizeof(pid_t));
+    cleanUp(&house);
+    return finished;
+}
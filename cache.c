@@ -0,0 +1,318 @@
+#include "defs.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*
+    The result cache keeps the outcome of every run of a batch in a file, keyed by everything
+    that decides the run: the game constants compiled in, the options that change play, the
+    house topology, the hunter roster and the run's seed. A batch run with "--cache PATH" looks
+    each run up first and only simulates the runs the cache does not have.
+
+    The file is append only. A header is followed by fixed size records in host byte order,
+    each holding the configuration key, the seed, the wall time the run took and its outcome.
+    Opening the cache maps the file and indexes the records of the current configuration in a
+    hash table by seed. New results are appended, a record cut short by a crash is dropped the
+    next time the file is opened.
+
+    The rules of the game are code and are not hashed. CACHE_VERSION is part of every key, so
+    bumping it when a change alters the game keeps old results from being reused. Threaded runs
+    also depend on how their threads happened to interleave, a cached run is one outcome the
+    configuration and seed produced rather than the only one.
+
+    header   char[4] "GHRK", uint16 version, uint16 hunters, uint32 record bytes
+    record   config u64, seed u64, micros u32, ghost u8, evidence mask u8, outcome u8,
+             ghost boredom u16, ghost turns u32, then per hunter exit u8, fear u16,
+             boredom u16, turns u32
+*/
+
+#define CACHE_MAGIC     "GHRK"
+#define CACHE_VERSION   4
+#define CACHE_HEADER    12
+#define CACHE_RECORD    (29 + NUM_HUNTERS * 9)
+
+/*
+    Mixes 'value' into the hash 'hash'.
+*/
+static uint64_t hashValue(uint64_t hash, uint64_t value) {
+    return mixSeed(hash ^ value, 0x6768);
+}
+
+/*
+    Mixes the 'size' bytes at 'data' into the hash 'hash'.
+*/
+static uint64_t hashBytes(uint64_t hash, const void* data, size_t size) {
+    const uint8_t* bytes = data;
+
+    for (size_t i = 0; i < size; i += 8) {
+        uint64_t word = 0;
+        memcpy(&word, bytes + i, (size - i < 8) ? size - i : 8);
+        hash = hashValue(hash, word);
+    }
+    return hashValue(hash, size);
+}
+
+/*
+    Mixes the contents of the file at 'path' into 'hash', or its path if it cannot be read.
+*/
+static uint64_t hashFile(uint64_t hash, const char* path) {
+    uint8_t buffer[4096];
+    size_t n;
+    FILE* file = fopen(path, "rb");
+
+    if (file == NULL) {
+        return hashBytes(hash, path, strlen(path));
+    }
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        hash = hashBytes(hash, buffer, n);
+    }
+    fclose(file);
+    return hash;
+}
+
+/*
+    Returns the key of every run of the batch described by 'options' and 'roster', leaving out
+    only the seed.
+*/
+static uint64_t configKey(OptionsType* options, RosterType* roster) {
+    TopologyType* topology;
+    uint64_t hash = CACHE_VERSION;
+
+    // Game constants
+    hash = hashValue(hash, NUM_HUNTERS);
+    hash = hashValue(hash, NUM_GHOSTS);
+    hash = hashValue(hash, FEAR_MAX);
+    hash = hashValue(hash, BOREDOM_MAX);
+    hash = hashValue(hash, EV_COUNT);
+    hash = hashValue(hash, GHOST_COUNT);
+
+    // Options that change how the game plays
+    hash = hashValue(hash, options->engine);
+    hash = hashValue(hash, options->movement);
+    hash = hashValue(hash, options->haunting);
+    hash = hashValue(hash, options->hunterWait);
+    hash = hashValue(hash, options->ghostWait);
+    hash = hashValue(hash, options->pacing);
+    hash = hashValue(hash, options->evidenceCapacity);
+    hash = hashValue(hash, options->evidenceTtl);
+    hash = hashValue(hash, options->hunterPolicy != NULL);
+    hash = hashValue(hash, options->ghostPolicy != NULL);
+    if (options->hunterPolicy != NULL) {
+        hash = hashFile(hash, options->hunterPolicy);
+    }
+    if (options->ghostPolicy != NULL) {
+        hash = hashFile(hash, options->ghostPolicy);
+    }
+
+    // The topology exactly as the runs will build it
+    seedRandom(mixSeed(options->seed, 0));
+    topology = createTopology(options->rooms, options->roomOrder);
+    for (RoomNode* current = topology->rooms.head; current != NULL; current = current->next) {
+        const char* name = nameOf(current->data->name);
+        hash = hashBytes(hash, name, strlen(name));
+        for (RoomNode* next = current->data->connectedRooms.head; next != NULL; next = next->next) {
+            hash = hashValue(hash, next->data->id);
+        }
+    }
+    releaseTopology(topology);
+
+    // Every hunter of the roster, since the seed picks the slice a run places
+    for (int i = 0; i < roster->size; i++) {
+        hash = hashBytes(hash, roster->hunters[i].name, strlen(roster->hunters[i].name));
+        hash = hashValue(hash, roster->hunters[i].equipment);
+        hash = hashValue(hash, roster->hunters[i].room);
+        hash = hashValue(hash, roster->hunters[i].fearMax);
+        hash = hashValue(hash, roster->hunters[i].boredomMax);
+    }
+    return hashValue(hash, roster->size);
+}
+
+/*
+    Packs 'record' with its key and wall time into the record bytes 'p'.
+*/
+static void packEntry(uint8_t* p, uint64_t config, RunRecord* record, uint32_t micros) {
+    memcpy(p, &config, 8);
+    memcpy(p + 8, &(record->seed), 8);
+    memcpy(p + 16, &micros, 4);
+    p[20] = record->ghostClass;
+    p[21] = record->evidenceMask;
+    p[22] = record->outcome;
+    memcpy(p + 23, &(record->ghostBoredom), 2);
+    memcpy(p + 25, &(record->ghostTurns), 4);
+    for (int h = 0; h < NUM_HUNTERS; h++, p += 9) {
+        p[29] = record->hunterExit[h];
+        memcpy(p + 30, &(record->hunterFear[h]), 2);
+        memcpy(p + 32, &(record->hunterBoredom[h]), 2);
+        memcpy(p + 34, &(record->hunterTurns[h]), 4);
+    }
+}
+
+static void unpackEntry(const uint8_t* p, RunRecord* record) {
+    memcpy(&(record->seed), p + 8, 8);
+    record->ghostClass = p[20];
+    record->evidenceMask = p[21];
+    record->outcome = p[22];
+    memcpy(&(record->ghostBoredom), p + 23, 2);
+    memcpy(&(record->ghostTurns), p + 25, 4);
+    for (int h = 0; h < NUM_HUNTERS; h++, p += 9) {
+        record->hunterExit[h] = p[29];
+        memcpy(&(record->hunterFear[h]), p + 30, 2);
+        memcpy(&(record->hunterBoredom[h]), p + 32, 2);
+        memcpy(&(record->hunterTurns[h]), p + 34, 4);
+    }
+}
+
+/*
+    Returns the slot of the index holding 'seed', or the empty slot it would go in.
+*/
+static uint32_t findSlot(ResultCache* cache, uint64_t seed) {
+    uint32_t mask = cache->capacity - 1;
+    uint32_t slot = mixSeed(seed, 0) & mask;
+
+    while (cache->slots[slot] != 0) {
+        uint64_t stored;
+        memcpy(&stored, cache->map + CACHE_HEADER + (size_t) (cache->slots[slot] - 1) * CACHE_RECORD + 8, 8);
+        if (stored == seed) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+/*
+    Returns the current monotonic time in microseconds.
+*/
+static uint64_t cacheMicros(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/*  Function: int openResultCache(ResultCache* cache, char* path, OptionsType* options, RosterType* roster)
+    Purpose: Opens the cache file at 'path', creating it if needed, and indexes the results it
+        holds for the batch described by 'options' and 'roster'. Returns C_FALSE if the file
+        could not be opened or is not a result cache of this build
+*/
+int openResultCache(ResultCache* cache, char* path, OptionsType* options, RosterType* roster) {
+    uint8_t header[CACHE_HEADER];
+    uint16_t version = CACHE_VERSION, hunters = NUM_HUNTERS;
+    uint32_t recordSize = CACHE_RECORD;
+    struct stat info;
+    uint32_t records;
+
+    memset(cache, 0, sizeof(ResultCache));
+    cache->config = configKey(options, roster);
+    cache->fd = open(path, O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (cache->fd < 0 || fstat(cache->fd, &info) < 0) {
+        perror(path);
+        return C_FALSE;
+    }
+
+    // A new file gets its header, an existing one must have been written by this build
+    memcpy(header, CACHE_MAGIC, 4);
+    memcpy(header + 4, &version, 2);
+    memcpy(header + 6, &hunters, 2);
+    memcpy(header + 8, &recordSize, 4);
+    if (info.st_size == 0) {
+        if (write(cache->fd, header, CACHE_HEADER) != CACHE_HEADER) {
+            perror(path);
+            close(cache->fd);
+            return C_FALSE;
+        }
+        info.st_size = CACHE_HEADER;
+    } else {
+        uint8_t found[CACHE_HEADER];
+        if (pread(cache->fd, found, CACHE_HEADER, 0) != CACHE_HEADER || memcmp(found, header, CACHE_HEADER)) {
+            fprintf(stderr, "%s: not a result cache of this version\n", path);
+            close(cache->fd);
+            return C_FALSE;
+        }
+    }
+
+    // Drop a record cut short by a crash, so appends stay aligned
+    records = (info.st_size - CACHE_HEADER) / CACHE_RECORD;
+    cache->mapped = CACHE_HEADER + (size_t) records * CACHE_RECORD;
+    if ((size_t) info.st_size != cache->mapped && ftruncate(cache->fd, cache->mapped) < 0) {
+        perror(path);
+    }
+    cache->map = mmap(NULL, cache->mapped, PROT_READ, MAP_SHARED, cache->fd, 0);
+    if (cache->map == MAP_FAILED) {
+        perror(path);
+        close(cache->fd);
+        return C_FALSE;
+    }
+
+    // Index the records of this configuration by seed, the first result of a seed is kept
+    for (cache->capacity = 64; cache->capacity < 2 * records; cache->capacity *= 2);
+    cache->slots = trackedCalloc(MEM_LOGGING, cache->capacity, sizeof(uint32_t));
+    for (uint32_t i = 0; i < records; i++) {
+        const uint8_t* entry = cache->map + CACHE_HEADER + (size_t) i * CACHE_RECORD;
+        uint64_t config, seed;
+        uint32_t slot;
+        memcpy(&config, entry, 8);
+        memcpy(&seed, entry + 8, 8);
+        if (config != cache->config) {
+            continue;
+        }
+        slot = findSlot(cache, seed);
+        if (cache->slots[slot] == 0) {
+            cache->slots[slot] = i + 1;
+        }
+    }
+    return C_TRUE;
+}
+
+/*  Function: int lookupResult(ResultCache* cache, uint64_t seed, uint32_t run, RunRecord* record)
+    Purpose: Looks up the result of the run 'run' seeded with 'seed' and stores it in 'record'.
+        Returns C_TRUE if it was found, otherwise starts timing the run, which storeResult adds
+*/
+int lookupResult(ResultCache* cache, uint64_t seed, uint32_t run, RunRecord* record) {
+    uint32_t slot = findSlot(cache, seed);
+    const uint8_t* entry;
+    uint32_t micros;
+
+    if (cache->slots[slot] == 0) {
+        cache->misses++;
+        cache->started = cacheMicros();
+        return C_FALSE;
+    }
+    entry = cache->map + CACHE_HEADER + (size_t) (cache->slots[slot] - 1) * CACHE_RECORD;
+    memset(record, 0, sizeof(RunRecord));
+    unpackEntry(entry, record);
+    record->run = run;
+    memcpy(&micros, entry + 16, 4);
+    cache->hits++;
+    cache->savedMicros += micros;
+    return C_TRUE;
+}
+
+/*  Function: void storeResult(ResultCache* cache, RunRecord* record)
+    Purpose: Appends the result in 'record' of the run last looked up and not found, with the
+        wall time since the lookup
+*/
+void storeResult(ResultCache* cache, RunRecord* record) {
+    uint8_t entry[CACHE_RECORD];
+    uint64_t micros = cacheMicros() - cache->started;
+
+    packEntry(entry, cache->config, record, (micros < UINT32_MAX) ? micros : UINT32_MAX);
+    if (write(cache->fd, entry, CACHE_RECORD) != CACHE_RECORD) {
+        perror("result cache");
+    }
+    cache->spentMicros += micros;
+}
+
+/*  Function: void closeResultCache(ResultCache* cache)
+    Purpose: Prints how many runs the cache answered and the time that saved, then unmaps and
+        closes the cache file
+*/
+void closeResultCache(ResultCache* cache) {
+    uint32_t lookups = cache->hits + cache->misses;
+
+    printf("[CACHE] %u of %u runs found (%.1f%%), saved %.2f s of running, %.2f s spent on the other runs\n",
+        cache->hits, lookups, lookups ? 100.0 * cache->hits / lookups : 0, cache->savedMicros / 1e6,
+        cache->spentMicros / 1e6);
+    munmap(cache->map, cache->mapped);
+    close(cache->fd);
+    trackedFree(MEM_LOGGING, cache->slots, cache->capacity * sizeof(uint32_t));
+}
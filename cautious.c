@@ -0,0 +1,54 @@
+#include "defs.h"
+
+/*
+    Example policy shared object, built by "make" and loaded with
+    "--hunter-policy ./cautious.so --ghost-policy ./cautious.so".
+
+    Cautious hunters leave a room the ghost is in once they are half way to fleeing, collect
+    whenever the room holds evidence their equipment can pick up, review every eighth turn and
+    otherwise keep moving. The ghost leaves evidence where hunters will find it and drifts on
+    from empty rooms. Random choices hash the agent's seed with its turn, so a run stays
+    reproducible and the policy needs no state shared between agent threads.
+*/
+
+/*
+    Returns a well mixed hash of an agent's seed and turn.
+*/
+static uint32_t turnHash(const ObservationType* observation) {
+    uint32_t h = observation->seed ^ (observation->turn * 0x9E3779B9U);
+    h = (h ^ (h >> 16)) * 0x85EBCA6BU;
+    h = (h ^ (h >> 13)) * 0xC2B2AE35U;
+    return h ^ (h >> 16);
+}
+
+static void cautiousHunters(void* state, const ObservationType* observations, int count, uint8_t* actions) {
+    (void) state;
+    for (int i = 0; i < count; i++) {
+        const ObservationType* seen = &observations[i];
+
+        if (seen->ghost && seen->fear >= FEAR_MAX / 2) {
+            actions[i] = MOVING;
+        } else if (seen->equipment < EV_COUNT && (seen->evidence & (1 << seen->equipment))) {
+            actions[i] = COLLECTING;
+        } else if (seen->turn % 8 == 0) {
+            actions[i] = REVIEWING;
+        } else {
+            actions[i] = MOVING;
+        }
+    }
+}
+
+static void cautiousGhosts(void* state, const ObservationType* observations, int count, uint8_t* actions) {
+    (void) state;
+    for (int i = 0; i < count; i++) {
+        uint32_t roll = turnHash(&observations[i]) % 4;
+
+        if (observations[i].hunters > 0) {
+            actions[i] = (roll < 2) ? LEAVE_EVIDENCE : NOTHING;
+        } else {
+            actions[i] = (roll == 0) ? LEAVE_EVIDENCE : MOVE_ROOMS;
+        }
+    }
+}
+
+const PolicyApi ghosthuntPolicy = {POLICY_API_VERSION, "cautious", NULL, NULL, cautiousHunters, cautiousGhosts};
@@ -6,6 +6,10 @@
 #include <semaphore.h>
 #include <curses.h>
 #include <time.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <getopt.h>
 
 #define C_TRUE          1
 #define C_FALSE         0
@@ -18,46 +22,226 @@
 #define NUM_GHOSTS      1
 #define NUM_GHOST_EV    3
 #define LOGGING         C_TRUE
+#define RESULT_BUFFER   (1 << 20)
+#define RESULT_BLOCK    8192
+#define CACHE_LINE      64
+#define ROOM_OCCUPANCY  0xFFFFFFFFULL   // bits of the room state counting hunters
+#define ROOM_GHOST      (1ULL << 32)    // room state bit set while the ghost is in the room
+#define ROOM_EV_SHIFT   33              // first bit of the room state evidence mask
+#define ROOM_EV_MASK    (0xFFULL << ROOM_EV_SHIFT)
+#define ROOM_VERSION    (1ULL << 41)    // increment of the version held in the top room state bits
+#define CACHE_PADDING   C_TRUE
+#define LOCK_SPINS      100
+#define ROUTING_TABLE_MAX 2048          // largest house given an all-pairs next hop table
+#define ROUTING_LANDMARKS 8             // landmark rooms used to route in larger houses
+#define ROUTE_NONE      255             // next hop slot of an unreachable goal
+#define ROOM_NONE       UINT32_MAX      // room id meaning no room
+#define PROXIMITY_HOPS  2               // farthest distance the proximity index counts hunters at, k of its
+                                        // k-hop queries is fixed here at compile time
+#define SUMMARY_FANOUT  16              // most rooms, or clusters, in an evidence summary cluster
+#define SUMMARY_SMALL   4               // evidence summary clusters smaller than this are pooled
+#define TURN_BUCKETS    512             // turn latency histogram buckets, eight per power of two
+#define EVIDENCE_CAPACITY 0             // default most evidence a room holds, 0 keeps it all like the original rules
+#define WHEEL_BITS      6               // log2 of the slots per timing wheel level
+#define WHEEL_SLOTS     (1 << WHEEL_BITS)
+#define WHEEL_LEVELS    4               // timing wheel levels, spanning 2^24 ticks
+#define SAMPLE_RING     8192            // samples kept per run, the oldest are overwritten first
+#define SAMPLE_DENSE_ROOMS 1024        // largest house whose every room's hunters are sampled, larger ones sample occupied rooms
+#define SAMPLE_BOREDOM_WIDTH 5          // boredom values per sampled histogram bucket
+#define SAMPLE_BOREDOM_BUCKETS (BOREDOM_MAX / SAMPLE_BOREDOM_WIDTH + 1)
+#define BRANCH_STREAM   0x8000          // random stream the seeds of branches are drawn from
+#define BRANCH_POLL     100             // microseconds between checks for a paused house
+#define BRANCH_JOBS     64              // branches running at once, they mostly sleep between turns
+#define DISTRIB_CHUNK   16              // default runs a coordinator hands a worker at a time
+#define DISTRIB_WORKERS 256             // most workers connected to a coordinator at once
+#define POLICY_API_VERSION 1            // version of struct PolicyApi that policy shared objects export
+#define POLICY_SYMBOL   "ghosthuntPolicy" // name of the PolicyApi a policy shared object exports
+#define POLICY_BATCH_MAX 1024          // largest batch of observations the policy benchmark decides
+#define TALLY_TURNS     1024            // turn counts tallied one by one, longer runs share the last bucket
+#define TALLY_PATTERNS  1024            // exit reason patterns of a run tallied one by one, later ones share the last bucket
+#define LANE_EVIDENCE_MAX 16            // most evidence a room holds on the lane engine, two bits each in a word
+#define ROSTER_BUFFER   (1 << 16)       // bytes of a bulk roster read at a time, the longest line it takes
+#define STANDARD_ROOMS  13              // rooms of the standard house populateRooms builds
+#define LANE_WINDOW     512             // runs the lane engine may finish ahead of the oldest unfinished run
+
+// Lock backend used unless --lock selects another, e.g. make CFLAGS+=-DLOCK_BACKEND=LK_FUTEX
+#ifndef LOCK_BACKEND
+#define LOCK_BACKEND    LK_SEM
+#endif
+
+// Runs the lane engine steps at once, e.g. make CFLAGS+="-O2 -mavx512f -DSIMD_LANES=16"
+#ifndef SIMD_LANES
+#define SIMD_LANES      8
+#endif
+
+// Places a structure member at the start of its own cache line when padding is enabled
+#if CACHE_PADDING
+#define CACHE_ALIGNED   _Alignas(CACHE_LINE)
+#else
+#define CACHE_ALIGNED
+#endif
+
+// Static tracepoints, built unless make CFLAGS+=-DTRACEPOINTS=0
+#ifndef TRACEPOINTS
+#define TRACEPOINTS     C_TRUE
+#endif
+
+/*
+    TRACE(name, id, room, evidence) and TRACE4(name, id, room, evidence, extra) place a
+    USDT probe "ghosthunt:name" in the format of sys/sdt.h, so perf, bpftrace and systemtap
+    can attach to it. A probe is a single nop until a tracer attaches. An ELF note tells the
+    tracer where the compiler keeps each argument, read as 8 byte values, so nothing is
+    copied for a probe beyond the usually cached loads of its arguments.
+*/
+#if TRACEPOINTS && defined(__x86_64__)
+#define TRACE_NOTE(name, args) \
+    "990: nop\n" \
+    ".pushsection .note.stapsdt,\"?\",\"note\"\n" \
+    ".balign 4\n" \
+    ".4byte 992f-991f, 994f-993f, 3\n" \
+    "991: .asciz \"stapsdt\"\n" \
+    "992: .balign 4\n" \
+    "993: .8byte 990b\n" \
+    ".8byte _.stapsdt.base\n" \
+    ".8byte 0\n" \
+    ".asciz \"ghosthunt\"\n" \
+    ".asciz \"" #name "\"\n" \
+    ".asciz \"" args "\"\n" \
+    "994: .balign 4\n" \
+    ".popsection\n" \
+    ".ifndef _.stapsdt.base\n" \
+    ".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n" \
+    ".weak _.stapsdt.base\n" \
+    ".hidden _.stapsdt.base\n" \
+    "_.stapsdt.base: .space 1\n" \
+    ".size _.stapsdt.base, 1\n" \
+    ".popsection\n" \
+    ".endif\n"
+#define TRACE1(name, a) \
+    __asm__ __volatile__ (TRACE_NOTE(name, "8@%0") :: "nor" ((uint64_t) (a)))
+#define TRACE(name, id, room, evidence) \
+    __asm__ __volatile__ (TRACE_NOTE(name, "8@%0 8@%1 8@%2") :: "nor" ((uint64_t) (id)), \
+        "nor" ((uint64_t) (room)), "nor" ((uint64_t) (evidence)))
+#define TRACE4(name, id, room, evidence, extra) \
+    __asm__ __volatile__ (TRACE_NOTE(name, "8@%0 8@%1 8@%2 8@%3") :: "nor" ((uint64_t) (id)), \
+        "nor" ((uint64_t) (room)), "nor" ((uint64_t) (evidence)), "nor" ((uint64_t) (extra)))
+#else
+#define TRACE1(name, a)
+#define TRACE(name, id, room, evidence)
+#define TRACE4(name, id, room, evidence, extra)
+#endif
 
 typedef enum EvidenceType EvidenceType;
 typedef enum GhostClass GhostClass;
+typedef uint32_t RoomId;
+typedef uint32_t AgentId;
 
 enum GhostActions  { NOTHING, LEAVE_EVIDENCE, MOVE_ROOMS, GA_COUNT };
 enum HunterActions { COLLECTING, MOVING, REVIEWING, HA_COUNT };
 enum EvidenceType  { EMF, TEMPERATURE, FINGERPRINTS, SOUND, EV_COUNT, EV_UNKNOWN };
 enum GhostClass    { POLTERGEIST, BANSHEE, BULLIES, PHANTOM, GHOST_COUNT, GH_UNKNOWN };
-enum LoggerDetails { LOG_FEAR, LOG_BORED, LOG_EVIDENCE, LOG_SUFFICIENT, LOG_INSUFFICIENT, LOG_UNKNOWN };
+enum LoggerDetails { LOG_FEAR, LOG_BORED, LOG_EVIDENCE, LOG_SUFFICIENT, LOG_INSUFFICIENT, LOG_EMPTY, LOG_UNKNOWN };
+enum ResultFormat  { RF_NONE, RF_CSV, RF_BINARY };
+enum AffinityMode  { AF_NONE, AF_COMPACT, AF_SCATTER };
+enum LockBackend   { LK_SEM, LK_FUTEX, LK_TICKET, LK_ADAPTIVE, LK_COUNT };
+enum MovePolicy    { MV_RANDOM, MV_EVIDENCE, MV_VAN, MV_COLLECT };
+enum HauntPolicy   { GM_RANDOM, GM_SEEK, GM_AVOID };
+enum PolicyRole    { PR_HUNTER, PR_GHOST, PR_COUNT };
+enum MemorySubsystem { MEM_TOPOLOGY, MEM_EVIDENCE, MEM_AGENTS, MEM_NAMES, MEM_LOGGING, MEM_COUNT };
+enum PacingMode    { PC_RELATIVE, PC_ABSOLUTE };
+enum Engine        { EN_THREADS, EN_LANES };
+enum RoomOrder     { RO_CREATION, RO_BFS, RO_RCM };
 
 /* These rename the structures that we'll be creating.*/
 typedef struct RoomList     RoomList;
 typedef struct RoomNode     RoomNode;
 typedef struct Room         RoomType;
+typedef struct RoomHot      RoomHot;
+typedef struct Topology     TopologyType;
+typedef struct RoomSnapshot RoomSnapshot;
+typedef struct StringTable  StringTable;
 typedef struct HunterArray  HunterArray;
 typedef struct Hunter       HunterType;
 typedef struct EvidenceList EvidenceList;
+typedef struct Lock         LockType;
 typedef struct EvidenceNode EvidenceNode;
 typedef struct Ghost        GhostType;
 typedef struct House        HouseType; 
+typedef struct Termination  TerminationType;
+typedef struct Routing      RoutingType;
+typedef struct TurnStats    TurnStatsType;
+typedef struct Pacer        PacerType;
+typedef struct TimingWheel  TimingWheel;
+typedef struct Sample       SampleType;
+typedef struct Sampler      SamplerType;
+typedef struct HunterSpec   HunterSpec;
+typedef struct Observation  ObservationType;
+typedef struct PolicyApi    PolicyApi;
+typedef struct MemoryTotals MemoryTotals;
+typedef struct Roster       RosterType;
+typedef struct Options      OptionsType;
+typedef struct RunRecord    RunRecord;
+typedef struct RunTally     RunTally;
+typedef struct ResultCache  ResultCache;
+typedef struct ResultWriter ResultWriter;
+
+struct Lock {
+    union {
+        sem_t sem;                     // semaphore backend
+        struct {
+            _Atomic uint32_t word;     // futex state, or next ticket of the ticket backend
+            _Atomic uint32_t owner;    // ticket being served by the ticket backend
+        };
+    };
+};
 
 struct EvidenceNode {
     EvidenceType         data;         // enumerated evidence type
     struct EvidenceNode* next;         // pointer to next node
+    RoomType*            room;         // room the evidence was left in, NULL if not left by the ghost
+    struct EvidenceNode* wheelNext;    // next node in the same timing wheel slot
+    uint32_t             expires;      // tick the evidence expires at
+    uint8_t              timed;        // whether the timing wheel frees the node
+    uint8_t              collected;    // set once a timed node has left its list
 };
 
 struct EvidenceList { 
     EvidenceNode* head;                // first node in evidence linked list
     EvidenceNode* tail;                // last node in evidence linked list
+    int           size;                // number of nodes in the list
     int           sufficentEv;         // flag to see if other threads should exit
-    sem_t         sem;                 // semaphore
+    CACHE_ALIGNED LockType lock;       // lock, on its own line so waiting does not evict the list
+};
+
+struct Pacer {
+    uint64_t     next;              // monotonic deadline of the next turn in nanoseconds, 0 until the first turn
+    uint64_t     ticks;             // turns paced
+    uint64_t     overruns;          // turns that ended after the next turn was due
+    uint64_t     skipped;           // turn deadlines dropped to get back on the grid
+    uint64_t     wakeups;           // turns that slept until their deadline
+    uint64_t     jitterNanos;       // total time woken after the deadline
+    uint64_t     jitterMax;         // longest time woken after the deadline
 };
 
 struct Hunter {
+    // Hot state, touched every turn
     RoomType*     room;             // pointer to room they are currently in
-    EvidenceType  equipment;        // enumerated type representing type of evidence they can collect
-    char          name[MAX_STR];    // name of hunter
-    EvidenceList* evidence;         // pointer to shared collection of evicence (i.e., in house)
     int           fear;             // counter for fear
     int           boredom;          // counter for boredom
+    int           turns;            // number of turns taken
+    int           fearMax;          // fear the hunter leaves at
+    int           boredomMax;       // boredom the hunter leaves at
+    // Cold state, set up once
+    AgentId       id;               // index of the hunter in the house
+    uint32_t      name;             // interned name of hunter
+    EvidenceType  equipment;        // enumerated type representing type of evidence they can collect
+    enum LoggerDetails exitReason;  // why the hunter left the house
+    EvidenceList* evidence;         // pointer to shared collection of evicence (i.e., in house)
+    TerminationType* termination;   // pointer to the house's termination
+    HouseType*    house;            // house the hunter is in
+    unsigned int  seed;             // seed for the hunter's random stream
+    TurnStatsType* stats;           // where turn latencies are recorded, NULL if not measured
+    PacerType     pacer;            // deadlines and lateness of the hunter's turns
 };
 
 struct HunterArray {
@@ -66,9 +250,16 @@ struct HunterArray {
 };
 
 struct Ghost {
+    AgentId    id;                  // id of the ghost, numbered after the hunters
     GhostClass type;                // enumerate type representing what kind of ghost it is
     RoomType*  room;                // pointer to the room the ghost is in
     int        boredom;             // boredom timer
+    int        turns;               // number of turns taken
+    unsigned int seed;              // seed for the ghost's random stream
+    TerminationType* termination;   // pointer to the house's termination
+    HouseType* house;               // house the ghost haunts
+    TurnStatsType* stats;           // where turn latencies are recorded, NULL if not measured
+    PacerType  pacer;               // deadlines and lateness of the ghost's turns
 };
 
 struct RoomList { 
@@ -82,27 +273,288 @@ struct RoomNode {
     struct RoomNode* next;          // Pointer to the next element in the linked list
 };
 
+struct RoomHot {
+    _Atomic uint64_t state;         // occupancy, ghost flag, evidence mask and version in one word
+};
+
+struct RoomSnapshot {
+    uint32_t     occupancy;         // number of hunters in the room
+    int          ghost;             // C_TRUE while the ghost is in the room
+    int          evidenceMask;      // bit per evidence type lying in the room
+    uint32_t     version;           // bumped by every change to the room state
+};
+
 struct Room {
-    char         name[MAX_STR];     // room name
+    RoomId       id;                // index of the room in the house
+    uint32_t     name;              // interned room name
     RoomList     connectedRooms;    // linked list connected rooms
-    EvidenceList evidence;          // linked list evidence
-    HunterArray  hunters;           // collection of pointers to hunters in room
-    GhostType*   ghost;             // pointer to the ghost if in room
-    sem_t        sem;               // semaphore
+};
+
+struct Topology {
+    RoomList     rooms;             // linked list of all rooms, in id order
+    RoomType**   roomById;          // every room, indexed by room id
+    uint32_t     roomCount;         // number of rooms
+    RoomId*      createdRooms;      // id of each room by the id it was created with, NULL if never moved
+    double       createdSpread;     // average id distance of connected rooms in creation order
+    enum RoomOrder roomOrder;       // order the rooms are numbered and allocated in
+    _Atomic int  users;             // houses built on the topology, and its creator until released
+};
+
+struct Termination {
+    CACHE_ALIGNED _Atomic uint32_t stopped; // set once the outcome is decided, agents sleep on it
+    _Atomic int  activeHunters;     // hunters still in the house
+    _Atomic int  activeGhosts;      // ghosts still in the house
+};
+
+struct TimingWheel {
+    uint32_t      now;              // current tick
+    uint32_t      pending;          // nodes filed in the wheel
+    EvidenceNode* slots[WHEEL_LEVELS][WHEEL_SLOTS]; // nodes by level and slot, chained through wheelNext
 };
 
 struct House {
     HunterArray  hunters;           // collection of pointers to all the hunters
-    RoomList     rooms;             // linked list of all rooms in house
+    TopologyType* topology;         // read only rooms of the house, shared with other runs
+    RoomList     rooms;             // linked list of all rooms in house, the topology's
     EvidenceList evidence;          // all the shared evidence the hunters have collected
     GhostType*   ghost;             // pointer to ghost in house
+    RoomHot*     roomHot;           // hot state of every room, indexed by room id
+    _Atomic(EvidenceList*)* roomEvidence; // evidence lying in each room, indexed by room id, NULL until first left
+    RoomType**   roomById;          // every room, indexed by room id, the topology's
+    uint32_t     roomCount;         // number of rooms in the house
+    TerminationType termination;    // tracks agents in the house and stops the simulation
+    RoutingType* routing;           // shared routing data of the topology, NULL if not built
+    enum MovePolicy movement;       // how hunters choose the room to move to
+    enum HauntPolicy haunting;      // how the ghost chooses the room to move to
+    _Atomic uint32_t lastEvidence;  // id of the room evidence was last left in, ROOM_NONE if none
+    _Atomic uint32_t* nearby;       // hunters at each distance up to PROXIMITY_HOPS from each room, or NULL
+    _Atomic uint32_t* clusterEvidence; // rooms holding each evidence type in each summary cluster, or NULL
+    long         hunterWait;        // microseconds a hunter sleeps after each turn
+    long         ghostWait;         // microseconds the ghost sleeps after each turn
+    enum PacingMode pacing;         // whether the waits are sleeps after a turn or periods between turns
+    int          evidenceCapacity;  // most evidence a room holds, 0 for no limit
+    uint32_t     evidenceTtl;       // ghost turns evidence lasts, 0 for forever
+    TimingWheel  evidenceWheel;     // expires evidence, ticked once per ghost turn
+    _Atomic uint32_t collected[EV_COUNT]; // evidence of each type collected by the hunters
+    _Atomic uint32_t evidenceRooms[EV_COUNT]; // rooms holding each evidence type
+    SamplerType* sampler;           // sampler recording the run, NULL if not sampled
+    int          branching;         // whether the house pauses at the branch event
+    int          branchTurn;        // ghost turn to branch at, 0 to branch at the first evidence
+    _Atomic int  branched;          // set once the branch event happened
+    _Atomic uint32_t pausing;       // set while agents should park at the start of their turn
+    _Atomic int  parked;            // agents parked
+};
+
+struct Sample {
+    uint64_t nanos;                 // time since the run started
+    uint32_t ghostTurns;            // turns the ghost has taken
+    uint32_t ghostRoom;             // id of the ghost's room, ROOM_NONE once it left
+    uint16_t fear[FEAR_MAX + 1];    // hunters in the house by fear
+    uint16_t boredom[SAMPLE_BOREDOM_BUCKETS]; // hunters in the house by boredom bucket
+    uint16_t evidenceRooms[EV_COUNT]; // rooms holding each evidence type
+    uint16_t collected[EV_COUNT];   // evidence of each type collected so far
+};
+
+struct Sampler {
+    FILE*        file;              // sample file
+    long         intervalMicros;    // wall clock time between samples
+    int          intervalTurns;     // ghost turns between samples, 0 to sample by wall clock
+    SampleType*  ring;              // SAMPLE_RING samples of the current run
+    uint16_t*    occupancy;         // hunters per room, or per occupied room, of each sample in the ring
+    uint32_t*    occupied;          // occupied rooms of each sample when sampling occupied rooms, else NULL
+    uint32_t     roomCount;         // rooms of the sampled house
+    uint32_t     entries;           // occupancy entries per sample, 0 if the ring could not be allocated
+    uint64_t     taken;             // samples taken in the current run
+    uint64_t     start;             // time the current run started at
+    HouseType*   house;             // house being sampled
+    pthread_t    thread;            // sampler thread when sampling by wall clock
+};
+
+struct Routing {
+    TopologyType* topology;         // rooms every run of the batch shares, or NULL
+    uint32_t     roomCount;         // number of rooms in the topology, 0 without routing data
+    uint32_t*    offsets;           // start of each room's neighbours, roomCount + 1 entries
+    RoomId*      neighbors;         // ids of connected rooms, grouped by room
+    uint8_t*     nextHop;           // all-pairs next hop slots for small houses, else NULL
+    uint32_t*    landmarkDist;      // landmark to room distances for large houses, else NULL
+    uint32_t*    ballOffsets;       // start of each room's neighbourhood, roomCount + 1 entries, or NULL
+    RoomId*      ballRooms;         // rooms within PROXIMITY_HOPS hops, grouped by room
+    uint8_t*     ballHops;          // distance of each neighbourhood room from its centre
+    uint32_t     clusterCount;      // clusters of the evidence summary over all levels, 0 without one
+    uint32_t     leafClusters;      // clusters of the lowest level, numbered first, whose children are rooms
+    uint32_t     summaryLevels;     // levels of the evidence summary
+    uint32_t*    clusterOf;         // lowest level cluster of each room, or NULL
+    uint32_t*    clusterParent;     // cluster one level up of each cluster, ROOM_NONE for the root
+    uint32_t*    childOffsets;      // start of each cluster's children, clusterCount + 1 entries
+    uint32_t*    children;          // rooms of the lowest level clusters, then clusters of the levels above
+};
+
+struct StringTable {
+    char*        data;              // all interned strings, each null terminated
+    uint32_t     size;              // bytes used in data
+    uint32_t     capacity;          // bytes allocated for data
+    uint32_t*    slots;             // open addressing hash of offset + 1, 0 when empty
+    uint32_t     slotCount;         // number of hash slots, a power of two
+    uint32_t     count;             // number of interned strings
+};
+
+struct HunterSpec {
+    char         name[MAX_STR];     // name of hunter
+    EvidenceType equipment;         // type of evidence hunter can collect
+    RoomId       room;              // id of the room the hunter starts in, the Van (0) by default
+    uint16_t     fearMax;           // fear the hunter leaves at
+    uint16_t     boredomMax;        // boredom the hunter leaves at
+};
+
+struct Observation {
+    AgentId  agent;                 // id of the agent in the house
+    uint32_t turn;                  // turns the agent has taken, this one included
+    uint32_t seed;                  // seed of the agent's random stream, for reproducible policies
+    RoomId   room;                  // room the agent is in
+    uint32_t hunters;               // hunters in the room
+    uint16_t fear;                  // fear of a hunter, 0 for the ghost
+    uint16_t boredom;               // boredom of the agent
+    uint8_t  evidence;              // bit per evidence type lying in the room
+    uint8_t  ghost;                 // whether the ghost is in the room
+    uint8_t  equipment;             // evidence type a hunter collects, EV_UNKNOWN for the ghost
+};
+
+struct PolicyApi {
+    int         apiVersion;         // POLICY_API_VERSION the policy was built against
+    const char* name;               // name of the policy
+    void*       (*create)(uint64_t seed);   // creates the policy's state, may be NULL
+    void        (*destroy)(void* state);    // frees the policy's state, may be NULL
+    void        (*decideHunters)(void* state, const ObservationType* observations, int count, uint8_t* actions);
+    void        (*decideGhosts)(void* state, const ObservationType* observations, int count, uint8_t* actions);
+};
+
+struct MemoryTotals {
+    int64_t  live[MEM_COUNT];       // bytes allocated and not yet freed, per subsystem
+    int64_t  peak[MEM_COUNT];       // most bytes live at once, per subsystem
+    uint64_t allocs[MEM_COUNT];     // blocks allocated, per subsystem
+    uint64_t frees[MEM_COUNT];      // blocks freed, per subsystem
+};
+
+struct Roster {
+    HunterSpec* hunters;            // dynamically sized array of hunter specifications
+    int         size;               // number of hunters in the roster
+    int         capacity;           // allocated size of the array
+};
+
+struct Options {
+    int               runs;         // number of simulations to run
+    uint64_t          seed;         // seed of the first run
+    int               rooms;        // number of rooms to generate, 0 for the standard house
+    enum RoomOrder    roomOrder;    // order the rooms are numbered and allocated in
+    char*             resultPath;   // path of result file, NULL for console output
+    char*             cachePath;    // path of the result cache, NULL to run every run
+    char*             rosterPath;   // path of the bulk roster, "-" for stdin, NULL to prompt for hunters
+    enum ResultFormat resultFormat; // format of the result file
+    enum AffinityMode affinity;     // order agent threads are pinned to cpus in
+    int               numaLocal;    // move each agent's state to its NUMA node
+    char*             bench;        // name of the benchmark to run, NULL to simulate
+    int               benchHunters; // number of hunter threads used by benchmarks
+    int               benchTurns;   // number of turns each benchmark hunter takes
+    int               lockSweep;    // benchmark every lock backend instead of the selected one
+    enum MovePolicy   movement;     // how hunters choose the room to move to
+    enum HauntPolicy  haunting;     // how the ghost chooses the room to move to
+    long              hunterWait;   // microseconds a hunter sleeps after each turn
+    long              ghostWait;    // microseconds the ghost sleeps after each turn
+    enum PacingMode   pacing;       // whether the waits are sleeps after a turn or periods between turns
+    double            speed;        // multiplier the waits are divided by
+    int               evidenceCapacity; // most evidence a room holds, 0 for no limit
+    uint32_t          evidenceTtl;  // ghost turns evidence lasts, 0 for forever
+    char*             samplePath;   // path of the time series file, NULL to not sample
+    long              sampleMicros; // wall clock time between samples
+    int               sampleTurns;  // ghost turns between samples, 0 to sample by wall clock
+    int               branches;     // continuations forked from each run, 0 to not branch
+    int               branchTurn;   // ghost turn to branch at, 0 to branch at the first evidence
+    char*             coordinatePath; // socket to hand the runs out to workers on, NULL to run them here
+    char*             workerPath;   // socket of the coordinator to work for, NULL if not a worker
+    int               workers;      // local worker processes the coordinator forks
+    int               chunkRuns;    // runs handed to a worker at a time
+    char*             hunterPolicy; // policy choosing hunter actions, NULL for random
+    char*             ghostPolicy;  // policy choosing ghost actions, NULL for random
+    int               memoryReport; // count allocations per subsystem and report them
+    enum Engine       engine;       // runs each simulation on threads or many at once in vector lanes
+};
+
+struct TurnStats {
+    uint64_t turns;                 // number of turns recorded
+    uint64_t busyNanos;             // time spent in turns, sleeps excluded
+    uint64_t lockNanos;             // part of the turn time spent waiting for locks
+    uint32_t histogram[TURN_BUCKETS]; // turns by latency bucket
+};
+
+struct RunRecord {
+    uint64_t seed;                  // seed the run was started with
+    uint32_t run;                   // index of the run in the batch
+    uint8_t  ghostClass;            // enumerated ghost class
+    uint8_t  evidenceMask;          // bit per evidence type collected by the hunters
+    uint8_t  outcome;               // 1 if the hunters won, 0 if the ghost won
+    uint16_t ghostBoredom;          // final ghost boredom
+    uint32_t ghostTurns;            // turns taken by the ghost
+    uint8_t  hunterExit[NUM_HUNTERS];    // enum LoggerDetails reason each hunter left, LOG_UNKNOWN in unused slots
+    uint16_t hunterFear[NUM_HUNTERS];    // final fear of each hunter
+    uint16_t hunterBoredom[NUM_HUNTERS]; // final boredom of each hunter
+    uint32_t hunterTurns[NUM_HUNTERS];   // turns taken by each hunter
+};
+
+struct RunTally {
+    uint32_t runs;                  // runs counted
+    uint32_t outcomes[2];           // runs the ghost and the hunters won
+    uint32_t exits[LOG_UNKNOWN + 1]; // hunters that left for each enum LoggerDetails reason
+    uint32_t exitPatterns[TALLY_PATTERNS]; // runs by the reasons their hunters left for, in any order
+    uint32_t evidenceTypes[EV_COUNT + 1]; // runs that found each number of evidence types
+    uint32_t ghosts[GHOST_COUNT];   // runs of each ghost class
+    uint32_t ghostTurns[TALLY_TURNS]; // runs by ghost turns taken
+    uint32_t hunterTurns[TALLY_TURNS]; // runs by the mean turns their hunters took
+};
+
+struct ResultCache {
+    int       fd;                   // cache file, appended to
+    uint8_t*  map;                  // the records the file held when opened, mapped read only
+    size_t    mapped;               // bytes mapped
+    uint64_t  config;               // key of the batch's configuration
+    uint32_t* slots;                // index of the batch's records by seed, record number + 1 or 0
+    uint32_t  capacity;             // slots in the index, a power of two
+    uint32_t  hits;                 // runs found in the cache
+    uint32_t  misses;               // runs that had to be simulated
+    uint64_t  savedMicros;          // wall time the found runs took when they were simulated
+    uint64_t  spentMicros;          // wall time spent simulating the runs not found
+    uint64_t  started;              // when the run being simulated was looked up
+};
+
+struct ResultWriter {
+    FILE*             file;         // destination file, NULL if the writer only tallies
+    RunTally*         tally;        // tally counting every record written, or NULL
+    enum ResultFormat format;       // text csv or binary columnar
+    char*             buffer;       // output staging buffer
+    size_t            used;         // bytes staged in buffer
+    RunRecord*        rows;         // records staged for the next columnar block
+    int               rowCount;     // number of staged records
+    char*             path;         // path of the destination file, for error messages
+    int               failed;       // set once a write to the file fell short
 };
 
 //House Functions
-void initHouse(HouseType*);
-void populateRooms(HouseType*);
+void initHouse(HouseType*, int, enum RoomOrder);
+void initSharedHouse(HouseType*, TopologyType*);
+TopologyType* createTopology(int, enum RoomOrder);
+void releaseTopology(TopologyType*);
+void populateRooms(RoomList*);
+void generateRooms(RoomList*, int);
+void indexRooms(TopologyType*);
+void printLayout(HouseType*);
 void cleanUp(HouseType*);
 
+// Room Order Functions
+double neighborSpread(TopologyType*);
+void relocateRooms(TopologyType*, RoomType**);
+void orderRooms(TopologyType*, enum RoomOrder);
+RoomType* createdRoom(TopologyType*, RoomId);
+char* roomOrderName(enum RoomOrder);
+
 // Room Functions
 RoomType* createRoom(char*);
 void initRoomList(RoomList*);
@@ -111,12 +563,25 @@ void addRoom(RoomList*, RoomType*);
 void cleanRoomData(RoomList*);
 void cleanRoomList(RoomList*);
 RoomType* randomRoom(RoomList*, int);
+void enterRoom(HouseType*, RoomType*);
+void exitRoom(HouseType*, RoomType*);
+void setRoomGhost(HouseType*, RoomType*, int);
+void setRoomEvidence(HouseType*, RoomType*, int);
+uint32_t roomOccupancy(HouseType*, RoomType*);
+int roomHasGhost(HouseType*, RoomType*);
+int roomEvidence(HouseType*, RoomType*);
+void snapshotRoom(HouseType*, RoomType*, RoomSnapshot*);
+EvidenceList* evidenceIn(HouseType*, RoomType*);
 
 //Evidence Functions
 void initEvidenceList(EvidenceList*);
-void addEvidence(EvidenceList*, enum EvidenceType);
+EvidenceNode* addEvidence(EvidenceList*, enum EvidenceType);
+int trimEvidence(EvidenceList*, int);
+int unlinkEvidence(EvidenceList*, EvidenceNode*);
 int removeEvidence(EvidenceList*, enum EvidenceType);
+void expireEvidence(HouseType*);
 enum EvidenceType pickEvidence(enum GhostClass);
+int evidenceMask(EvidenceList*);
 void cleanEvidenceList(EvidenceList*);
 
 //Ghost Functions
@@ -126,17 +591,19 @@ void *runGhost(void*);
 int ghostWithHunter(GhostType*);
 enum GhostActions randomGhostAction();
 void moveGhostRooms(GhostType*);
+RoomType* chooseGhostRoom(GhostType*);
 void leaveEvidence(GhostType*);
 
 //Hunter Functions
 void initHunterArray(HunterArray*);
-void initHunter(RoomType*, enum EvidenceType, EvidenceList*, char*, HunterType**);
+void initHunter(HouseType*, RoomType*, enum EvidenceType, char*, HunterType**);
+void placeHunter(HunterType*, HouseType*, RoomType*, enum EvidenceType, char*);
 void addHunter(HunterArray*, HunterType*);
 void *runHunter(void*);
 enum HunterActions randomHunterAction();
 void collectEvidence(HunterType*);
 void moveHunterRooms(HunterType*);
-void removeHunter(HunterArray*, HunterType*);
+RoomType* chooseHunterRoom(HunterType*);
 void reviewEvidence(HunterType*);
 int sufficientEvidence(EvidenceList*);
 void cleanHunters(HunterArray*);
@@ -144,6 +611,8 @@ void cleanHunters(HunterArray*);
 // Utilitiy helpers
 int randInt(int,int);
 float randFloat(float, float);
+void seedRandom(unsigned int);
+unsigned int mixSeed(uint64_t, unsigned int);
 EvidenceType stringToEvidence(char*);
 void printResults(HouseType*);
 void printGhost(HouseType*);
@@ -153,7 +622,156 @@ void printEvidence(HouseType*, enum EvidenceType*);
 void evidenceToString(enum EvidenceType, char*);
 int huntersWin(HouseType*, enum EvidenceType*);
 
+// Simulation Functions
+void initRoster(RosterType*);
+void addHunterSpec(RosterType*, char*, enum EvidenceType);
+void readRoster(RosterType*);
+void cleanRoster(RosterType*);
+void setupSimulation(OptionsType*, RosterType*, RoutingType*, uint64_t, HouseType*, GhostType**);
+void recordRun(HouseType*, uint64_t, uint32_t, RunRecord*);
+void runSimulation(OptionsType*, RosterType*, RoutingType*, SamplerType*, uint64_t, uint32_t, RunRecord*, int);
+
+// Roster Loading Functions
+int loadRoster(RosterType*, char*, uint32_t);
+int rosterPlayers(RosterType*);
+HunterSpec* rosterHunter(RosterType*, uint64_t, int);
+int plainRoster(RosterType*);
+
+// Routing Functions
+void buildRouting(RoutingType*, HouseType*);
+void prepareRouting(OptionsType*, RoutingType*);
+RoomId nextHop(RoutingType*, RoomId, RoomId);
+void cleanRouting(RoutingType*);
+
+// Proximity Functions
+void buildNeighborhoods(RoutingType*);
+void initProximity(HouseType*);
+void trackHunter(HouseType*, RoomId, RoomId);
+int huntersWithin(HouseType*, RoomId, int);
+int nearestHunter(HouseType*, RoomId);
+
+// Evidence Summary Functions
+void buildSummary(RoutingType*);
+void initSummary(HouseType*);
+void summarizeEvidence(HouseType*, RoomId, int, int);
+RoomId findEvidence(HouseType*, RoomId, EvidenceType);
+
+// Name Functions
+uint32_t internName(const char*);
+char* nameOf(uint32_t);
+size_t nameTableBytes(void);
+void cleanNames(void);
+
+// Option Functions
+void initOptions(OptionsType*);
+int parseOptions(OptionsType*, int, char**);
+void printUsage(char*);
+
+// Result Functions
+int openResultWriter(ResultWriter*, char*, enum ResultFormat);
+void writeResult(ResultWriter*, RunRecord*);
+int closeResultWriter(ResultWriter*);
+void openResultTally(ResultWriter*, RunTally*);
+
+// Result Cache Functions
+int openResultCache(ResultCache*, char*, OptionsType*, RosterType*);
+int lookupResult(ResultCache*, uint64_t, uint32_t, RunRecord*);
+void storeResult(ResultCache*, RunRecord*);
+void closeResultCache(ResultCache*);
+
+// Run Tally Functions
+void initTally(RunTally*);
+void tallyRun(RunTally*, RunRecord*);
+int compareTallies(RunTally*, RunTally*, double);
+
+// Affinity Functions
+void initAffinity(enum AffinityMode, int);
+void* allocAgent(size_t);
+void* allocCacheAligned(size_t);
+void pinAgent(int, void*, size_t);
+
+// Termination Functions
+void initTermination(TerminationType*, int);
+void stopSimulation(TerminationType*);
+int simulationStopped(TerminationType*);
+void hunterLeft(TerminationType*);
+void ghostLeft(TerminationType*);
+int waitTurn(TerminationType*, long);
+int paceTurn(TerminationType*, PacerType*, long, enum PacingMode);
+
+// Lock Functions
+int setLockBackend(char*);
+char* lockBackendName(enum LockBackend);
+enum LockBackend currentLockBackend(void);
+void initLock(LockType*);
+void acquireLock(LockType*);
+void releaseLock(LockType*);
+void cleanLock(LockType*);
+void setLockTiming(int);
+uint64_t lockWaitNanos(void);
+
+// Branching Functions
+void parkAgent(HouseType*);
+void branchEvent(HouseType*);
+int runBranches(OptionsType*, RosterType*, RoutingType*, uint64_t, uint32_t, ResultWriter*);
+
+// Policy Functions
+int loadPolicy(enum PolicyRole, char*, uint64_t);
+int loadPolicies(OptionsType*);
+const char* policyName(enum PolicyRole);
+void decideHunters(const ObservationType*, int, uint8_t*);
+void decideGhosts(const ObservationType*, int, uint8_t*);
+void observeHunter(HunterType*, ObservationType*);
+void observeGhost(GhostType*, ObservationType*);
+void unloadPolicies(void);
+
+// Memory Accounting Functions
+void setMemoryAccounting(int);
+int memoryAccounting(void);
+void countAlloc(enum MemorySubsystem, size_t);
+void countFree(enum MemorySubsystem, size_t);
+void* trackedMalloc(enum MemorySubsystem, size_t);
+void* trackedCalloc(enum MemorySubsystem, size_t, size_t);
+void* trackedRealloc(enum MemorySubsystem, void*, size_t, size_t);
+void trackedFree(enum MemorySubsystem, void*, size_t);
+void memoryTotals(MemoryTotals*);
+char* memorySubsystemName(enum MemorySubsystem);
+int64_t reportLeaks(MemoryTotals*, uint32_t);
+void printMemoryReport(void);
+
+// Distributed Batch Functions
+int runWorker(char*);
+int runCoordinator(OptionsType*, RosterType*, ResultWriter*);
+
+// Lane Engine Functions
+int runLanes(OptionsType*, RosterType*, ResultWriter*, int);
+
+// Sampler Functions
+int openSampler(SamplerType*, OptionsType*);
+void startSampling(SamplerType*, HouseType*);
+void takeSample(SamplerType*);
+void stopSampling(SamplerType*, uint64_t, uint32_t);
+void closeSampler(SamplerType*);
+
+// Timing Wheel Functions
+void initWheel(TimingWheel*);
+void scheduleEvidence(TimingWheel*, EvidenceNode*, uint32_t);
+EvidenceNode* advanceWheel(TimingWheel*);
+void cleanWheel(TimingWheel*);
+
+// Timing Functions
+uint64_t nowNanos(void);
+void initTurnStats(TurnStatsType*);
+void recordTurn(TurnStatsType*, uint64_t, uint64_t);
+void mergeTurnStats(TurnStatsType*, TurnStatsType*);
+uint64_t turnPercentile(TurnStatsType*, double);
+void reportPacing(HouseType*, uint32_t, int);
+
+// Benchmark Functions
+int runBenchmark(OptionsType*);
+
 // Logging Utilities
+void setLogging(int);
 void l_hunterInit(char*, enum EvidenceType);
 void l_hunterMove(char*, char*);
 void l_hunterReview(char*, enum LoggerDetails);
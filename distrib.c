@@ -0,0 +1,694 @@
+#include "defs.h"
+#include <poll.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <limits.h>
+
+/*
+    A distributed batch splits the runs of a batch into chunks of consecutive runs and hands them
+    to worker processes. The coordinator listens on a Unix domain socket, and workers connect to
+    it, whether the coordinator forked them itself ("--workers N") or they were started on their
+    own ("--worker PATH"). A worker says hello, is sent the configuration of the batch and then
+    runs one chunk at a time, answering each with the chunk's result records.
+
+    Workers that leave, whether they crashed or were killed, have their chunk put back in the
+    queue. Once the queue is empty, an idle worker is given a second copy of the chunk that has
+    been running longest. The first copy to finish is kept, so one slow worker does not hold up
+    the end of the batch. Workers play with the coordinator's policies, whatever their own
+    command line loaded, so every record of the batch comes from the same game.
+
+    Every message is a header followed by its payload. All integers are little endian, so the
+    protocol does not depend on the host and can be carried over TCP unchanged.
+    header   char[4] "GHDP", uint16 type, uint16 reserved, uint32 payload bytes
+    HELLO    worker: uint16 protocol version, uint32 process id
+    CONFIG   coordinator: uint64 seed, uint32 rooms, uint8 movement, uint8 ghost policy,
+             uint8 lock backend, uint8 reserved, uint32 hunter wait, uint32 ghost wait,
+             uint32 evidence capacity, uint32 evidence ttl, uint32 pacing, uint32 room order,
+             char[DISTRIB_POLICY] hunter policy, char[DISTRIB_POLICY] ghost policy, each the
+             absolute path of a policy shared object, "random" or empty for random, uint32
+             hunters, then for every hunter of the roster char[MAX_STR] name, uint8 equipment,
+             uint32 start room, uint16 fear and uint16 boredom the hunter leaves at
+    JOB      coordinator: uint32 first run, uint32 runs
+    RESULTS  worker: uint32 first run, uint32 records, then the records
+    STOP     coordinator: no payload
+    record   seed u64, run u32, ghost u8, evidence mask u8, outcome u8, ghost boredom u16,
+             ghost turns u32, then per hunter exit u8, fear u16, boredom u16, turns u32
+*/
+
+#define DISTRIB_MAGIC    "GHDP"
+#define DISTRIB_VERSION  6
+#define DISTRIB_HEADER   12
+#define DISTRIB_RECORD   (21 + NUM_HUNTERS * 9)
+#define DISTRIB_POLICY   256
+#define DISTRIB_ROSTER   (40 + 2 * DISTRIB_POLICY)
+#define DISTRIB_SETTINGS (DISTRIB_ROSTER + 4)
+#define DISTRIB_HUNTER   (MAX_STR + 9)
+#define DISTRIB_PAYLOAD_MAX (1 << 28)
+
+enum DistribMessage { MSG_HELLO = 1, MSG_CONFIG, MSG_JOB, MSG_RESULTS, MSG_STOP };
+
+typedef struct {
+    uint32_t first;     // first run of the chunk
+    uint32_t runs;      // number of runs in the chunk
+    int      copies;    // workers running the chunk right now
+    int      done;      // set once its records arrived
+    uint64_t started;   // when its latest copy was handed out
+} DistribChunk;
+
+typedef struct {
+    int      fd;        // socket connected to the worker
+    pid_t    pid;       // process id the worker said hello with
+    int      chunk;     // chunk being run, -1 while idle
+    int      finished;  // chunks the worker finished
+} DistribWorker;
+
+/*
+    Little endian encoding and decoding of the integers of a message.
+*/
+static void putU16(uint8_t* p, uint16_t v) {
+    p[0] = v;
+    p[1] = v >> 8;
+}
+
+static void putU32(uint8_t* p, uint32_t v) {
+    putU16(p, v);
+    putU16(p + 2, v >> 16);
+}
+
+static void putU64(uint8_t* p, uint64_t v) {
+    putU32(p, v);
+    putU32(p + 4, v >> 32);
+}
+
+static uint16_t getU16(const uint8_t* p) {
+    return p[0] | (uint16_t) p[1] << 8;
+}
+
+static uint32_t getU32(const uint8_t* p) {
+    return getU16(p) | (uint32_t) getU16(p + 2) << 16;
+}
+
+static uint64_t getU64(const uint8_t* p) {
+    return getU32(p) | (uint64_t) getU32(p + 4) << 32;
+}
+
+/*
+    Writes all 'size' bytes to the socket 'fd', returns C_FALSE if the peer is gone.
+*/
+static int writeAll(int fd, const uint8_t* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = send(fd, data, size, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return C_FALSE;
+        }
+        data += n;
+        size -= n;
+    }
+    return C_TRUE;
+}
+
+/*
+    Reads exactly 'size' bytes from the socket 'fd', returns C_FALSE if the peer is gone.
+*/
+static int readAll(int fd, uint8_t* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = recv(fd, data, size, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return C_FALSE;
+        }
+        data += n;
+        size -= n;
+    }
+    return C_TRUE;
+}
+
+/*
+    Sends a message of type 'type' with a payload of 'size' bytes, returns C_FALSE if the peer
+    is gone.
+*/
+static int sendMessage(int fd, int type, const uint8_t* payload, uint32_t size) {
+    uint8_t header[DISTRIB_HEADER];
+
+    memcpy(header, DISTRIB_MAGIC, 4);
+    putU16(header + 4, type);
+    putU16(header + 6, 0);
+    putU32(header + 8, size);
+    return writeAll(fd, header, DISTRIB_HEADER) && (size == 0 || writeAll(fd, payload, size));
+}
+
+/*
+    Receives the next message into '*payload', growing it as needed. Returns the type of the
+    message, or 0 if the peer is gone or sent something that is not a message.
+*/
+static int receiveMessage(int fd, uint8_t** payload, uint32_t* capacity, uint32_t* size) {
+    uint8_t header[DISTRIB_HEADER];
+
+    if (!readAll(fd, header, DISTRIB_HEADER) || memcmp(header, DISTRIB_MAGIC, 4) != 0) {
+        return 0;
+    }
+    *size = getU32(header + 8);
+    if (*size > DISTRIB_PAYLOAD_MAX) {
+        return 0;
+    }
+    if (*size > *capacity) {
+        *payload = trackedRealloc(MEM_LOGGING, *payload, *capacity, *size);
+        *capacity = *size;
+    }
+    if (*size > 0 && !readAll(fd, *payload, *size)) {
+        return 0;
+    }
+    return getU16(header + 4);
+}
+
+/*
+    Packs the run record 'record' at 'p', returns the byte after it.
+*/
+static uint8_t* packRecord(uint8_t* p, RunRecord* record) {
+    putU64(p, record->seed);
+    putU32(p + 8, record->run);
+    p[12] = record->ghostClass;
+    p[13] = record->evidenceMask;
+    p[14] = record->outcome;
+    putU16(p + 15, record->ghostBoredom);
+    putU32(p + 17, record->ghostTurns);
+    p += 21;
+    for (int h = 0; h < NUM_HUNTERS; h++, p += 9) {
+        p[0] = record->hunterExit[h];
+        putU16(p + 1, record->hunterFear[h]);
+        putU16(p + 3, record->hunterBoredom[h]);
+        putU32(p + 5, record->hunterTurns[h]);
+    }
+    return p;
+}
+
+/*
+    Unpacks the run record at 'p' into 'record', returns the byte after it.
+*/
+static const uint8_t* unpackRecord(const uint8_t* p, RunRecord* record) {
+    memset(record, 0, sizeof(RunRecord));
+    record->seed = getU64(p);
+    record->run = getU32(p + 8);
+    record->ghostClass = p[12];
+    record->evidenceMask = p[13];
+    record->outcome = p[14];
+    record->ghostBoredom = getU16(p + 15);
+    record->ghostTurns = getU32(p + 17);
+    p += 21;
+    for (int h = 0; h < NUM_HUNTERS; h++, p += 9) {
+        record->hunterExit[h] = p[0];
+        record->hunterFear[h] = getU16(p + 1);
+        record->hunterBoredom[h] = getU16(p + 3);
+        record->hunterTurns[h] = getU32(p + 5);
+    }
+    return p;
+}
+
+/*
+    Packs the policy 'name' at 'p', as an absolute path so workers started elsewhere load the
+    same file. Leaves it empty for NULL, returns C_FALSE if the path cannot be sent.
+*/
+static int packPolicy(uint8_t* p, char* name) {
+    char resolved[PATH_MAX];
+
+    if (name == NULL) {
+        return C_TRUE;
+    }
+    if (!strcmp(name, "random")) {
+        strcpy((char*) p, name);
+        return C_TRUE;
+    }
+    if (realpath(name, resolved) == NULL) {
+        perror(name);
+        return C_FALSE;
+    }
+    if (strlen(resolved) >= DISTRIB_POLICY) {
+        fprintf(stderr, "%s: policy path too long to send to workers\n", resolved);
+        return C_FALSE;
+    }
+    strcpy((char*) p, resolved);
+    return C_TRUE;
+}
+
+/*
+    Packs the parts of 'options' and 'roster' a worker needs to run the batch, the whole roster
+    since each run plays its own slice of it. Returns the payload, allocated with its size in
+    'size', or NULL if the roster is too large to send or a policy cannot be sent.
+*/
+static uint8_t* packConfig(OptionsType* options, RosterType* roster, uint32_t* size) {
+    uint32_t hunters = roster->size;
+    uint8_t* p;
+
+    if (hunters > (DISTRIB_PAYLOAD_MAX - DISTRIB_SETTINGS) / DISTRIB_HUNTER) {
+        fprintf(stderr, "%s: a roster of %u hunters is too large to send to workers\n", options->coordinatePath, hunters);
+        return NULL;
+    }
+    *size = DISTRIB_SETTINGS + hunters * DISTRIB_HUNTER;
+    p = trackedCalloc(MEM_LOGGING, *size, 1);
+    if (!packPolicy(p + 40, options->hunterPolicy) || !packPolicy(p + 40 + DISTRIB_POLICY, options->ghostPolicy)) {
+        trackedFree(MEM_LOGGING, p, *size);
+        return NULL;
+    }
+    putU64(p, options->seed);
+    putU32(p + 8, options->rooms);
+    p[12] = options->movement;
+    p[13] = options->haunting;
+    p[14] = currentLockBackend();
+    putU32(p + 16, options->hunterWait);
+    putU32(p + 20, options->ghostWait);
+    putU32(p + 24, options->evidenceCapacity);
+    putU32(p + 28, options->evidenceTtl);
+    putU32(p + 32, options->pacing);
+    putU32(p + 36, options->roomOrder);
+    putU32(p + DISTRIB_ROSTER, hunters);
+    for (uint32_t h = 0; h < hunters; h++) {
+        uint8_t* q = p + DISTRIB_SETTINGS + h * DISTRIB_HUNTER;
+        memcpy(q, roster->hunters[h].name, MAX_STR);
+        q[MAX_STR] = roster->hunters[h].equipment;
+        putU32(q + MAX_STR + 1, roster->hunters[h].room);
+        putU16(q + MAX_STR + 5, roster->hunters[h].fearMax);
+        putU16(q + MAX_STR + 7, roster->hunters[h].boredomMax);
+    }
+    return p;
+}
+
+/*
+    Unpacks a configuration of 'size' bytes into 'options' and 'roster', returns C_FALSE if it
+    is malformed. Every enum, start room and threshold is checked the way the options and a
+    bulk roster are, since they index the worker's house and its tables.
+*/
+static int unpackConfig(const uint8_t* p, uint32_t size, OptionsType* options, RosterType* roster) {
+    uint32_t rooms, hunters;
+
+    if (size < DISTRIB_SETTINGS
+            || memchr(p + 40, '\0', DISTRIB_POLICY) == NULL || memchr(p + 40 + DISTRIB_POLICY, '\0', DISTRIB_POLICY) == NULL) {
+        return C_FALSE;
+    }
+    rooms = getU32(p + 8);
+    hunters = getU32(p + DISTRIB_ROSTER);
+    if (hunters == 0 || hunters > (size - DISTRIB_SETTINGS) / DISTRIB_HUNTER || rooms == 1 || rooms > INT32_MAX
+            || p[12] > MV_COLLECT || p[13] > GM_AVOID || p[14] >= LK_COUNT
+            || getU32(p + 24) > INT32_MAX || getU32(p + 32) > PC_ABSOLUTE || getU32(p + 36) > RO_RCM) {
+        return C_FALSE;
+    }
+    options->seed = getU64(p);
+    options->rooms = rooms;
+    options->movement = p[12];
+    options->haunting = p[13];
+    setLockBackend(lockBackendName(p[14]));
+    options->hunterWait = getU32(p + 16);
+    options->ghostWait = getU32(p + 20);
+    options->evidenceCapacity = getU32(p + 24);
+    options->evidenceTtl = getU32(p + 28);
+    options->pacing = getU32(p + 32);
+    options->roomOrder = getU32(p + 36);
+    for (uint32_t h = 0; h < hunters; h++) {
+        const uint8_t* q = p + DISTRIB_SETTINGS + h * DISTRIB_HUNTER;
+        uint32_t room = getU32(q + MAX_STR + 1);
+        char name[MAX_STR];
+
+        // Start rooms must be in the house the worker builds, and hunters must be able to leave
+        if ((q[MAX_STR] >= EV_COUNT && q[MAX_STR] != EV_UNKNOWN) || room >= (rooms > 0 ? rooms : STANDARD_ROOMS)
+                || getU16(q + MAX_STR + 5) == 0 || getU16(q + MAX_STR + 7) == 0) {
+            return C_FALSE;
+        }
+        memcpy(name, q, MAX_STR);
+        name[MAX_STR - 1] = '\0';
+        addHunterSpec(roster, name, q[MAX_STR]);
+        roster->hunters[h].room = room;
+        roster->hunters[h].fearMax = getU16(q + MAX_STR + 5);
+        roster->hunters[h].boredomMax = getU16(q + MAX_STR + 7);
+    }
+    return C_TRUE;
+}
+
+/*
+    Replaces the policies the worker loaded from its own command line with those named in the
+    unpacked configuration at 'p', returns C_FALSE if either cannot be loaded.
+*/
+static int switchPolicies(const uint8_t* p) {
+    char* hunters = (char*) p + 40;
+    char* ghosts = (char*) p + 40 + DISTRIB_POLICY;
+
+    unloadPolicies();
+    return (hunters[0] == '\0' || loadPolicy(PR_HUNTER, hunters, getU64(p)))
+        && (ghosts[0] == '\0' || loadPolicy(PR_GHOST, ghosts, getU64(p)));
+}
+
+/*
+    Creates the coordinator's socket at 'path', returns it or -1 on failure.
+*/
+static int listenSocket(char* path) {
+    struct sockaddr_un address = {.sun_family = AF_UNIX};
+    int fd;
+
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "%s: socket path too long\n", path);
+        return -1;
+    }
+    strcpy(address.sun_path, path);
+    unlink(path);
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || bind(fd, (struct sockaddr*) &address, sizeof(address)) != 0 || listen(fd, DISTRIB_WORKERS) != 0) {
+        perror(path);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    return fd;
+}
+
+/*
+    Connects to the coordinator's socket at 'path', returns it or -1 on failure.
+*/
+static int connectSocket(char* path) {
+    struct sockaddr_un address = {.sun_family = AF_UNIX};
+    int fd;
+
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "%s: socket path too long\n", path);
+        return -1;
+    }
+    strcpy(address.sun_path, path);
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr*) &address, sizeof(address)) != 0) {
+        perror(path);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    return fd;
+}
+
+/*
+    Hands the idle worker 'worker' the next chunk to run: a new chunk, then a chunk whose worker
+    left, then a second copy of the chunk running longest. Leaves the worker idle if every
+    chunk is done or already has a second copy running. Returns C_FALSE if the job could not
+    be sent, the chunk is then put back in the queue and the caller drops the worker.
+*/
+static int assignChunk(DistribWorker* worker, DistribWorker* workers, int workerCount, DistribChunk* chunks,
+        int chunkCount, int* nextChunk, int* requeued, int* requeueCount, int* duplicates) {
+    int chunk = -1;
+    uint8_t job[8];
+
+    // Chunks are handed out in order, and those lost with a worker go first once they return
+    while (*requeueCount > 0 && chunk < 0) {
+        int candidate = requeued[--(*requeueCount)];
+        if (!chunks[candidate].done && chunks[candidate].copies == 0) {
+            chunk = candidate;
+        }
+    }
+    if (chunk < 0 && *nextChunk < chunkCount) {
+        chunk = (*nextChunk)++;
+    }
+
+    // With nothing left to hand out, back up the chunk that has been running longest
+    if (chunk < 0) {
+        for (int i = 0; i < workerCount; i++) {
+            int candidate = workers[i].chunk;
+            if (candidate >= 0 && !chunks[candidate].done && chunks[candidate].copies == 1
+                    && (chunk < 0 || chunks[candidate].started < chunks[chunk].started)) {
+                chunk = candidate;
+            }
+        }
+        if (chunk < 0) {
+            return C_TRUE;
+        }
+        (*duplicates)++;
+    }
+
+    putU32(job, chunks[chunk].first);
+    putU32(job + 4, chunks[chunk].runs);
+    if (!sendMessage(worker->fd, MSG_JOB, job, sizeof(job))) {
+        // A backup copy is simply not made, anything else goes back in the queue
+        if (chunks[chunk].copies > 0) {
+            (*duplicates)--;
+        } else {
+            requeued[(*requeueCount)++] = chunk;
+        }
+        return C_FALSE;
+    }
+    chunks[chunk].copies++;
+    chunks[chunk].started = nowNanos();
+    worker->chunk = chunk;
+    return C_TRUE;
+}
+
+/*  Function: int runWorker(char* path)
+    Purpose: Connects to the coordinator listening on the socket at 'path', then runs the
+        chunks of runs it hands out and sends back their records until it stops the worker.
+        Returns C_TRUE if the coordinator stopped the worker and C_FALSE if it was lost
+*/
+int runWorker(char* path) {
+    OptionsType options;
+    RosterType roster;
+    RoutingType routing;
+    RunRecord record;
+    uint8_t hello[6];
+    uint8_t* payload = NULL;
+    uint8_t* results = NULL;
+    uint32_t capacity = 0, size = 0, resultCapacity = 0;
+    int fd = connectSocket(path);
+    int type;
+
+    if (fd < 0) {
+        return C_FALSE;
+    }
+
+    // Say hello and build the batch from the configuration sent back
+    putU16(hello, DISTRIB_VERSION);
+    putU32(hello + 2, getpid());
+    initOptions(&options);
+    initRoster(&roster);
+    if (!sendMessage(fd, MSG_HELLO, hello, sizeof(hello)) || receiveMessage(fd, &payload, &capacity, &size) != MSG_CONFIG
+            || !unpackConfig(payload, size, &options, &roster) || !switchPolicies(payload)) {
+        fprintf(stderr, "[WORKER] %d: no configuration from %s\n", getpid(), path);
+        close(fd);
+        trackedFree(MEM_LOGGING, payload, capacity);
+        cleanRoster(&roster);
+        return C_FALSE;
+    }
+    setLogging(C_FALSE);
+    prepareRouting(&options, &routing);
+
+    // Run each chunk and answer with its records packed together
+    while ((type = receiveMessage(fd, &payload, &capacity, &size)) == MSG_JOB && size >= 8) {
+        uint32_t first = getU32(payload);
+        uint32_t runs = getU32(payload + 4);
+        uint8_t* p;
+
+        if (8 + (size_t) runs * DISTRIB_RECORD > resultCapacity) {
+            results = trackedRealloc(MEM_LOGGING, results, resultCapacity, 8 + runs * DISTRIB_RECORD);
+            resultCapacity = 8 + runs * DISTRIB_RECORD;
+        }
+        putU32(results, first);
+        putU32(results + 4, runs);
+        p = results + 8;
+        for (uint32_t i = 0; i < runs; i++) {
+            runSimulation(&options, &roster, &routing, NULL, options.seed + first + i, first + i, &record, C_FALSE);
+            p = packRecord(p, &record);
+        }
+        if (!sendMessage(fd, MSG_RESULTS, results, p - results)) {
+            type = receiveMessage(fd, &payload, &capacity, &size);  // a stop sent before the coordinator hung up
+            break;
+        }
+    }
+
+    close(fd);
+    trackedFree(MEM_LOGGING, payload, capacity);
+    trackedFree(MEM_LOGGING, results, resultCapacity);
+    cleanRoster(&roster);
+    cleanRouting(&routing);
+    return type == MSG_STOP;
+}
+
+/*  Function: int runCoordinator(OptionsType* options, RosterType* roster, ResultWriter* writer)
+    Purpose: Runs the batch described by 'options' on worker processes, listening for them on the
+        socket options->coordinatePath and forking options->workers of them locally. Records are
+        written to 'writer' as their chunks finish, or summarised on the console when 'writer' is
+        NULL. Returns C_TRUE once every run finished and C_FALSE if the batch could not complete
+*/
+int runCoordinator(OptionsType* options, RosterType* roster, ResultWriter* writer) {
+    int chunkCount = (options->runs + options->chunkRuns - 1) / options->chunkRuns;
+    DistribChunk* chunks = trackedCalloc(MEM_AGENTS, chunkCount, sizeof(DistribChunk));
+    DistribWorker workers[DISTRIB_WORKERS];
+    struct pollfd fds[DISTRIB_WORKERS + 1];
+    int* requeued = trackedMalloc(MEM_AGENTS, chunkCount * sizeof(int));
+    pid_t* children = trackedMalloc(MEM_AGENTS, (options->workers + 1) * sizeof(pid_t));
+    uint32_t configSize = 0;
+    uint8_t* config = packConfig(options, roster, &configSize);
+    uint8_t* payload = NULL;
+    uint32_t capacity = 0, size = 0;
+    int workerCount = 0, nextChunk = 0, requeueCount = 0, done = 0, runsDone = 0, joined = 0;
+    int lost = 0, duplicates = 0, hunterWins = 0;
+    uint64_t start = nowNanos();
+    int listener = (config != NULL) ? listenSocket(options->coordinatePath) : -1;
+
+    if (listener < 0) {
+        trackedFree(MEM_AGENTS, chunks, chunkCount * sizeof(DistribChunk));
+        trackedFree(MEM_AGENTS, requeued, chunkCount * sizeof(int));
+        trackedFree(MEM_AGENTS, children, (options->workers + 1) * sizeof(pid_t));
+        trackedFree(MEM_LOGGING, config, configSize);
+        return C_FALSE;
+    }
+    for (int i = 0; i < chunkCount; i++) {
+        chunks[i].first = i * options->chunkRuns;
+        chunks[i].runs = (i == chunkCount - 1) ? options->runs - chunks[i].first : (uint32_t) options->chunkRuns;
+    }
+
+    // Local workers connect over the socket like any other
+    fflush(stdout);
+    for (int i = 0; i < options->workers; i++) {
+        children[i] = fork();
+        if (children[i] == 0) {
+            close(listener);
+            _exit(runWorker(options->coordinatePath) ? 0 : 1);
+        }
+    }
+
+    while (done < chunkCount) {
+        int ready;
+
+        // A batch that forked its workers cannot finish once all of them are gone
+        if (options->workers > 0 && joined > 0 && workerCount == 0) {
+            fprintf(stderr, "[COORDINATOR] every worker left with %d chunks unfinished\n", chunkCount - done);
+            break;
+        }
+        fds[0].fd = listener;
+        fds[0].events = POLLIN;
+        for (int i = 0; i < workerCount; i++) {
+            fds[i + 1].fd = workers[i].fd;
+            fds[i + 1].events = POLLIN;
+        }
+        ready = poll(fds, workerCount + 1, -1);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("poll");
+            break;
+        }
+
+        // Welcome new workers, they are configured once they say hello
+        if (fds[0].revents & POLLIN) {
+            int fd = accept(listener, NULL, NULL);
+            if (fd >= 0 && workerCount == DISTRIB_WORKERS) {
+                close(fd);
+            } else if (fd >= 0) {
+                workers[workerCount].fd = fd;
+                workers[workerCount].pid = 0;
+                workers[workerCount].chunk = -1;
+                workers[workerCount].finished = 0;
+                workerCount++;
+                joined++;
+            }
+        }
+
+        // Walk the workers backwards so the ones that leave can be swapped out in place
+        for (int i = workerCount - 1; i >= 0; i--) {
+            DistribWorker* worker = &workers[i];
+            int type;
+
+            if (!(fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR))) {
+                continue;
+            }
+            type = receiveMessage(worker->fd, &payload, &capacity, &size);
+
+            if (type == MSG_HELLO && size >= 6 && getU16(payload) == DISTRIB_VERSION) {
+                worker->pid = getU32(payload + 2);
+                if (sendMessage(worker->fd, MSG_CONFIG, config, configSize)
+                        && assignChunk(worker, workers, workerCount, chunks, chunkCount, &nextChunk, requeued, &requeueCount, &duplicates)) {
+                    continue;
+                }
+            } else if (type == MSG_RESULTS && size >= 8 && worker->chunk >= 0) {
+                DistribChunk* chunk = &chunks[worker->chunk];
+                const uint8_t* p = payload + 8;
+
+                if (getU32(payload) == chunk->first && getU32(payload + 4) == chunk->runs
+                        && size == 8 + chunk->runs * DISTRIB_RECORD) {
+                    // Only the first copy of a chunk to finish is kept
+                    if (!chunk->done) {
+                        for (uint32_t r = 0; r < chunk->runs; r++) {
+                            RunRecord record;
+                            p = unpackRecord(p, &record);
+                            hunterWins += record.outcome;
+                            if (writer != NULL) {
+                                writeResult(writer, &record);
+                            }
+                        }
+                        chunk->done = C_TRUE;
+                        runsDone += chunk->runs;
+                        done++;
+                    }
+                    chunk->copies--;
+                    worker->chunk = -1;
+                    worker->finished++;
+                    if (assignChunk(worker, workers, workerCount, chunks, chunkCount, &nextChunk, requeued, &requeueCount, &duplicates)) {
+                        continue;
+                    }
+                }
+            }
+
+            // The worker left or broke the protocol, its chunk goes back in the queue
+            if (worker->chunk >= 0) {
+                DistribChunk* chunk = &chunks[worker->chunk];
+                chunk->copies--;
+                if (!chunk->done && chunk->copies == 0) {
+                    requeued[requeueCount++] = worker->chunk;
+                }
+                printf("[COORDINATOR] worker %d left, runs %u to %u requeued\n", worker->pid, chunk->first, chunk->first + chunk->runs - 1);
+                lost++;
+            }
+            close(worker->fd);
+            workers[i] = workers[--workerCount];
+
+            // Idle workers can pick up the returned chunk straight away, one that cannot be sent
+            // its job is shut down so the next poll drops it like any worker that left
+            for (int j = 0; j < workerCount; j++) {
+                if (workers[j].chunk < 0 && workers[j].pid != 0
+                        && !assignChunk(&workers[j], workers, workerCount, chunks, chunkCount, &nextChunk, requeued, &requeueCount, &duplicates)) {
+                    shutdown(workers[j].fd, SHUT_RDWR);
+                }
+            }
+        }
+    }
+
+    // Stop every worker, local ones still running a copy that lost the race are not waited for
+    for (int i = 0; i < workerCount; i++) {
+        sendMessage(workers[i].fd, MSG_STOP, NULL, 0);
+        for (int c = 0; c < options->workers && workers[i].chunk >= 0; c++) {
+            if (children[c] == workers[i].pid) {
+                kill(children[c], SIGKILL);
+            }
+        }
+        close(workers[i].fd);
+    }
+    for (int i = 0; i < options->workers; i++) {
+        if (children[i] > 0) {
+            waitpid(children[i], NULL, 0);
+        }
+    }
+    close(listener);
+    unlink(options->coordinatePath);
+
+    printf("[COORDINATOR] %d of %d runs in %d chunks on %d workers, %.2f s, hunters won %d, %d chunks requeued, %d run twice\n",
+        runsDone, options->runs, chunkCount, joined,
+        (nowNanos() - start) / 1e9, hunterWins, lost, duplicates);
+
+    trackedFree(MEM_AGENTS, chunks, chunkCount * sizeof(DistribChunk));
+    trackedFree(MEM_AGENTS, requeued, chunkCount * sizeof(int));
+    trackedFree(MEM_AGENTS, children, (options->workers + 1) * sizeof(pid_t));
+    trackedFree(MEM_LOGGING, payload, capacity);
+    trackedFree(MEM_LOGGING, config, configSize);
+    return done == chunkCount;
+}
@@ -2,26 +2,45 @@
 
 /*Function: void initEvidenceList(EvidenceList* list)
   Purpose:  Initializes the evidence list struct found at the pointer 'list'. Sets head 
-        and tail of list to be NULL and initalizes a semaphore
+        and tail of list to be NULL and initalizes a lock
 */
 void initEvidenceList(EvidenceList* list) {
     list->head = NULL;              // Set head of list to null
     list->tail = NULL;              // Set tail of list to null
+    list->size = 0;                 // Set list to be empty
     list->sufficentEv = C_FALSE;    // Set initial evidence to be insufficient
-    sem_init(&(list->sem), 0, 1);   //initialize semaphore
+    initLock(&(list->lock));        //initialize lock
 };
 
-/*Function: void addEvidence(EvidenceList* list, EvidenceType evidence)
+/*
+    Lets go of a node taken out of its list: scheduled evidence stays allocated until the
+    timing wheel reaches it, anything else is freed now.
+*/
+static void dropEvidence(EvidenceNode* node) {
+    if (node->timed) {
+        node->collected = C_TRUE;
+    } else {
+        trackedFree(MEM_EVIDENCE, node, sizeof(EvidenceNode));
+    }
+}
+
+/*Function: EvidenceNode* addEvidence(EvidenceList* list, EvidenceType evidence)
   Purpose:  Allocates memory in the heap for an Evidence Node, sets the data of node to be the
-        provided 'evidence', adds node to back of linked list found at the pointer 'list'
+        provided 'evidence', adds node to back of linked list found at the pointer 'list'.
+        Returns the new node
 */
-void addEvidence(EvidenceList* list, EvidenceType evidence) {
+EvidenceNode* addEvidence(EvidenceList* list, EvidenceType evidence) {
     // Allocate memory on heap for node structure
-    EvidenceNode* new = malloc(sizeof(EvidenceNode));
+    EvidenceNode* new = trackedMalloc(MEM_EVIDENCE, sizeof(EvidenceNode));
 
     // Initalize fields of the node
     new->data = evidence;
     new->next = NULL;
+    new->room = NULL;
+    new->wheelNext = NULL;
+    new->expires = 0;
+    new->timed = C_FALSE;
+    new->collected = C_FALSE;
     
     // Add new node to back of the list    
     if (list->head == NULL) {
@@ -31,6 +50,53 @@ void addEvidence(EvidenceList* list, EvidenceType evidence) {
         list->tail->next = new;
         list->tail = new;
     }
+    list->size++;
+    return new;
+}
+
+/*  Function: int trimEvidence(EvidenceList* list, int capacity)
+    Purpose: Drops the oldest evidence of the list at the pointer 'list' until it holds at
+        most 'capacity' nodes, a capacity of 0 means no limit. Returns the number dropped
+*/
+int trimEvidence(EvidenceList* list, int capacity) {
+    int dropped = 0;
+
+    while (capacity > 0 && list->size > capacity) {
+        EvidenceNode* oldest = list->head;
+        list->head = oldest->next;
+        if (list->head == NULL) {
+            list->tail = NULL;
+        }
+        list->size--;
+        dropEvidence(oldest);
+        dropped++;
+    }
+    return dropped;
+}
+
+/*  Function: int unlinkEvidence(EvidenceList* list, EvidenceNode* node)
+    Purpose: Takes the node 'node' out of the list at the pointer 'list' without freeing it,
+        returns C_FALSE if the node is not in the list
+*/
+int unlinkEvidence(EvidenceList* list, EvidenceNode* node) {
+    EvidenceNode* previous = NULL;
+
+    for (EvidenceNode* current = list->head; current != NULL; current = current->next) {
+        if (current == node) {
+            if (previous == NULL) {
+                list->head = node->next;
+            } else {
+                previous->next = node->next;
+            }
+            if (list->tail == node) {
+                list->tail = previous;
+            }
+            list->size--;
+            return C_TRUE;
+        }
+        previous = current;
+    }
+    return C_FALSE;
 }
 
 /*  Function: int removeEvidence(EvidenceList* list, enum EvidenceType equipment)
@@ -57,7 +123,8 @@ int removeEvidence(EvidenceList* list, enum EvidenceType equipment) {
             } else {                            // all other conditions
                 previous->next = current->next;
             }
-            free(current);
+            list->size--;
+            dropEvidence(current);
             return C_TRUE;
         } else {
             previous = current;
@@ -93,6 +160,43 @@ enum EvidenceType pickEvidence(enum GhostClass class) {
     }
 };
 
+/*  Function: int evidenceMask(EvidenceList* list)
+    Purpose: Returns a bit mask with bit (1 << type) set for every evidence type found in
+        the evidence list at the pointer 'list'
+*/
+int evidenceMask(EvidenceList* list) {
+    int mask = 0;
+
+    // Loop over list and record each evidence type
+    for (EvidenceNode* current = list->head; current != NULL; current = current->next) {
+        mask |= 1 << current->data;
+    }
+    return mask;
+}
+
+/*  Function: void expireEvidence(HouseType* house)
+    Purpose: Advances the evidence timing wheel of the house at the pointer 'house' by one tick,
+        taking every piece of evidence that expires out of its room and freeing it
+*/
+void expireEvidence(HouseType* house) {
+    EvidenceNode* current = advanceWheel(&(house->evidenceWheel));
+
+    while (current != NULL) {
+        EvidenceNode* next = current->wheelNext;
+
+        // Evidence still lying in its room is removed under the room's lock
+        RoomType* room = current->room;
+        EvidenceList* list = evidenceIn(house, room);
+        acquireLock(&(list->lock));
+        if (!current->collected && unlinkEvidence(list, current)) {
+            setRoomEvidence(house, room, evidenceMask(list));
+        }
+        releaseLock(&(list->lock));
+        trackedFree(MEM_EVIDENCE, current, sizeof(EvidenceNode));
+        current = next;
+    }
+}
+
 /*Function: void cleanEvidenceList(EvidenceList* list)
   Purpose:  Frees all the allocated memory in the heap for the nodes of the evidence list 
         type at the memory address 'list'
@@ -105,6 +209,7 @@ void cleanEvidenceList(EvidenceList* list) {
     while (current != NULL) {
         temp = current;
         current = current->next;
-        free(temp);
+        trackedFree(MEM_EVIDENCE, temp, sizeof(EvidenceNode));
     }
+    cleanLock(&(list->lock));
 }
\ No newline at end of file
@@ -7,18 +7,26 @@
 */
 void initGhost(HouseType* house, GhostType** ghost) {
     //Allocate space for the ghost on the heap
-    *ghost = malloc(sizeof(GhostType));
+    *ghost = allocAgent(sizeof(GhostType));
+    countAlloc(MEM_AGENTS, sizeof(GhostType));
 
     // Initalize all the fields of the ghost
+    (*ghost)->id = 0;
     (*ghost)->room = randomRoom(&(house->rooms), 1);
-    (*ghost)->room->ghost = *ghost;
+    setRoomGhost(house, (*ghost)->room, C_TRUE);
     (*ghost)->type = randomGhost();
     (*ghost)->boredom = 0;
+    (*ghost)->turns = 0;
+    (*ghost)->seed = 0;
+    (*ghost)->termination = &(house->termination);
+    (*ghost)->house = house;
+    (*ghost)->stats = NULL;
+    memset(&((*ghost)->pacer), 0, sizeof(PacerType));
     
     // Add ghost to the house
     house->ghost = *ghost;
 
-    l_ghostInit((*ghost)->type, (*ghost)->room->name);
+    l_ghostInit((*ghost)->type, nameOf((*ghost)->room->name));
 }
 
 /*  Function: enum GhostClass randomGhost()
@@ -31,13 +39,30 @@ enum GhostClass randomGhost() {
 /*  Function: void *runGhost(void *ptr)
     Purpose: Function that simulates a ghost interacting with a house type structure, ghost
         found at 'ptr' will randomly move rooms, leave evidence, or do nothing. Function ends
-        when ghost gets bored (i.e., boredom increases when ghost isn't in a room with a hunter)  
+        when ghost gets bored (i.e., boredom increases when ghost isn't in a room with a hunter)
+        or as soon as every hunter has left, since nothing it does can change the outcome
 */
 void *runGhost(void* ptr) {
     GhostType* ghost = (GhostType*) ptr;
-
-    // While the ghost isnt bored
-    while (ghost->boredom < BOREDOM_MAX) {
+    pinAgent(ghost->id, ghost, sizeof(GhostType));
+    seedRandom(ghost->seed);
+
+    // While the ghost isnt bored and hunters are still in the house
+    while (ghost->boredom < BOREDOM_MAX && !simulationStopped(ghost->termination)) {
+        uint64_t start = 0, lockStart = 0;
+        ObservationType observation;
+        uint8_t action;
+        if (ghost->house->branchTurn > 0 && ghost->turns == ghost->house->branchTurn) {
+            branchEvent(ghost->house);
+        }
+        parkAgent(ghost->house);                // Wait here while the house is paused for branching
+        if (ghost->stats != NULL) {
+            start = nowNanos();
+            lockStart = lockWaitNanos();
+        }
+        ghost->turns++;
+        TRACE4(ghost__turn, ghost->id, ghost->room->id, EV_UNKNOWN, ghost->turns);
+        expireEvidence(ghost->house);           // Age the evidence in the house by one turn
 
         // If ghost is with hunter, set boredom to 0, otherwise increment
         if (ghostWithHunter(ghost)) {
@@ -46,8 +71,10 @@ void *runGhost(void* ptr) {
             ghost->boredom++;
         }
         
-        // Randomly select action, call corresponding function
-        switch (randomGhostAction()) {
+        // Let the ghost policy choose an action, call corresponding function
+        observeGhost(ghost, &observation);
+        decideGhosts(&observation, 1, &action);
+        switch (action) {
             case MOVE_ROOMS:
                 moveGhostRooms(ghost);
                 break;
@@ -58,15 +85,22 @@ void *runGhost(void* ptr) {
                 break;
         }
         
-        // Sleep at the end of turn
-        usleep(GHOST_WAIT);
+        // Sleep at the end of turn, waking early if the simulation stops
+        if (ghost->stats != NULL) {
+            recordTurn(ghost->stats, nowNanos() - start, lockWaitNanos() - lockStart);
+        }
+        if (ghost->house->sampler != NULL && ghost->house->sampler->intervalTurns > 0
+            && ghost->turns % ghost->house->sampler->intervalTurns == 0) {
+            takeSample(ghost->house->sampler);  // Sample the house every few ghost turns
+        }
+        paceTurn(ghost->termination, &(ghost->pacer), ghost->house->ghostWait, ghost->house->pacing);
     }
 
-    // If ghost bored exit the thread
-    sem_wait(&(ghost->room->sem));
-    ghost->room->ghost = NULL;
-    l_ghostExit(LOG_BORED);
-    sem_post(&(ghost->room->sem));
+    // If ghost bored or the house is empty exit the thread
+    setRoomGhost(ghost->house, ghost->room, C_FALSE);
+    TRACE4(ghost__exit, ghost->id, ghost->room->id, EV_UNKNOWN, ghost->boredom >= BOREDOM_MAX ? LOG_BORED : LOG_EMPTY);
+    l_ghostExit(ghost->boredom >= BOREDOM_MAX ? LOG_BORED : LOG_EMPTY);
+    ghostLeft(ghost->termination);
     pthread_exit(NULL);
 }
 
@@ -76,7 +110,7 @@ void *runGhost(void* ptr) {
 */
 int ghostWithHunter(GhostType* ghost) {
     // If there are more than 0 hunters return true
-    if (ghost->room->hunters.size > 0) {
+    if (roomOccupancy(ghost->house, ghost->room) > 0) {
         return C_TRUE;
     }
     // otherwise, return false
@@ -91,52 +125,88 @@ enum GhostActions randomGhostAction() {
     return (enum GhostActions) randInt(0, GA_COUNT);
 }
 
+/*  Function: RoomType* chooseGhostRoom(GhostType* ghost)
+    Purpose: Returns the connected room the ghost moves to. Ghosts wander at random unless the
+            house keeps a proximity index, then they move to the connected room with the most
+            (seek) or fewest (avoid) hunters within PROXIMITY_HOPS hops, breaking ties at random
+*/
+RoomType* chooseGhostRoom(GhostType* ghost) {
+    HouseType* house = ghost->house;
+    RoomType* best = NULL;
+    int bestCount = 0;
+    int ties = 0;
+
+    if (house == NULL || house->nearby == NULL || house->haunting == GM_RANDOM) {
+        return randomRoom(&(ghost->room->connectedRooms), 0);
+    }
+
+    // Score every connected room by the hunters near it
+    for (RoomNode* current = ghost->room->connectedRooms.head; current != NULL; current = current->next) {
+        int count = huntersWithin(house, current->data->id, PROXIMITY_HOPS);
+        if (house->haunting == GM_AVOID) {
+            count = -count;
+        }
+        if (best == NULL || count > bestCount) {
+            best = current->data;
+            bestCount = count;
+            ties = 1;
+        } else if (count == bestCount && randInt(0, ++ties) == 0) {
+            best = current->data;
+        }
+    }
+    return best;
+}
+
 /*  Function: void moveGhostRooms(GhostType* ghost)
-    Purpose: Moves the ghost pointer from their current room to a random room from the 
-            avialable connected rooms, logs that the ghost moved
+    Purpose: Moves the ghost pointer from their current room to a room chosen by
+            chooseGhostRoom from the avialable connected rooms, logs that the ghost moved
 */
 void moveGhostRooms(GhostType* ghost) {
     // Store the old and new room pointers
     RoomType* oldRoom = ghost->room;
-    RoomType* newRoom = randomRoom(&(ghost->room->connectedRooms), 0);
-
-    // Wait semaphore until ghost has moved rooms
-    if (&(oldRoom->sem) > &(newRoom->sem)) {
-        sem_wait(&(oldRoom->sem));
-        sem_wait(&(newRoom->sem));
-    } else {
-        sem_wait(&(newRoom->sem));
-        sem_wait(&(oldRoom->sem));
-    }
-
-    ghost->room->ghost = NULL;      // Set old room ghost pointer to null
-    ghost->room = newRoom;          // assign new room
-    ghost->room->ghost = ghost;     // Set new room ghost pointer to ghost
-    l_ghostMove(ghost->room->name); // Log that ghost moved
+    RoomType* newRoom = chooseGhostRoom(ghost);
 
-    // Post the semaphore now that the ghost has moved
-    if (&(oldRoom->sem) > &(newRoom->sem)) {
-        sem_post(&(oldRoom->sem));
-        sem_post(&(newRoom->sem));
-    } else {
-        sem_post(&(newRoom->sem));
-        sem_post(&(oldRoom->sem));
-    }
+    setRoomGhost(ghost->house, newRoom, C_TRUE);  // Set ghost flag of new room
+    ghost->room = newRoom;                        // assign new room
+    setRoomGhost(ghost->house, oldRoom, C_FALSE); // Clear ghost flag of old room
+    TRACE4(ghost__move, ghost->id, newRoom->id, EV_UNKNOWN, oldRoom->id);
+    l_ghostMove(nameOf(newRoom->name));     // Log that ghost moved
 };
 
 /*  Function: void leaveEvidence(GhostType* ghost)
     Purpose: Selects a random evidence type, adds the evidence to the room's list of
-            evidence and logs that evidence was left
+            evidence and logs that evidence was left. A full room drops its oldest evidence,
+            and evidence expires after the house's evidence lifetime if it has one
 */
 void leaveEvidence(GhostType* ghost) {
     // Pick evidence to leave based on ghost type
     EvidenceType evidence = pickEvidence(ghost->type);
+    HouseType* house = ghost->house;
+    EvidenceList* roomList = evidenceIn(house, ghost->room);
+    EvidenceNode* node;
+
+    // Add evidence to the room, marked as timed before any hunter can collect it
+    acquireLock(&(roomList->lock));
+    node = addEvidence(roomList, evidence);
+    node->room = ghost->room;
+    node->timed = (house->evidenceTtl > 0);
+    if (trimEvidence(roomList, house->evidenceCapacity) > 0) {
+        setRoomEvidence(house, ghost->room, evidenceMask(roomList));
+    } else {
+        setRoomEvidence(house, ghost->room, roomEvidence(house, ghost->room) | (1 << evidence));
+    }
+    releaseLock(&(roomList->lock));
+    TRACE(ghost__evidence, ghost->id, ghost->room->id, evidence);
 
-    // Add evidence to the room
-    sem_wait(&(ghost->room->evidence.sem));
-    addEvidence(&(ghost->room->evidence), evidence); 
-    sem_post(&(ghost->room->evidence.sem));
+    // Only this thread touches the wheel, so the node can be filed outside the lock
+    if (node->timed) {
+        scheduleEvidence(&(house->evidenceWheel), node, house->evidenceTtl);
+    }
+    atomic_store_explicit(&(house->lastEvidence), ghost->room->id, memory_order_relaxed);
+    if (house->branchTurn == 0) {
+        branchEvent(house);
+    }
 
     // Log that evidence was added
-    l_ghostEvidence(evidence, ghost->room->name);
+    l_ghostEvidence(evidence, nameOf(ghost->room->name));
 }
\ No newline at end of file
@@ -1,20 +1,116 @@
 #include "defs.h"
 
-/*  Function: void initHouse(HouseType* house)
-    Purpose: Initializes a house structure found at the pointer house, initializes
-        hunter, rooms, and evidence lists
+/*
+    A house is split in two. The topology, every room with its name and connections, is built
+    once, never written after and can be shared by any number of runs at the same time. Each
+    run's house holds only what the run changes: the hot state word and the evidence list of
+    every room, indexed by room id, next to the agents and the shared evidence. The per room
+    arrays are calloc'd, so a run only touches the pages of rooms its agents reach, and a
+    room's evidence list is only allocated once evidence is first left in it.
+*/
+
+/*  Function: void initHouse(HouseType* house, int rooms, enum RoomOrder order)
+    Purpose: Initializes a house structure found at the pointer house on a topology of its
+        own. Builds the standard house when 'rooms' is 0, otherwise generates a house with
+        that many rooms, and numbers the rooms in 'order'
+*/
+void initHouse(HouseType* house, int rooms, enum RoomOrder order) {
+    TopologyType* topology = createTopology(rooms, order);
+
+    initSharedHouse(house, topology);
+    releaseTopology(topology);              // The house now holds the only reference
+}
+
+/*  Function: TopologyType* createTopology(int rooms, enum RoomOrder order)
+    Purpose: Allocates the rooms of a house and returns them as a topology held by the caller
+        until released. Builds the standard house when 'rooms' is 0, otherwise generates a
+        house with that many rooms, and numbers the rooms in 'order'
+*/
+TopologyType* createTopology(int rooms, enum RoomOrder order) {
+    TopologyType* topology = trackedMalloc(MEM_TOPOLOGY, sizeof(TopologyType));
+
+    initRoomList(&(topology->rooms));
+    topology->createdRooms = NULL;
+    atomic_init(&(topology->users), 1);
+
+    // Populate the rooms
+    if (rooms > 0) {
+        generateRooms(&(topology->rooms), rooms);
+    } else {
+        populateRooms(&(topology->rooms));
+    }
+    indexRooms(topology);                   // Assign ids to the rooms
+    topology->roomOrder = order;
+    orderRooms(topology, order);            // Renumber and move the rooms if requested
+    return topology;
+}
+
+/*  Function: void initSharedHouse(HouseType* house, TopologyType* topology)
+    Purpose: Initializes a house structure found at the pointer house on the rooms of
+        'topology', which it holds until cleaned up, with hunter and evidence lists and
+        empty room state of its own
 */
-void initHouse(HouseType* house) {
+void initSharedHouse(HouseType* house, TopologyType* topology) {
+    atomic_fetch_add(&(topology->users), 1);
+    house->topology = topology;
+    house->rooms = topology->rooms;
+    house->roomById = topology->roomById;
+    house->roomCount = topology->roomCount;
+    house->roomHot = trackedCalloc(MEM_TOPOLOGY, house->roomCount, sizeof(RoomHot));
+    house->roomEvidence = trackedCalloc(MEM_EVIDENCE, house->roomCount, sizeof(_Atomic(EvidenceList*)));
+
     initHunterArray(&(house->hunters));     // Initialize hunter array
-    initRoomList(&(house->rooms));          // Initialize room list
     initEvidenceList(&(house->evidence));   // Initialize evidence list
-    populateRooms(house);                   // Populate the rooms
+    house->ghost = NULL;
+    initTermination(&(house->termination), 0);
+    house->routing = NULL;
+    house->movement = MV_RANDOM;
+    house->haunting = GM_RANDOM;
+    house->nearby = NULL;
+    house->clusterEvidence = NULL;
+    house->hunterWait = HUNTER_WAIT;
+    house->ghostWait = GHOST_WAIT;
+    house->pacing = PC_RELATIVE;
+    house->evidenceCapacity = EVIDENCE_CAPACITY;
+    house->evidenceTtl = 0;
+    initWheel(&(house->evidenceWheel));
+    for (int i = 0; i < EV_COUNT; i++) {
+        atomic_init(&(house->collected[i]), 0);
+        atomic_init(&(house->evidenceRooms[i]), 0);
+    }
+    house->sampler = NULL;
+    house->branching = C_FALSE;
+    house->branchTurn = 0;
+    atomic_init(&(house->branched), C_FALSE);
+    atomic_init(&(house->pausing), C_FALSE);
+    atomic_init(&(house->parked), 0);
+    atomic_init(&(house->lastEvidence), ROOM_NONE);
+}
+
+/*  Function: void releaseTopology(TopologyType* topology)
+    Purpose: Lets go of one reference to the topology at the pointer 'topology', freeing its
+        rooms once neither its creator nor any house holds it
+*/
+void releaseTopology(TopologyType* topology) {
+    if (atomic_fetch_sub(&(topology->users), 1) != 1) {
+        return;
+    }
+
+    // Free the connected rooms of every room, then the rooms and their index
+    for (RoomNode* current = topology->rooms.head; current != NULL; current = current->next) {
+        cleanRoomList(&(current->data->connectedRooms));
+    }
+    cleanRoomData(&(topology->rooms));
+    cleanRoomList(&(topology->rooms));
+    trackedFree(MEM_TOPOLOGY, topology->roomById, topology->roomCount * sizeof(RoomType*));
+    trackedFree(MEM_TOPOLOGY, topology->createdRooms, topology->roomCount * sizeof(RoomId));
+    trackedFree(MEM_TOPOLOGY, topology, sizeof(TopologyType));
 }
 
 /*
-    Dynamically allocates several rooms and populates the provided house.
+    Dynamically allocates several rooms and adds them to the provided room list.
 */
-void populateRooms(HouseType* house) {
+void populateRooms(RoomList* list) {
     // First, create each room
     struct Room* van                = createRoom("Van");
     struct Room* hallway            = createRoom("Hallway");
@@ -45,43 +141,126 @@ void populateRooms(HouseType* house) {
     connectRooms(kitchen, garage);
     connectRooms(garage, utility_room);
 
-    // Add each room to the house's room list
-    addRoom(&house->rooms, van);
-    addRoom(&house->rooms, hallway);
-    addRoom(&house->rooms, master_bedroom);
-    addRoom(&house->rooms, boys_bedroom);
-    addRoom(&house->rooms, bathroom);
-    addRoom(&house->rooms, basement);
-    addRoom(&house->rooms, basement_hallway);
-    addRoom(&house->rooms, right_storage_room);
-    addRoom(&house->rooms, left_storage_room);
-    addRoom(&house->rooms, kitchen);
-    addRoom(&house->rooms, living_room);
-    addRoom(&house->rooms, garage);
-    addRoom(&house->rooms, utility_room);
+    // Add each room to the list
+    addRoom(list, van);
+    addRoom(list, hallway);
+    addRoom(list, master_bedroom);
+    addRoom(list, boys_bedroom);
+    addRoom(list, bathroom);
+    addRoom(list, basement);
+    addRoom(list, basement_hallway);
+    addRoom(list, right_storage_room);
+    addRoom(list, left_storage_room);
+    addRoom(list, kitchen);
+    addRoom(list, living_room);
+    addRoom(list, garage);
+    addRoom(list, utility_room);
+}
+
+/*  Function: void generateRooms(RoomList* list, int count)
+    Purpose: Dynamically allocates 'count' rooms, starting with the van, and adds them to the
+        room list at the pointer 'list'. Each new room is connected to a random nearby earlier room so the house
+        is always connected, every fourth room gets a second connection to form loops
+*/
+void generateRooms(RoomList* list, int count) {
+    char name[MAX_STR];
+    RoomType** rooms = trackedMalloc(MEM_TOPOLOGY, count * sizeof(RoomType*));
+
+    // Create each room and connect it to the rooms created before it
+    rooms[0] = createRoom("Van");
+    addRoom(list, rooms[0]);
+    for (int i = 1; i < count; i++) {
+        sprintf(name, "Room %d", i);
+        rooms[i] = createRoom(name);
+        addRoom(list, rooms[i]);
+
+        // Only the first room connects to the van
+        if (i == 1) {
+            connectRooms(rooms[0], rooms[1]);
+        } else {
+            connectRooms(rooms[randInt(i > 16 ? i - 16 : 1, i)], rooms[i]);
+        }
+        if (i > 2 && i % 4 == 0) {
+            connectRooms(rooms[randInt(i > 64 ? i - 64 : 1, i - 1)], rooms[i]);
+        }
+    }
+    trackedFree(MEM_TOPOLOGY, rooms, count * sizeof(RoomType*));
+}
+
+/*  Function: void indexRooms(TopologyType* topology)
+    Purpose: Numbers the rooms of the topology in list order and allocates the table of
+        rooms by id
+*/
+void indexRooms(TopologyType* topology) {
+    RoomId id = 0;
+
+    topology->roomCount = topology->rooms.size;
+    topology->roomById = trackedMalloc(MEM_TOPOLOGY, topology->roomCount * sizeof(RoomType*));
+
+    // Loop over the rooms, assigning ids
+    for (RoomNode* current = topology->rooms.head; current != NULL; current = current->next) {
+        current->data->id = id;
+        topology->roomById[id] = current->data;
+        id++;
+    }
+}
+
+/*  Function: void printLayout(HouseType* house)
+    Purpose: Prints the measured memory used per room, shared by every run on the topology and
+        held by this run, and per agent (hunters and the ghost), counting the structures, list
+        nodes and interned names each one owns
+*/
+void printLayout(HouseType* house) {
+    TopologyType* topology = house->topology;
+    size_t roomBytes = house->roomCount * (sizeof(RoomType) + sizeof(RoomType*));
+    size_t stateBytes = house->roomCount * (sizeof(RoomHot) + sizeof(EvidenceList*));
+    size_t agentBytes = sizeof(GhostType);
+    int agents = house->hunters.size + NUM_GHOSTS;
+
+    // Rooms own their node in the house list, their connection nodes and their name
+    for (RoomNode* current = house->rooms.head; current != NULL; current = current->next) {
+        roomBytes += (1 + current->data->connectedRooms.size) * sizeof(RoomNode);
+        roomBytes += strlen(nameOf(current->data->name)) + 1;
+    }
+
+    // The run owns the evidence lists of the rooms evidence was left in so far
+    for (uint32_t i = 0; i < house->roomCount; i++) {
+        stateBytes += (atomic_load(&(house->roomEvidence[i])) != NULL) ? sizeof(EvidenceList) : 0;
+    }
+
+    // Hunters own their structure and their name
+    for (int i = 0; i < house->hunters.size; i++) {
+        agentBytes += sizeof(HunterType) + strlen(nameOf(house->hunters.elements[i]->name)) + 1;
+    }
+
+    printf("[HOUSE LAYOUT] %u rooms at %.1f shared bytes and %.1f run bytes per room (%zu hot), %d agents at %.1f bytes per agent\n",
+        house->roomCount, (double) roomBytes / house->roomCount, (double) stateBytes / house->roomCount,
+        sizeof(RoomHot), agents, (double) agentBytes / agents);
+    if (topology->roomOrder != RO_CREATION) {
+        printf("[HOUSE LAYOUT] rooms in %s order, connected rooms %.1f ids apart on average, %.1f in creation order\n",
+            roomOrderName(topology->roomOrder), neighborSpread(topology), topology->createdSpread);
+    }
 }
 
 /*  Function: void cleanup(HouseType* house)
     Purpose: Deallocated all memory in the heap related to the provided house type
-            at the pointer 'house'. This includes freeing the list evidence and connected rooms
-            in each room of the house. Then freeing the hunter list, shared evidence list and all
-            the room data
+            at the pointer 'house'. This includes freeing the evidence lists of the rooms, the
+            hunter list, the shared evidence list and the room state, then letting go of the
+            topology, which frees the room data once no other house uses it
 */
 void cleanUp(HouseType* house) {
-    // Set current node to be the start of the room list
-    RoomNode* current = house->rooms.head;
+    // Free the scheduled evidence no room holds any more
+    cleanWheel(&(house->evidenceWheel));
 
-    // Loop and free the associated memory for the connected room and evidence linked lists
-    while (current != NULL) {
-        cleanRoomList(&(current->data->connectedRooms));
-        cleanEvidenceList(&(current->data->evidence));
-        current = current->next;
+    // Loop and free the evidence lists evidence was left in
+    for (uint32_t i = 0; i < house->roomCount; i++) {
+        EvidenceList* list = atomic_load(&(house->roomEvidence[i]));
+        if (list != NULL) {
+            cleanEvidenceList(list);
+            trackedFree(MEM_EVIDENCE, list, sizeof(EvidenceList));
+        }
     }
 
-    // Free the rooms in the house
-    cleanRoomData(&(house->rooms));
-    cleanRoomList(&(house->rooms));
-
     // Free hunters in the house
     cleanHunters(&(house->hunters));
 
@@ -89,6 +268,15 @@ void cleanUp(HouseType* house) {
     cleanEvidenceList(&(house->evidence));
 
     // Free the ghost in the house
-    free(house->ghost);
+    trackedFree(MEM_AGENTS, house->ghost, sizeof(GhostType));
+
+    // Free the state of the rooms, then let go of the rooms
+    trackedFree(MEM_TOPOLOGY, house->roomHot, house->roomCount * sizeof(RoomHot));
+    trackedFree(MEM_EVIDENCE, house->roomEvidence, house->roomCount * sizeof(_Atomic(EvidenceList*)));
+    trackedFree(MEM_TOPOLOGY, house->nearby, (size_t) house->roomCount * (PROXIMITY_HOPS + 1) * sizeof(_Atomic uint32_t));
+    if (house->clusterEvidence != NULL) {
+        trackedFree(MEM_EVIDENCE, house->clusterEvidence, (size_t) house->routing->clusterCount * EV_COUNT * sizeof(_Atomic uint32_t));
+    }
+    releaseTopology(house->topology);
 }
 
@@ -8,23 +8,42 @@ void initHunterArray(HunterArray* arr) {
     arr->size = 0;
 }
 
-/*  Function: initHunter(RoomType* room, enum EvidenceType equipment, EvidenceList* evidence, char* name, HunterType** hunter)
+/*  Function: initHunter(HouseType* house, RoomType* room, enum EvidenceType equipment, char* name, HunterType** hunter)
     Purpose: Initializes the hunter found at the double pointer 'hunter', allocated memory in the 
         heap for the hunter structure and initilizes the fields of the hunter using the provided 
-        paramters
+        paramters. Each hunter gets cache lines of its own so hunter threads never share a line
 */
-void initHunter(RoomType* room, enum EvidenceType equipment, EvidenceList* evidence, char* name, HunterType** hunter) {
+void initHunter(HouseType* house, RoomType* room, enum EvidenceType equipment, char* name, HunterType** hunter) {
     // Allocate memory in the heap for the hunter
-    *hunter = malloc(sizeof(HunterType)); 
+    *hunter = allocAgent(sizeof(HunterType)); 
+    countAlloc(MEM_AGENTS, sizeof(HunterType));
+    placeHunter(*hunter, house, room, equipment, name);
+}
 
+/*  Function: void placeHunter(HunterType* hunter, HouseType* house, RoomType* room, enum EvidenceType equipment, char* name)
+    Purpose: Initilizes the fields of the hunter structure at the pointer 'hunter' using the
+        provided paramters and places the hunter in 'room' of the house at the pointer 'house',
+        sharing the evidence list of the house
+*/
+void placeHunter(HunterType* hunter, HouseType* house, RoomType* room, enum EvidenceType equipment, char* name) {
     // Define values of the hunter
-    (*hunter)->room = room;
-    addHunter(&((*hunter)->room->hunters), *hunter);
-    (*hunter)->equipment = equipment;
-    strcpy((*hunter)->name, name);
-    (*hunter)->evidence = evidence;
-    (*hunter)->fear = 0;
-    (*hunter)->boredom = 0;
+    hunter->room = room;
+    enterRoom(house, hunter->room);
+    hunter->id = 0;
+    hunter->name = internName(name);
+    hunter->equipment = equipment;
+    hunter->evidence = &(house->evidence);
+    hunter->termination = NULL;
+    hunter->house = house;
+    hunter->stats = NULL;
+    hunter->fear = 0;
+    hunter->boredom = 0;
+    hunter->turns = 0;
+    hunter->fearMax = FEAR_MAX;
+    hunter->boredomMax = BOREDOM_MAX;
+    hunter->exitReason = LOG_UNKNOWN;
+    hunter->seed = 0;
+    memset(&(hunter->pacer), 0, sizeof(PacerType));
 
     // Log that hunter was created
     l_hunterInit(name, equipment);
@@ -45,17 +64,39 @@ void addHunter(HunterArray* arr, HunterType* hunter) {
 */
 void* runHunter(void* ptr) {
     HunterType* hunter = (HunterType*) ptr;
+    pinAgent(hunter->id, hunter, sizeof(HunterType));
+    seedRandom(hunter->seed);
     
     // While hunter is neither bored or afraid
-    while (hunter->fear < FEAR_MAX && hunter->boredom < BOREDOM_MAX) {
+    while (hunter->fear < hunter->fearMax && hunter->boredom < hunter->boredomMax) {
+        uint64_t start = 0, lockStart = 0;
+        ObservationType observation;
+        uint8_t action;
+
+        // Wait here while the house is paused for branching
+        parkAgent(hunter->house);
+
         // If another hunter found all the evidence, exit
-        if (hunter->evidence->sufficentEv == C_TRUE) {
-            removeHunter(&(hunter->room->hunters), hunter);
+        if (simulationStopped(hunter->termination)) {
+            hunter->exitReason = LOG_SUFFICIENT;
+            TRACE4(hunter__exit, hunter->id, hunter->room->id, hunter->equipment, LOG_SUFFICIENT);
+            l_hunterExit(nameOf(hunter->name), LOG_SUFFICIENT);
+            exitRoom(hunter->house, hunter->room);
+            trackHunter(hunter->house, hunter->room->id, ROOM_NONE);
+            hunterLeft(hunter->termination);
             pthread_exit(NULL);
         }
+        hunter->turns++;
+        TRACE4(hunter__turn, hunter->id, hunter->room->id, hunter->equipment, hunter->turns);
+        if (hunter->stats != NULL) {
+            start = nowNanos();
+            lockStart = lockWaitNanos();
+        }
 
-        // Choose an random action, call corresponding function
-        switch(randomHunterAction()) {
+        // Let the hunter policy choose an action, call corresponding function
+        observeHunter(hunter, &observation);
+        decideHunters(&observation, 1, &action);
+        switch (action) {
             case COLLECTING:
                 collectEvidence(hunter);
                 break;
@@ -69,7 +110,7 @@ void* runHunter(void* ptr) {
         }
 
         // If room has ghost increase fear and set boredom to 0
-        if (hunter->room->ghost != NULL) {
+        if (roomHasGhost(hunter->house, hunter->room)) {
             hunter->fear++;
             hunter->boredom = 0;
         } else {
@@ -77,15 +118,20 @@ void* runHunter(void* ptr) {
             hunter->boredom++;
         }
 
-        // Pause at end of turn
-        usleep(HUNTER_WAIT);
+        // Pause at end of turn, waking early if the simulation stops
+        if (hunter->stats != NULL) {
+            recordTurn(hunter->stats, nowNanos() - start, lockWaitNanos() - lockStart);
+        }
+        paceTurn(hunter->termination, &(hunter->pacer), hunter->house->hunterWait, hunter->house->pacing);
     }
     
     // If hunter bored or afraid, remove hunter and log reason for leaving
-    sem_wait(&(hunter->room->sem));
-    removeHunter(&(hunter->room->hunters), hunter);
-    (hunter->fear<=FEAR_MAX) ? l_hunterExit(hunter->name, LOG_FEAR) : l_hunterExit(hunter->name, LOG_BORED);
-    sem_post(&(hunter->room->sem));
+    exitRoom(hunter->house, hunter->room);
+    trackHunter(hunter->house, hunter->room->id, ROOM_NONE);
+    hunter->exitReason = (hunter->fear >= hunter->fearMax) ? LOG_FEAR : LOG_BORED;
+    TRACE4(hunter__exit, hunter->id, hunter->room->id, hunter->equipment, hunter->exitReason);
+    l_hunterExit(nameOf(hunter->name), hunter->exitReason);
+    hunterLeft(hunter->termination);
     pthread_exit(NULL);
 }
 
@@ -103,104 +149,121 @@ enum HunterActions randomHunterAction() {
         evidence list all hunters share
 */
 void collectEvidence(HunterType* hunter) {
+    EvidenceList* roomList;
+
+    // Nothing to do if the room holds none of the hunter's evidence, checked without locking
+    if (!(roomEvidence(hunter->house, hunter->room) & (1 << hunter->equipment))) {
+        return;
+    }
+
     // wait until evidence collected
-    sem_wait(&(hunter->evidence->sem));
-    sem_wait(&(hunter->room->evidence.sem));
+    roomList = evidenceIn(hunter->house, hunter->room);
+    acquireLock(&(hunter->evidence->lock));
+    acquireLock(&(roomList->lock));
 
     // Try to remove evidence, if removed add evidence to shared list
-    if (removeEvidence(&(hunter->room->evidence), hunter->equipment)) {
+    if (removeEvidence(roomList, hunter->equipment)) {
+        setRoomEvidence(hunter->house, hunter->room, evidenceMask(roomList));
         addEvidence(hunter->evidence, hunter->equipment);
-        l_hunterCollect(hunter->name, hunter->equipment, hunter->room->name);
+        TRACE(hunter__collect, hunter->id, hunter->room->id, hunter->equipment);
+        atomic_fetch_add_explicit(&(hunter->house->collected[hunter->equipment]), 1, memory_order_relaxed);
+        l_hunterCollect(nameOf(hunter->name), hunter->equipment, nameOf(hunter->room->name));
     }
 
     // End wait
-    sem_post(&(hunter->evidence->sem));
-    sem_post(&(hunter->room->evidence.sem));
+    releaseLock(&(hunter->evidence->lock));
+    releaseLock(&(roomList->lock));
+}
+
+/*  Function: RoomType* chooseHunterRoom(HunterType* hunter)
+    Purpose: Returns the connected room the hunter moves to. Hunters wander at random unless
+            the house routes them: towards the room evidence was last left in, towards nearby
+            evidence of the type they collect, or back to the van once they are half way to
+            leaving in fear. A hunter already at its goal wanders
+*/
+RoomType* chooseHunterRoom(HunterType* hunter) {
+    HouseType* house = hunter->house;
+    RoomId goal = ROOM_NONE;
+    RoomId next;
+
+    // Pick the goal room of the house's movement policy
+    if (house != NULL && house->routing != NULL) {
+        if (house->movement == MV_EVIDENCE) {
+            goal = atomic_load_explicit(&(house->lastEvidence), memory_order_relaxed);
+        } else if (house->movement == MV_VAN && hunter->fear >= hunter->fearMax / 2) {
+            goal = 0;
+        } else if (house->movement == MV_COLLECT) {
+            goal = findEvidence(house, hunter->room->id, hunter->equipment);
+        }
+    }
+
+    // Step towards the goal, or wander if there is none
+    if (goal != ROOM_NONE && goal != hunter->room->id) {
+        next = nextHop(house->routing, hunter->room->id, goal);
+        if (next != hunter->room->id) {
+            return house->roomById[next];
+        }
+    }
+    return randomRoom(&(hunter->room->connectedRooms), 0);
 }
 
 /*  Function: void moveHunterRooms(HunterType* hunter)
-    Purpose: Moves the hunter pointer from their current hunters array in their room to 
-            a random room from the avialable connected rooms, logs that the hunter moved
+    Purpose: Moves the hunter from their current room to a connected room chosen by
+            chooseHunterRoom, updating the occupancy of both rooms, logs that the hunter moved.
+            The hunter enters the new room before leaving the old one, so without taking any
+            lock the hunter is always counted in at least one room
 */
 void moveHunterRooms(HunterType* hunter) {
     // Store the old and new rooms
     RoomType* oldRoom = hunter->room;
-    RoomType* newRoom = randomRoom(&(hunter->room->connectedRooms), 0);
-
-    // Wait until movement is finished
-    if (&(oldRoom->sem) > &(newRoom->sem)) {
-        sem_wait(&(oldRoom->sem));
-        sem_wait(&(newRoom->sem));
-    } else {
-        sem_wait(&(newRoom->sem));
-        sem_wait(&(oldRoom->sem));
-    }
+    RoomType* newRoom = chooseHunterRoom(hunter);
 
-    removeHunter(&(hunter->room->hunters), hunter); // Remove hunter
+    enterRoom(hunter->house, newRoom);              // Add hunter to new room
     hunter->room = newRoom;                         // Set hunters new room
-    addHunter(&(hunter->room->hunters), hunter);    // Add that hunter to hunters array in new room
-    l_hunterMove(hunter->name, hunter->room->name); // log that hunter moved
-
-    // End the wait
-    if (&(oldRoom->sem) > &(newRoom->sem)) {
-        sem_post(&(oldRoom->sem));
-        sem_post(&(newRoom->sem));
-    } else {
-        sem_post(&(newRoom->sem));
-        sem_post(&(oldRoom->sem));
-    }
+    exitRoom(hunter->house, oldRoom);               // Remove hunter from old room
+    TRACE4(hunter__move, hunter->id, newRoom->id, hunter->equipment, oldRoom->id);
+    trackHunter(hunter->house, oldRoom->id, newRoom->id); // Update the proximity index
+    l_hunterMove(nameOf(hunter->name), nameOf(newRoom->name)); // log that hunter moved
 };
 
-/*  Function: void removeHunter(HunterArray* arr, HunterType* hunter)
-    Purpose: Removes the pointer 'hunter' from the hunter array found at the pointer
-        'arr', decrements the size of the array
-*/
-void removeHunter(HunterArray* arr, HunterType* hunter) {
-    // Find index of hunter and remoce
-    for (int i = 0; i < arr->size; i++) {
-        if (arr->elements[i] == hunter) {
-            // Shift all elements in array down one index
-            for (int j = i; j < arr->size - 1; j++) {
-                arr->elements[j] = arr->elements[j + 1];
-            }
-            // NULL end of array and decrement size
-            arr->size--;
-            arr->elements[arr->size] = NULL; 
-            break;
-        }
-    } 
-}
-
 /*  Function: void reviewEvidence(HunterType* hunter)
     Purpose: Reviews the shared evidence list and determines if there is enough
              evidence to guess the ghost (3 pieces of unique evidence)
 */
 void reviewEvidence(HunterType* hunter) {
+    int sufficient;
+
     // Wait until review of evidence is finished
-    sem_wait(&(hunter->evidence->sem));
-    sem_wait(&(hunter->room->sem));
+    acquireLock(&(hunter->evidence->lock));
+    sufficient = sufficientEvidence(hunter->evidence);
+    TRACE4(hunter__review, hunter->id, hunter->room->id, hunter->equipment, sufficient);
 
     // If sufficient evidence, remove hunter, and exit thread
-    if (sufficientEvidence(hunter->evidence)) {
-        l_hunterReview(hunter->name, LOG_SUFFICIENT);   // log evidence was sufficient
+    if (sufficient) {
+        l_hunterReview(nameOf(hunter->name), LOG_SUFFICIENT); // log evidence was sufficient
         hunter->evidence->sufficentEv = C_TRUE;         // Set shared evidence to sufficient
-        removeHunter(&(hunter->room->hunters), hunter); // remove hunter from house
-        l_hunterExit(hunter->name, LOG_EVIDENCE);       // log hunter exit
+        exitRoom(hunter->house, hunter->room);                         // remove hunter from house
+        trackHunter(hunter->house, hunter->room->id, ROOM_NONE);
+        hunter->exitReason = LOG_EVIDENCE;              // record reason for leaving
+        TRACE4(hunter__exit, hunter->id, hunter->room->id, hunter->equipment, LOG_EVIDENCE);
+        l_hunterExit(nameOf(hunter->name), LOG_EVIDENCE); // log hunter exit
         
         // End wait
-        sem_post(&(hunter->evidence->sem));
-        sem_post(&(hunter->room->sem));
+        releaseLock(&(hunter->evidence->lock));
+
+        // The outcome is decided, wake every other agent so they leave now
+        stopSimulation(hunter->termination);
+        hunterLeft(hunter->termination);
 
         // Exit thread
         pthread_exit(NULL);
     } else {
          // else log insufficient evidence
-        l_hunterReview(hunter->name, LOG_INSUFFICIENT);
+        l_hunterReview(nameOf(hunter->name), LOG_INSUFFICIENT);
     }
 
     // End wait
-    sem_post(&(hunter->evidence->sem));
-    sem_post(&(hunter->room->sem));
+    releaseLock(&(hunter->evidence->lock));
 }
 
 /*  Function: int sufficientEvidence(EvidenceList* list)
@@ -248,6 +311,6 @@ int sufficientEvidence(EvidenceList* list) {
 void cleanHunters(HunterArray* hunters) {
     // Loop through each hunter in array and free memory
     for (int i = 0; i < hunters->size; i++) {
-        free(hunters->elements[i]);
+        trackedFree(MEM_AGENTS, hunters->elements[i], sizeof(HunterType));
     }
 }
\ No newline at end of file
@@ -0,0 +1,455 @@
+#include "defs.h"
+
+/*
+    The lane engine runs SIMD_LANES independent runs of the same house in one thread, one run
+    per lane of a vector. Fear, boredom, rooms, turns, the collected evidence masks and the
+    random streams of every agent are held one vector per field, and each turn applies the
+    rules to all lanes at once with masks selecting the lanes an action or rule applies to.
+    Only reads and writes of per room state are done lane by lane, as each lane's agent is in
+    a room of its own.
+
+    Time is virtual. Every lane follows the same schedule: an agent's next turn comes one
+    wait after its last, the ghost going first on a tie and hunters in roster order, which is
+    the cadence the threaded engine's sleeps aim for. A lane whose run is decided starts the
+    next run the next time every agent is due at once, so lanes do not idle waiting for the
+    longest run of a batch. Records are written in run order, runs finishing up to
+    LANE_WINDOW runs ahead of the oldest unfinished one wait in a window. Ghost type and starting room
+    come from the same setup stream as the threaded engine, the agents' own random streams
+    are per lane xorshift generators seeded from the agents' usual seeds.
+
+    A room's evidence is a queue of up to LANE_EVIDENCE_MAX two bit evidence types packed
+    into one word, oldest in the low bits, so dropping the oldest, adding the newest and
+    collecting the oldest of a type are a few shifts and masks. Only the built in random
+    policies, random movement, no evidence lifetime and an evidence capacity of 1 to
+    LANE_EVIDENCE_MAX are supported.
+*/
+
+typedef uint32_t LaneWord __attribute__((vector_size(SIMD_LANES * sizeof(uint32_t))));
+
+typedef struct {
+    uint32_t     roomCount;         // number of rooms in the house
+    uint32_t*    offsets;           // start of each room's neighbours, roomCount + 1 entries
+    uint32_t*    neighbors;         // connected rooms, grouped by room in connection list order
+} LaneTopology;
+
+typedef struct {
+    LaneWord     ghostRng;          // random stream of the ghost
+    LaneWord     ghostRoom;         // room the ghost is in
+    LaneWord     ghostType;         // enum GhostClass of the ghost
+    LaneWord     ghostBoredom;      // boredom of the ghost
+    LaneWord     ghostTurns;        // turns taken by the ghost
+    LaneWord     ghostInside;       // all ones while the ghost is in the house
+    LaneWord     hunterRng[NUM_HUNTERS];  // random stream of each hunter
+    LaneWord     hunterRoom[NUM_HUNTERS]; // room each hunter is in
+    LaneWord     fear[NUM_HUNTERS];       // fear of each hunter
+    LaneWord     boredom[NUM_HUNTERS];    // boredom of each hunter
+    LaneWord     turns[NUM_HUNTERS];      // turns taken by each hunter
+    LaneWord     inside[NUM_HUNTERS];     // all ones while the hunter is in the house
+    LaneWord     exitReason[NUM_HUNTERS]; // enum LoggerDetails reason the hunter left
+    LaneWord     collected;         // bit per evidence type the hunters collected
+    LaneWord     stopped;           // all ones once the outcome of the run is decided
+    uint32_t*    evidence;          // packed evidence queue of every room, SIMD_LANES per room
+    uint32_t*    evidenceCount;     // evidence in every room's queue, SIMD_LANES per room
+    int          run[SIMD_LANES];   // run each lane plays, -1 for none
+    uint64_t     seed[SIMD_LANES];  // seed of the run each lane plays
+} LaneBatch;
+
+// Evidence of ghost class c's choice i at bits c * 6 + i * 2, as pickEvidence chooses it
+#define LANE_EVIDENCE_TABLE \
+    ((EMF << 0) | (TEMPERATURE << 2) | (FINGERPRINTS << 4) |       /* POLTERGEIST */ \
+     (EMF << 6) | (TEMPERATURE << 8) | (SOUND << 10) |             /* BANSHEE */ \
+     (EMF << 12) | (FINGERPRINTS << 14) | (SOUND << 16) |          /* BULLIES */ \
+     (TEMPERATURE << 18) | (FINGERPRINTS << 20) | (SOUND << 22))   /* PHANTOM */
+
+/*
+    Returns 'a' in the lanes set in 'mask' and 'b' in the others.
+*/
+static inline LaneWord pick(LaneWord mask, LaneWord a, LaneWord b) {
+    return (mask & a) | (~mask & b);
+}
+
+/*
+    Returns C_TRUE if any lane of 'mask' is set.
+*/
+static inline int anyLane(LaneWord mask) {
+    uint32_t any = 0;
+    for (int l = 0; l < SIMD_LANES; l++) {
+        any |= mask[l];
+    }
+    return any != 0;
+}
+
+/*
+    Advances every lane's xorshift stream and returns a number below 'n' in each lane,
+    'n' must be below 65536.
+*/
+static inline LaneWord drawBelow(LaneWord* rng, LaneWord n) {
+    LaneWord x = *rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *rng = x;
+    return ((x >> 16) * n) >> 16;
+}
+
+/*
+    Returns the number of evidence types set in each lane of the mask 'mask'.
+*/
+static inline LaneWord countTypes(LaneWord mask) {
+    return (mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + ((mask >> 3) & 1);
+}
+
+/*
+    Returns a random room connected to the room in each lane of 'rooms' for the lanes set in
+    'mask', the room itself in the others.
+*/
+static LaneWord randomNeighbor(LaneTopology* topology, LaneWord rooms, LaneWord* rng, LaneWord mask) {
+    LaneWord first, degree, choice;
+
+    for (int l = 0; l < SIMD_LANES; l++) {
+        first[l] = topology->offsets[rooms[l]];
+        degree[l] = topology->offsets[rooms[l] + 1] - first[l];
+    }
+    choice = drawBelow(rng, degree);
+    for (int l = 0; l < SIMD_LANES; l++) {
+        if (mask[l]) {
+            rooms[l] = topology->neighbors[first[l] + choice[l]];
+        }
+    }
+    return rooms;
+}
+
+/*
+    Builds the topology of the house every run of the batch uses, exactly as the threaded
+    engine builds it.
+*/
+static void buildTopology(OptionsType* options, LaneTopology* topology) {
+    HouseType house;
+    uint32_t edge = 0;
+
+    seedRandom(mixSeed(options->seed, 0));
+    initHouse(&house, options->rooms, options->roomOrder);
+    topology->roomCount = house.roomCount;
+    topology->offsets = trackedMalloc(MEM_TOPOLOGY, (house.roomCount + 1) * sizeof(uint32_t));
+    for (uint32_t r = 0; r < house.roomCount; r++) {
+        topology->offsets[r] = edge;
+        edge += house.roomById[r]->connectedRooms.size;
+    }
+    topology->offsets[house.roomCount] = edge;
+    topology->neighbors = trackedMalloc(MEM_TOPOLOGY, edge * sizeof(uint32_t));
+    for (uint32_t r = 0; r < house.roomCount; r++) {
+        uint32_t at = topology->offsets[r];
+        for (RoomNode* current = house.roomById[r]->connectedRooms.head; current != NULL; current = current->next) {
+            topology->neighbors[at++] = current->data->id;
+        }
+    }
+    cleanUp(&house);
+}
+
+/*
+    Decides the outcome of the runs in the lanes set in 'mask': hunters still inside leave
+    for the reason they would give on waking.
+*/
+static void stopLanes(LaneBatch* batch, int hunters, LaneWord mask) {
+    for (int h = 0; h < hunters; h++) {
+        LaneWord leaving = mask & batch->inside[h];
+        LaneWord reason = pick((LaneWord) (batch->fear[h] >= FEAR_MAX), (LaneWord) {} + LOG_FEAR,
+            pick((LaneWord) (batch->boredom[h] >= BOREDOM_MAX), (LaneWord) {} + LOG_BORED, (LaneWord) {} + LOG_SUFFICIENT));
+        batch->exitReason[h] = pick(leaving, reason, batch->exitReason[h]);
+        batch->inside[h] &= ~leaving;
+    }
+    batch->stopped |= mask;
+}
+
+/*
+    Starts run 'run', seeded with 'seed', in lane 'l' of the batch.
+*/
+static void loadLane(LaneBatch* batch, LaneTopology* topology, int hunters, int l, uint64_t seed, uint32_t run) {
+    for (uint32_t r = 0; r < topology->roomCount; r++) {
+        batch->evidence[r * SIMD_LANES + l] = 0;
+        batch->evidenceCount[r * SIMD_LANES + l] = 0;
+    }
+
+    // Place the ghost with the same draws as initGhost
+    seedRandom(mixSeed(seed, 0));
+    batch->ghostRoom[l] = randInt(1, topology->roomCount);
+    batch->ghostType[l] = randomGhost();
+    batch->ghostRng[l] = mixSeed(seed, 1);
+    batch->ghostBoredom[l] = 0;
+    batch->ghostTurns[l] = 0;
+    for (int h = 0; h < NUM_HUNTERS; h++) {
+        batch->hunterRng[h][l] = mixSeed(seed, h + 2);
+        batch->hunterRoom[h][l] = 0;
+        batch->fear[h][l] = 0;
+        batch->boredom[h][l] = 0;
+        batch->turns[h][l] = 0;
+        batch->inside[h][l] = (h < hunters) ? UINT32_MAX : 0;
+        batch->exitReason[h][l] = LOG_UNKNOWN;
+    }
+    batch->collected[l] = 0;
+    batch->stopped[l] = (hunters == 0) ? UINT32_MAX : 0;
+    batch->ghostInside[l] = ~batch->stopped[l];
+    batch->run[l] = run;
+    batch->seed[l] = seed;
+}
+
+/*
+    Takes the turn of hunter 'h' with equipment 'equipment' in every lane it is inside.
+*/
+static void hunterTurn(LaneBatch* batch, LaneTopology* topology, int hunters, int h, uint32_t equipment) {
+    LaneWord live = batch->inside[h] & ~batch->stopped;
+    LaneWord leaving, acting, action, collect, queue, count, review, stays, haunted, nobody;
+
+    if (!anyLane(live)) {
+        return;
+    }
+
+    // A hunter that ended its last turn afraid or bored leaves now
+    leaving = live & ((LaneWord) (batch->fear[h] >= FEAR_MAX) | (LaneWord) (batch->boredom[h] >= BOREDOM_MAX));
+    batch->exitReason[h] = pick(leaving, pick((LaneWord) (batch->fear[h] >= FEAR_MAX), (LaneWord) {} + LOG_FEAR,
+        (LaneWord) {} + LOG_BORED), batch->exitReason[h]);
+    batch->inside[h] &= ~leaving;
+    acting = live & ~leaving;
+    batch->turns[h] += acting & 1;
+    action = drawBelow(&(batch->hunterRng[h]), (LaneWord) {} + HA_COUNT);
+
+    // Collect the oldest evidence of the hunter's type from the room's queue
+    collect = acting & (LaneWord) (action == COLLECTING);
+    if (equipment < EV_COUNT && anyLane(collect)) {
+        LaneWord pairs, matches, lowest, below;
+        for (int l = 0; l < SIMD_LANES; l++) {
+            queue[l] = batch->evidence[batch->hunterRoom[h][l] * SIMD_LANES + l];
+            count[l] = batch->evidenceCount[batch->hunterRoom[h][l] * SIMD_LANES + l];
+        }
+        // A pair of bits matches where it equals the equipment, the lowest match is the oldest
+        pairs = queue ^ (equipment * 0x55555555U);
+        matches = ~(pairs | (pairs >> 1)) & 0x55555555U
+            & pick((LaneWord) (count >= LANE_EVIDENCE_MAX), (LaneWord) {} + UINT32_MAX, (1U << ((count * 2) & 31)) - 1);
+        collect &= (LaneWord) (matches != 0);
+        lowest = matches & -matches;
+        below = lowest - 1;
+        queue = (queue & below) | ((queue >> 2) & ~below);
+        batch->collected |= collect & (1U << equipment);
+        for (int l = 0; l < SIMD_LANES; l++) {
+            if (collect[l]) {
+                batch->evidence[batch->hunterRoom[h][l] * SIMD_LANES + l] = queue[l];
+                batch->evidenceCount[batch->hunterRoom[h][l] * SIMD_LANES + l] = count[l] - 1;
+            }
+        }
+    }
+
+    // Move to a random connected room
+    batch->hunterRoom[h] = randomNeighbor(topology, batch->hunterRoom[h], &(batch->hunterRng[h]), acting & (LaneWord) (action == MOVING));
+
+    // Reviewing sufficient evidence decides the run
+    review = acting & (LaneWord) (action == REVIEWING) & (LaneWord) (countTypes(batch->collected) >= NUM_GHOST_EV);
+    batch->exitReason[h] = pick(review, (LaneWord) {} + LOG_EVIDENCE, batch->exitReason[h]);
+    batch->inside[h] &= ~review;
+    stopLanes(batch, hunters, review);
+
+    // The ghost in the room scares the hunter, otherwise it gets bored
+    stays = acting & ~review;
+    haunted = stays & batch->ghostInside & (LaneWord) (batch->ghostRoom == batch->hunterRoom[h]);
+    batch->fear[h] += haunted & 1;
+    batch->boredom[h] = pick(haunted, (LaneWord) {}, batch->boredom[h] + (stays & 1));
+
+    // The run is decided once every hunter has left
+    nobody = ~batch->stopped;
+    for (int i = 0; i < hunters; i++) {
+        nobody &= ~batch->inside[i];
+    }
+    stopLanes(batch, hunters, nobody);
+}
+
+/*
+    Takes the ghost's turn in every lane it is inside.
+*/
+static void ghostTurn(LaneBatch* batch, LaneTopology* topology, int hunters, int capacity) {
+    LaneWord live = batch->ghostInside & ~batch->stopped;
+    LaneWord bored, acting, withHunter, action, leave, choice;
+
+    if (!anyLane(live)) {
+        return;
+    }
+
+    // A bored ghost leaves the house, the hunters may still find what it left
+    bored = live & (LaneWord) (batch->ghostBoredom >= BOREDOM_MAX);
+    batch->ghostInside &= ~bored;
+    acting = live & ~bored;
+    batch->ghostTurns += acting & 1;
+
+    withHunter = (LaneWord) {};
+    for (int h = 0; h < hunters; h++) {
+        withHunter |= batch->inside[h] & (LaneWord) (batch->hunterRoom[h] == batch->ghostRoom);
+    }
+    batch->ghostBoredom = pick(acting & withHunter, (LaneWord) {}, batch->ghostBoredom + (acting & 1));
+
+    action = drawBelow(&(batch->ghostRng), (LaneWord) {} + GA_COUNT);
+    batch->ghostRoom = randomNeighbor(topology, batch->ghostRoom, &(batch->ghostRng), acting & (LaneWord) (action == MOVE_ROOMS));
+
+    // Leave evidence of the ghost's class, dropping the room's oldest when it is full
+    // Every lane draws the evidence, so a lane's stream never depends on the other lanes
+    leave = acting & (LaneWord) (action == LEAVE_EVIDENCE);
+    choice = drawBelow(&(batch->ghostRng), (LaneWord) {} + NUM_GHOST_EV);
+    if (anyLane(leave)) {
+        LaneWord type = (LANE_EVIDENCE_TABLE >> (batch->ghostType * 6 + choice * 2)) & 3;
+        LaneWord queue, count, full;
+        for (int l = 0; l < SIMD_LANES; l++) {
+            queue[l] = batch->evidence[batch->ghostRoom[l] * SIMD_LANES + l];
+            count[l] = batch->evidenceCount[batch->ghostRoom[l] * SIMD_LANES + l];
+        }
+        full = (LaneWord) (count >= (uint32_t) capacity);
+        queue = pick(full, queue >> 2, queue);
+        count -= full & 1;
+        queue |= type << ((count * 2) & 31);
+        count += 1;
+        for (int l = 0; l < SIMD_LANES; l++) {
+            if (leave[l]) {
+                batch->evidence[batch->ghostRoom[l] * SIMD_LANES + l] = queue[l];
+                batch->evidenceCount[batch->ghostRoom[l] * SIMD_LANES + l] = count[l];
+            }
+        }
+    }
+}
+
+/*
+    Returns all ones in the lanes whose hunters would guess the lane's ghost from the evidence
+    they collected, the classification huntersWin makes.
+*/
+static LaneWord lanesWon(LaneBatch* batch) {
+    LaneWord mask = batch->collected;
+    LaneWord guess = pick((LaneWord) ((mask & 0x7) == 0x7), (LaneWord) {} + POLTERGEIST,
+        pick((LaneWord) ((mask & 0xB) == 0xB), (LaneWord) {} + BANSHEE,
+        pick((LaneWord) ((mask & 0xD) == 0xD), (LaneWord) {} + BULLIES,
+        pick((LaneWord) ((mask & 0xE) == 0xE), (LaneWord) {} + PHANTOM, (LaneWord) {} + GH_UNKNOWN))));
+    return (LaneWord) (guess == batch->ghostType);
+}
+
+/*
+    Stores the outcome of the run in lane 'l' in 'record' as recordRun would, 'won' holds
+    the lanes the hunters won.
+*/
+static void recordLane(LaneBatch* batch, int hunters, LaneWord won, int l, RunRecord* record) {
+    memset(record, 0, sizeof(RunRecord));
+    memset(record->hunterExit, LOG_UNKNOWN, sizeof(record->hunterExit));
+    record->seed = batch->seed[l];
+    record->run = batch->run[l];
+    record->ghostClass = batch->ghostType[l];
+    record->evidenceMask = batch->collected[l];
+    record->outcome = won[l] & 1;
+    record->ghostBoredom = batch->ghostBoredom[l];
+    record->ghostTurns = batch->ghostTurns[l];
+    for (int h = 0; h < hunters; h++) {
+        record->hunterExit[h] = batch->exitReason[h][l];
+        record->hunterFear[h] = batch->fear[h][l];
+        record->hunterBoredom[h] = batch->boredom[h][l];
+        record->hunterTurns[h] = batch->turns[h][l];
+    }
+}
+
+/*  Function: int runLanes(OptionsType* options, RosterType* roster, ResultWriter* writer, int print)
+    Purpose: Runs the options->runs runs of the batch on the lane engine with the hunters from
+        'roster', writing a record of each to 'writer' in run order unless it is NULL, and
+        printing a line per run when 'print' is true. Returns the number of runs the hunters won
+*/
+int runLanes(OptionsType* options, RosterType* roster, ResultWriter* writer, int print) {
+    LaneTopology topology;
+    LaneBatch* batch = allocCacheAligned(sizeof(LaneBatch));
+    RunRecord* window = trackedMalloc(MEM_AGENTS, LANE_WINDOW * sizeof(RunRecord));
+    uint8_t* ready = trackedCalloc(MEM_AGENTS, LANE_WINDOW, 1);
+    int hunters = rosterPlayers(roster);
+    uint64_t ghostWait = (options->ghostWait > 0) ? options->ghostWait : 1;
+    uint64_t hunterWait = (options->hunterWait > 0) ? options->hunterWait : 1;
+    uint64_t ghostNext = 0;
+    uint64_t hunterNext[NUM_HUNTERS] = {0};
+    int started = 0, written = 0, wins = 0;
+
+    countAlloc(MEM_AGENTS, sizeof(LaneBatch));
+    buildTopology(options, &topology);
+    batch->evidence = trackedMalloc(MEM_EVIDENCE, topology.roomCount * SIMD_LANES * sizeof(uint32_t));
+    batch->evidenceCount = trackedMalloc(MEM_EVIDENCE, topology.roomCount * SIMD_LANES * sizeof(uint32_t));
+    batch->stopped = (LaneWord) {} + UINT32_MAX;
+    for (int l = 0; l < SIMD_LANES; l++) {
+        batch->run[l] = -1;
+    }
+
+    while (written < options->runs) {
+        int next = -1;
+        uint64_t at = ghostNext;
+        int aligned = C_TRUE;
+
+        // Every agent is due at once at the start of the schedule and once every period of
+        // the waits after it, a run started then plays exactly as one started at time 0
+        for (int h = 0; h < hunters; h++) {
+            aligned &= (hunterNext[h] == ghostNext);
+        }
+        if (!anyLane(~batch->stopped)) {
+            ghostNext = 0;
+            memset(hunterNext, 0, sizeof(hunterNext));
+            aligned = C_TRUE;
+        }
+
+        // Retire the decided runs and start new ones in their lanes
+        if (aligned) {
+            LaneWord won = lanesWon(batch);
+            for (int l = 0; l < SIMD_LANES; l++) {
+                if (!batch->stopped[l]) {
+                    continue;
+                }
+                if (batch->run[l] >= 0) {
+                    recordLane(batch, hunters, won, l, &window[batch->run[l] % LANE_WINDOW]);
+                    ready[batch->run[l] % LANE_WINDOW] = C_TRUE;
+                    batch->run[l] = -1;
+                }
+                if (started < options->runs && started < written + LANE_WINDOW) {
+                    loadLane(batch, &topology, hunters, l, options->seed + started, started);
+                    started++;
+                }
+            }
+
+            // Write the finished runs in order
+            while (written < started && ready[written % LANE_WINDOW]) {
+                RunRecord* record = &window[written % LANE_WINDOW];
+                wins += record->outcome;
+                if (writer != NULL) {
+                    writeResult(writer, record);
+                }
+                if (print) {
+                    char ghost[MAX_STR];
+                    ghostToString(record->ghostClass, ghost);
+                    printf("[LANES] run %u: %s, evidence mask %x, %s\n", record->run, ghost, record->evidenceMask,
+                        record->outcome ? "hunters win" : "ghost wins");
+                }
+                ready[written % LANE_WINDOW] = C_FALSE;
+                written++;
+            }
+            if (!anyLane(~batch->stopped)) {
+                continue;
+            }
+        }
+
+        // The agent due first takes its turn in every lane, the ghost first on a tie
+        for (int h = 0; h < hunters; h++) {
+            if (hunterNext[h] < at) {
+                next = h;
+                at = hunterNext[h];
+            }
+        }
+        if (next < 0) {
+            ghostTurn(batch, &topology, hunters, options->evidenceCapacity);
+            ghostNext += ghostWait;
+        } else {
+            hunterTurn(batch, &topology, hunters, next, roster->hunters[next].equipment);
+            hunterNext[next] += hunterWait;
+        }
+    }
+
+    trackedFree(MEM_EVIDENCE, batch->evidence, topology.roomCount * SIMD_LANES * sizeof(uint32_t));
+    trackedFree(MEM_EVIDENCE, batch->evidenceCount, topology.roomCount * SIMD_LANES * sizeof(uint32_t));
+    trackedFree(MEM_TOPOLOGY, topology.neighbors, topology.offsets[topology.roomCount] * sizeof(uint32_t));
+    trackedFree(MEM_TOPOLOGY, topology.offsets, (topology.roomCount + 1) * sizeof(uint32_t));
+    trackedFree(MEM_AGENTS, window, LANE_WINDOW * sizeof(RunRecord));
+    trackedFree(MEM_AGENTS, ready, LANE_WINDOW);
+    trackedFree(MEM_AGENTS, batch, sizeof(LaneBatch));
+    return wins;
+}
@@ -0,0 +1,189 @@
+#include "defs.h"
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+/*
+    Every critical section in the simulation goes through these functions, the backend is chosen
+    once before any lock is created, at build time with LOCK_BACKEND or at runtime with --lock:
+
+    sem       a POSIX semaphore used as a binary lock
+    futex     a three state futex mutex: 0 free, 1 held, 2 held with waiters
+    ticket    a ticket spinlock, first come first served
+    adaptive  the futex mutex, but spins on the lock for a while before parking
+*/
+
+#if defined(__x86_64__) || defined(__i386__)
+#define cpuRelax() __builtin_ia32_pause()
+#elif defined(__aarch64__)
+#define cpuRelax() __asm__ __volatile__("yield")
+#else
+#define cpuRelax() ((void) 0)
+#endif
+
+static enum LockBackend lockBackend = LOCK_BACKEND;
+static int lockTiming = C_FALSE;
+static __thread uint64_t lockWait = 0;      // nanoseconds this thread waited in acquireLock
+
+/*
+    Sleeps while the futex word at 'word' still holds 'value'.
+*/
+static void futexWait(_Atomic uint32_t* word, uint32_t value) {
+    syscall(SYS_futex, word, FUTEX_WAIT_PRIVATE, value, NULL, NULL, 0);
+}
+
+/*
+    Wakes one thread sleeping on the futex word at 'word'.
+*/
+static void futexWake(_Atomic uint32_t* word) {
+    syscall(SYS_futex, word, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+/*
+    Acquires a futex mutex, spinning up to 'spins' times before parking.
+*/
+static void acquireFutex(_Atomic uint32_t* word, int spins) {
+    uint32_t state = 0;
+
+    // Uncontended case, or the owner releases while we spin
+    for (int i = 0; i <= spins; i++) {
+        state = 0;
+        if (atomic_compare_exchange_weak(word, &state, 1)) {
+            return;
+        }
+        cpuRelax();
+    }
+
+    // Mark the lock contended and sleep until it is handed over
+    if (state != 2) {
+        state = atomic_exchange(word, 2);
+    }
+    while (state != 0) {
+        futexWait(word, 2);
+        state = atomic_exchange(word, 2);
+    }
+}
+
+/*  Function: int setLockBackend(char* name)
+    Purpose: Selects the lock backend named 'name' for every lock created afterwards,
+        returns C_FALSE if the name is unknown
+*/
+int setLockBackend(char* name) {
+    for (int i = 0; i < LK_COUNT; i++) {
+        if (!strcmp(name, lockBackendName(i))) {
+            lockBackend = i;
+            return C_TRUE;
+        }
+    }
+    return C_FALSE;
+}
+
+/*  Function: char* lockBackendName(enum LockBackend backend)
+    Purpose: Returns the name of the lock backend 'backend'
+*/
+char* lockBackendName(enum LockBackend backend) {
+    static char* names[] = {"sem", "futex", "ticket", "adaptive"};
+    return (backend >= 0 && backend < LK_COUNT) ? names[backend] : "unknown";
+}
+
+/*  Function: enum LockBackend currentLockBackend()
+    Purpose: Returns the lock backend new locks are created with
+*/
+enum LockBackend currentLockBackend(void) {
+    return lockBackend;
+}
+
+/*  Function: void initLock(LockType* lock)
+    Purpose: Initializes the lock at the pointer 'lock' as free
+*/
+void initLock(LockType* lock) {
+    if (lockBackend == LK_SEM) {
+        sem_init(&(lock->sem), 0, 1);
+    } else {
+        atomic_init(&(lock->word), 0);
+        atomic_init(&(lock->owner), 0);
+    }
+}
+
+/*  Function: void acquireLock(LockType* lock)
+    Purpose: Waits until the lock at the pointer 'lock' is free and takes it, adding the time
+        spent waiting to the calling thread's total when lock timing is on
+*/
+void acquireLock(LockType* lock) {
+    uint64_t start = lockTiming ? nowNanos() : 0;
+    uint32_t ticket;
+
+    TRACE1(lock__acquire, lock);
+    switch (lockBackend) {
+        case LK_FUTEX:
+            acquireFutex(&(lock->word), 0);
+            break;
+        case LK_ADAPTIVE:
+            acquireFutex(&(lock->word), LOCK_SPINS);
+            break;
+        case LK_TICKET:
+            // Take a ticket and wait for it to be served, yielding if the owner is descheduled
+            ticket = atomic_fetch_add(&(lock->word), 1);
+            for (int i = 0; atomic_load_explicit(&(lock->owner), memory_order_acquire) != ticket; i++) {
+                if (i < LOCK_SPINS) {
+                    cpuRelax();
+                } else {
+                    sched_yield();
+                }
+            }
+            break;
+        default:
+            sem_wait(&(lock->sem));
+            break;
+    }
+    TRACE1(lock__acquired, lock);
+    if (lockTiming) {
+        lockWait += nowNanos() - start;
+    }
+}
+
+/*  Function: void releaseLock(LockType* lock)
+    Purpose: Releases the lock at the pointer 'lock' taken by acquireLock
+*/
+void releaseLock(LockType* lock) {
+    TRACE1(lock__release, lock);
+    switch (lockBackend) {
+        case LK_FUTEX:
+        case LK_ADAPTIVE:
+            // Only make the system call when someone may be sleeping
+            if (atomic_fetch_sub(&(lock->word), 1) != 1) {
+                atomic_store(&(lock->word), 0);
+                futexWake(&(lock->word));
+            }
+            break;
+        case LK_TICKET:
+            atomic_fetch_add_explicit(&(lock->owner), 1, memory_order_release);
+            break;
+        default:
+            sem_post(&(lock->sem));
+            break;
+    }
+}
+
+/*  Function: void setLockTiming(int enabled)
+    Purpose: Turns measuring the time threads wait in acquireLock on or off
+*/
+void setLockTiming(int enabled) {
+    lockTiming = enabled;
+}
+
+/*  Function: uint64_t lockWaitNanos()
+    Purpose: Returns the nanoseconds the calling thread has waited in acquireLock while lock
+        timing was on
+*/
+uint64_t lockWaitNanos(void) {
+    return lockWait;
+}
+
+/*  Function: void cleanLock(LockType* lock)
+    Purpose: Releases any resources held by the free lock at the pointer 'lock'
+*/
+void cleanLock(LockType* lock) {
+    if (lockBackend == LK_SEM) {
+        sem_destroy(&(lock->sem));
+    }
+}
@@ -1,10 +1,19 @@
 #include "defs.h"
 
+static int loggingEnabled = LOGGING;
+
+/*
+    Turns logging on or off at runtime, logging is never enabled when LOGGING is false.
+*/
+void setLogging(int enabled) {
+    loggingEnabled = LOGGING && enabled;
+}
+
 /* 
     Logs the hunter being created.
 */
 void l_hunterInit(char* hunter, enum EvidenceType equipment) {
-    if (!LOGGING) return;
+    if (!loggingEnabled) return;
     char ev_str[MAX_STR];
     evidenceToString(equipment, ev_str);
     printf("[HUNTER INIT] [%s] is a [%s] hunter\n", hunter, ev_str);    
@@ -14,7 +23,7 @@ void l_hunterInit(char* hunter, enum EvidenceType equipment) {
     Logs the hunter moving into a new room.
 */
 void l_hunterMove(char* hunter, char* room) {
-    if (!LOGGING) return;
+    if (!loggingEnabled) return;
     printf("[HUNTER MOVE] [%s] has moved into [%s]\n", hunter, room);
 }
 
@@ -22,7 +31,7 @@ void l_hunterMove(char* hunter, char* room) {
     Logs the hunter exiting the house.
 */
 void l_hunterExit(char* hunter, enum LoggerDetails reason) {
-    if (!LOGGING) return;
+    if (!loggingEnabled) return;
     printf("[HUNTER EXIT] [%s] exited because ", hunter);
     switch (reason) {
         case LOG_FEAR:
@@ -34,6 +43,9 @@ void l_hunterExit(char* hunter, enum LoggerDetails reason) {
         case LOG_EVIDENCE:
             printf("[EVIDENCE]\n");
             break;
+        case LOG_SUFFICIENT:
+            printf("[SUFFICIENT]\n");
+            break;
         default:
             printf("[UNKNOWN]\n");
     }
@@ -43,7 +55,7 @@ void l_hunterExit(char* hunter, enum LoggerDetails reason) {
     Logs the hunter reviewing evidence.
 */
 void l_hunterReview(char* hunter, enum LoggerDetails result) {
-    if (!LOGGING) return;
+    if (!loggingEnabled) return;
     printf("[HUNTER REVIEW] [%s] reviewed evidence and found ", hunter);
     switch (result) {
         case LOG_SUFFICIENT:
@@ -61,7 +73,7 @@ void l_hunterReview(char* hunter, enum LoggerDetails result) {
     Logs the hunter collecting evidence.
 */
 void l_hunterCollect(char* hunter, enum EvidenceType evidence, char* room) {
-    if (!LOGGING) return;
+    if (!loggingEnabled) return;
     char ev_str[MAX_STR];
     evidenceToString(evidence, ev_str);
     printf("[HUNTER EVIDENCE] [%s] found [%s] in [%s] and [COLLECTED]\n", hunter, ev_str, room);
@@ -71,7 +83,7 @@ void l_hunterCollect(char* hunter, enum EvidenceType evidence, char* room) {
     Logs the ghost moving into a new room.
 */
 void l_ghostMove(char* room) {
-    if (!LOGGING) return;
+    if (!loggingEnabled) return;
     printf("[GHOST MOVE] Ghost has moved into [%s]\n", room);
 }
 
@@ -79,7 +91,7 @@ void l_ghostMove(char* room) {
     Logs the ghost exiting the house.
 */
 void l_ghostExit(enum LoggerDetails reason) {
-    if (!LOGGING) return;
+    if (!loggingEnabled) return;
     printf("[GHOST EXIT] Exited because ");
     switch (reason) {
         case LOG_FEAR:
@@ -91,6 +103,9 @@ void l_ghostExit(enum LoggerDetails reason) {
         case LOG_EVIDENCE:
             printf("[EVIDENCE]\n");
             break;
+        case LOG_EMPTY:
+            printf("[HOUSE EMPTY]\n");
+            break;
         default:
             printf("[UNKNOWN]\n");
     }
@@ -100,7 +115,7 @@ void l_ghostExit(enum LoggerDetails reason) {
     Logs the ghost leaving evidence in a room.
 */
 void l_ghostEvidence(enum EvidenceType evidence, char* room) {
-    if (!LOGGING) return;
+    if (!loggingEnabled) return;
     char ev_str[MAX_STR];
     evidenceToString(evidence, ev_str);
     printf("[GHOST EVIDENCE] Ghost left [%s] in [%s]\n", ev_str, room);
@@ -110,7 +125,7 @@ void l_ghostEvidence(enum EvidenceType evidence, char* room) {
     Logs the ghost being created.
 */
 void l_ghostInit(enum GhostClass ghost, char* room) {
-    if (!LOGGING) return;
+    if (!loggingEnabled) return;
     char ghost_str[MAX_STR];
     ghostToString(ghost, ghost_str);
     printf("[GHOST INIT] Ghost is a [%s] in room [%s]\n", ghost_str, room);
@@ -1,53 +1,116 @@
 #include "defs.h"
 
-int main() {
+int main(int argc, char** argv) {
     // Initalize variables
-    HouseType house;
-    HunterType* hunter;
-    GhostType* ghost;
-    char name[MAX_STR];
-    char equipment[MAX_STR];
-    pthread_t threadIDS[NUM_HUNTERS + NUM_GHOSTS];
-    
-    // Create the house
-    initHouse(&house);
-
-    // Create the ghost and put them in the house structure        
-    initGhost(&house, &ghost);
-    
-    // Loop to create all the hunters
-    for (int i = 0; i < NUM_HUNTERS; i++) {
-        printf("Enter the name of hunter #%d: \n", i + 1);
-        scanf("%s", name);
-        while ((getchar()) != '\n');
-
-        printf("What type of data should %s collect (EMF, TEMPERATURE, FINGERPRINTS, SOUND, UNKNOWN): \n", name);
-        scanf("%s", equipment);
-        while ((getchar()) != '\n');
-
-        initHunter(house.rooms.head->data, stringToEvidence(equipment), &(house.evidence), name, &hunter);
-        addHunter(&(house.hunters), hunter);
-    }
-    
-    // Create threads for the hunters and the ghost
-    for (int i = 0; i < NUM_HUNTERS + NUM_GHOSTS; i++) {
-        if (i == 0){
-            pthread_create(threadIDS + i, NULL, runGhost, ghost);
-        } else {
-            pthread_create(threadIDS + i, NULL, runHunter, house.hunters.elements[i - 1]);
-        }
+    OptionsType options;
+    RosterType roster;
+    ResultWriter writer;
+    RunRecord record;
+    RoutingType routing;
+    SamplerType sampler;
+    ResultCache cache;
+    int status = 0;
+
+    // Read the command line options
+    initOptions(&options);
+    if (!parseOptions(&options, argc, argv)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    // Count allocations from the start, load the agent policies and pin agent threads if requested
+    setMemoryAccounting(options.memoryReport);
+    if (!loadPolicies(&options)) {
+        return 1;
+    }
+    initAffinity(options.affinity, options.numaLocal);
+
+    // Benchmarks need no hunter roster, and workers are configured by their coordinator
+    if (options.bench != NULL || options.workerPath != NULL) {
+        status = (options.bench != NULL) ? runBenchmark(&options) : !runWorker(options.workerPath);
+        unloadPolicies();
+        return status;
+    }
+
+    // Open the result file if one was requested
+    if (options.resultPath != NULL && !openResultWriter(&writer, options.resultPath, options.resultFormat)) {
+        return 1;
+    }
+
+    // Open the sample file if the runs should be sampled
+    if (options.samplePath != NULL && !openSampler(&sampler, &options)) {
+        return 1;
+    }
+
+    // Read all the hunters, prompting for each unless a bulk roster was given
+    initRoster(&roster);
+    if (options.rosterPath == NULL) {
+        readRoster(&roster);
+    } else if (!loadRoster(&roster, options.rosterPath, (options.rooms > 0) ? options.rooms : STANDARD_ROOMS)) {
+        return 1;
+    }
+    if (options.engine == EN_LANES && !plainRoster(&roster)) {
+        fprintf(stderr, "%s: the lane engine plays at most %d hunters, each starting in the Van with the standard\n"
+            "fear and boredom\n", argv[0], NUM_HUNTERS);
+        return 1;
     }
 
-    // Wait for all threads to finish
-    for (int i = 0; i < NUM_HUNTERS + NUM_GHOSTS; i++) { 
-        pthread_join(threadIDS[i], NULL);
+    // Index the results already cached for this batch
+    if (options.cachePath != NULL && !openResultCache(&cache, options.cachePath, &options, &roster)) {
+        return 1;
     }
-    
-    // End simulation and print results
-    printResults(&house);
 
-    // Clean up all memory used in the heap
-    cleanUp(&house);
+    // Hand the runs to worker processes when coordinating a distributed batch
+    if (options.coordinatePath != NULL) {
+        status = runCoordinator(&options, &roster, options.resultPath != NULL ? &writer : NULL) ? 0 : 1;
+    } else if (options.engine == EN_LANES) {
+        // Run the batch many simulations at a time in vector lanes
+        runLanes(&options, &roster, options.resultPath != NULL ? &writer : NULL, options.resultPath == NULL);
+    } else {
+        // Build the routing data shared by every run
+        prepareRouting(&options, &routing);
+
+        // Run each simulation or its branches, printing results to the console when no result file is used
+        for (int i = 0; i < options.runs; i++) {
+            if (options.branches > 0) {
+                runBranches(&options, &roster, &routing, options.seed + i, i, options.resultPath != NULL ? &writer : NULL);
+                continue;
+            }
+
+            // Only run what the cache does not already hold
+            if (options.cachePath != NULL && lookupResult(&cache, options.seed + i, i, &record)) {
+                if (options.resultPath == NULL) {
+                    printf("[CACHE] run %d: found in the cache, %s\n", i, record.outcome ? "hunters win" : "ghost wins");
+                }
+            } else {
+                runSimulation(&options, &roster, &routing, options.samplePath != NULL ? &sampler : NULL, options.seed + i, i, &record, options.resultPath == NULL);
+                if (options.cachePath != NULL) {
+                    storeResult(&cache, &record);
+                }
+            }
+            if (options.resultPath != NULL) {
+                writeResult(&writer, &record);
+            }
+        }
+        cleanRouting(&routing);
+    }
+
+    // Flush the results and clean up all memory used in the heap
+    if (options.resultPath != NULL && !closeResultWriter(&writer)) {
+        status = 1;
+    }
+    if (options.samplePath != NULL) {
+        closeSampler(&sampler);
+    }
+    if (options.cachePath != NULL) {
+        closeResultCache(&cache);
+    }
+    cleanRoster(&roster);
+    cleanNames();
+    unloadPolicies();
+    if (options.memoryReport) {
+        printMemoryReport();
+    }
 
-    return 0;
-}
\ No newline at end of file
+    return status;
+}
@@ -0,0 +1,260 @@
+#include "defs.h"
+#include <sys/resource.h>
+
+/*
+    Memory accounting counts the bytes and blocks each subsystem allocates and frees. It is off
+    unless "--memory" turns it on, and then costs one predictable branch per allocation.
+
+    Every thread counts into its own block of counters, so counting takes no lock and shares
+    no cache line. A block is only written by its thread. Other threads read it to add up the
+    totals. When a thread exits, its counts are folded into the retired totals and its block
+    is freed for the next thread to reuse, so a long batch keeps as many blocks as it ever
+    had threads at once.
+
+    A subsystem's peak is checked on every allocation: the allocating thread adds up the live
+    bytes of every block and raises the peak if the sum is larger. Checking only when a thread
+    passes its own earlier high would miss peaks, as a thread's count drops when it frees
+    bytes another thread allocated. Live counts are stored and read sequentially consistent,
+    so of two threads allocating at once at least one sees both, and the peak is never low.
+    A thread exiting while the sum is taken can make it read slightly high.
+*/
+
+typedef struct MemoryBlock {
+    _Atomic int64_t  live[MEM_COUNT];       // bytes allocated minus bytes freed by the thread
+    _Atomic uint64_t allocs[MEM_COUNT];     // blocks allocated by the thread
+    _Atomic uint64_t frees[MEM_COUNT];      // blocks freed by the thread
+    _Atomic int      inUse;                 // whether a running thread owns the block
+    struct MemoryBlock* next;               // next block in the list of every block
+} MemoryBlock;
+
+static int accounting = C_FALSE;
+static _Atomic(MemoryBlock*) blocks = NULL;
+static MemoryBlock retired;
+static _Atomic int64_t peaks[MEM_COUNT];
+static __thread MemoryBlock* threadBlock = NULL;
+static pthread_key_t exitKey;
+static pthread_once_t exitKeyOnce = PTHREAD_ONCE_INIT;
+
+/*
+    Folds the counts of an exiting thread into the retired totals and frees its block.
+*/
+static void retireBlock(void* ptr) {
+    MemoryBlock* block = (MemoryBlock*) ptr;
+
+    for (int s = 0; s < MEM_COUNT; s++) {
+        atomic_fetch_add(&(retired.live[s]), atomic_load(&(block->live[s])));
+        atomic_fetch_add(&(retired.allocs[s]), atomic_load(&(block->allocs[s])));
+        atomic_fetch_add(&(retired.frees[s]), atomic_load(&(block->frees[s])));
+        atomic_store(&(block->live[s]), 0);
+        atomic_store(&(block->allocs[s]), 0);
+        atomic_store(&(block->frees[s]), 0);
+    }
+    atomic_store(&(block->inUse), C_FALSE);
+}
+
+static void createExitKey(void) {
+    pthread_key_create(&exitKey, retireBlock);
+}
+
+/*
+    Returns the calling thread's block, claiming a free one or adding a new one on first use.
+*/
+static MemoryBlock* ownBlock(void) {
+    MemoryBlock* block;
+
+    if (threadBlock != NULL) {
+        return threadBlock;
+    }
+    for (block = atomic_load(&blocks); block != NULL; block = block->next) {
+        int unowned = C_FALSE;
+        if (atomic_compare_exchange_strong(&(block->inUse), &unowned, C_TRUE)) {
+            break;
+        }
+    }
+    if (block == NULL) {
+        block = allocCacheAligned(sizeof(MemoryBlock));
+        memset(block, 0, sizeof(MemoryBlock));
+        block->inUse = C_TRUE;
+        block->next = atomic_load(&blocks);
+        while (!atomic_compare_exchange_weak(&blocks, &(block->next), block));
+    }
+
+    pthread_once(&exitKeyOnce, createExitKey);
+    pthread_setspecific(exitKey, block);
+    threadBlock = block;
+    return block;
+}
+
+/*
+    Adds up the live bytes of subsystem 's' over every thread.
+*/
+static int64_t liveBytes(enum MemorySubsystem s) {
+    int64_t total = atomic_load(&(retired.live[s]));
+
+    for (MemoryBlock* block = atomic_load(&blocks); block != NULL; block = block->next) {
+        total += atomic_load(&(block->live[s]));
+    }
+    return total;
+}
+
+/*  Function: void setMemoryAccounting(int enabled)
+    Purpose: Turns memory accounting on or off for allocations made afterwards, call before
+        any thread other than the main thread allocates
+*/
+void setMemoryAccounting(int enabled) {
+    accounting = enabled;
+}
+
+/*  Function: int memoryAccounting()
+    Purpose: Returns C_TRUE if memory accounting is on
+*/
+int memoryAccounting(void) {
+    return accounting;
+}
+
+/*  Function: void countAlloc(enum MemorySubsystem s, size_t size)
+    Purpose: Counts a block of 'size' bytes allocated for subsystem 's'
+*/
+void countAlloc(enum MemorySubsystem s, size_t size) {
+    MemoryBlock* block;
+    int64_t total, peak;
+
+    if (!accounting) {
+        return;
+    }
+    block = ownBlock();
+    atomic_store(&(block->live[s]), atomic_load_explicit(&(block->live[s]), memory_order_relaxed) + size);
+    atomic_store_explicit(&(block->allocs[s]), atomic_load_explicit(&(block->allocs[s]), memory_order_relaxed) + 1, memory_order_relaxed);
+
+    // Any allocation can set a new peak, whatever this thread counted before
+    total = liveBytes(s);
+    peak = atomic_load_explicit(&(peaks[s]), memory_order_relaxed);
+    while (total > peak && !atomic_compare_exchange_weak(&(peaks[s]), &peak, total));
+}
+
+/*  Function: void countFree(enum MemorySubsystem s, size_t size)
+    Purpose: Counts a block of 'size' bytes of subsystem 's' being freed
+*/
+void countFree(enum MemorySubsystem s, size_t size) {
+    MemoryBlock* block;
+
+    if (!accounting) {
+        return;
+    }
+    block = ownBlock();
+    atomic_store_explicit(&(block->live[s]), atomic_load_explicit(&(block->live[s]), memory_order_relaxed) - size, memory_order_relaxed);
+    atomic_store_explicit(&(block->frees[s]), atomic_load_explicit(&(block->frees[s]), memory_order_relaxed) + 1, memory_order_relaxed);
+}
+
+/*  Function: void* trackedMalloc(enum MemorySubsystem s, size_t size)
+    Purpose: Allocates 'size' bytes for subsystem 's' like malloc
+*/
+void* trackedMalloc(enum MemorySubsystem s, size_t size) {
+    void* ptr = malloc(size);
+    if (ptr != NULL) {
+        countAlloc(s, size);
+    }
+    return ptr;
+}
+
+/*  Function: void* trackedCalloc(enum MemorySubsystem s, size_t count, size_t size)
+    Purpose: Allocates 'count' zeroed elements of 'size' bytes for subsystem 's' like calloc
+*/
+void* trackedCalloc(enum MemorySubsystem s, size_t count, size_t size) {
+    void* ptr = calloc(count, size);
+    if (ptr != NULL) {
+        countAlloc(s, count * size);
+    }
+    return ptr;
+}
+
+/*  Function: void* trackedRealloc(enum MemorySubsystem s, void* ptr, size_t oldSize, size_t size)
+    Purpose: Resizes the block at 'ptr' of subsystem 's' from 'oldSize' to 'size' bytes like
+        realloc, a NULL 'ptr' allocates a new block
+*/
+void* trackedRealloc(enum MemorySubsystem s, void* ptr, size_t oldSize, size_t size) {
+    void* resized = realloc(ptr, size);
+    if (resized != NULL) {
+        if (ptr != NULL) {
+            countFree(s, oldSize);
+        }
+        countAlloc(s, size);
+    }
+    return resized;
+}
+
+/*  Function: void trackedFree(enum MemorySubsystem s, void* ptr, size_t size)
+    Purpose: Frees the block of 'size' bytes at 'ptr' that subsystem 's' allocated, like free
+*/
+void trackedFree(enum MemorySubsystem s, void* ptr, size_t size) {
+    if (ptr != NULL) {
+        countFree(s, size);
+        free(ptr);
+    }
+}
+
+/*  Function: void memoryTotals(MemoryTotals* totals)
+    Purpose: Adds up the counts of every thread into 'totals'
+*/
+void memoryTotals(MemoryTotals* totals) {
+    for (int s = 0; s < MEM_COUNT; s++) {
+        totals->live[s] = liveBytes(s);
+        totals->allocs[s] = atomic_load(&(retired.allocs[s]));
+        totals->frees[s] = atomic_load(&(retired.frees[s]));
+        for (MemoryBlock* block = atomic_load(&blocks); block != NULL; block = block->next) {
+            totals->allocs[s] += atomic_load(&(block->allocs[s]));
+            totals->frees[s] += atomic_load(&(block->frees[s]));
+        }
+        totals->peak[s] = atomic_load(&(peaks[s]));
+    }
+}
+
+/*  Function: char* memorySubsystemName(enum MemorySubsystem s)
+    Purpose: Returns the name of subsystem 's'
+*/
+char* memorySubsystemName(enum MemorySubsystem s) {
+    static char* names[] = {"topology", "evidence", "agents", "names", "logging"};
+    return (s >= 0 && s < MEM_COUNT) ? names[s] : "unknown";
+}
+
+/*  Function: int64_t reportLeaks(MemoryTotals* before, uint32_t run)
+    Purpose: Prints the topology, evidence and agent blocks allocated since the totals 'before'
+        were taken that are still live, call once run 'run' is cleaned up. Names and logging
+        buffers live for the whole batch and are not checked. Returns the bytes leaked
+*/
+int64_t reportLeaks(MemoryTotals* before, uint32_t run) {
+    static enum MemorySubsystem checked[] = {MEM_TOPOLOGY, MEM_EVIDENCE, MEM_AGENTS};
+    MemoryTotals after;
+    int64_t leaked = 0;
+
+    memoryTotals(&after);
+    for (size_t i = 0; i < sizeof(checked) / sizeof(checked[0]); i++) {
+        enum MemorySubsystem s = checked[i];
+        int64_t bytes = after.live[s] - before->live[s];
+        int64_t count = (after.allocs[s] - before->allocs[s]) - (after.frees[s] - before->frees[s]);
+        if (bytes != 0 || count != 0) {
+            printf("[MEMORY] run %u: %lld bytes in %lld blocks of %s not freed by cleanUp\n", run,
+                (long long) bytes, (long long) count, memorySubsystemName(s));
+            leaked += bytes;
+        }
+    }
+    return leaked;
+}
+
+/*  Function: void printMemoryReport()
+    Purpose: Prints the live and peak bytes and the blocks allocated and freed by each subsystem,
+        and the peak resident set size of the process
+*/
+void printMemoryReport(void) {
+    MemoryTotals totals;
+    struct rusage usage;
+
+    memoryTotals(&totals);
+    getrusage(RUSAGE_SELF, &usage);
+    printf("[MEMORY] %-10s %14s %14s %12s %12s\n", "subsystem", "live_bytes", "peak_bytes", "allocs", "frees");
+    for (int s = 0; s < MEM_COUNT; s++) {
+        printf("[MEMORY] %-10s %14lld %14lld %12llu %12llu\n", memorySubsystemName(s), (long long) totals.live[s],
+            (long long) totals.peak[s], (unsigned long long) totals.allocs[s], (unsigned long long) totals.frees[s]);
+    }
+    printf("[MEMORY] peak RSS %ld kB\n", usage.ru_maxrss);
+}
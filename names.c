@@ -0,0 +1,101 @@
+#include "defs.h"
+
+/*
+    All room and hunter names live once in a single process wide string table. A name is
+    referred to by its 32-bit offset into the table, interning the same string again returns
+    the same offset. Interning happens while houses and hunters are set up, lookups are read only.
+*/
+
+static StringTable names = {NULL, 0, 0, NULL, 0, 0};
+
+/*
+    Returns the FNV-1a hash of the string 'str'.
+*/
+static uint32_t hashName(const char* str) {
+    uint32_t hash = 2166136261u;
+    while (*str != '\0') {
+        hash = (hash ^ (unsigned char) *str++) * 16777619u;
+    }
+    return hash;
+}
+
+/*
+    Doubles the number of hash slots and reinserts every interned name.
+*/
+static void growSlots(void) {
+    uint32_t oldCount = names.slotCount;
+    uint32_t* oldSlots = names.slots;
+
+    names.slotCount = (oldCount == 0) ? 64 : oldCount * 2;
+    names.slots = trackedCalloc(MEM_NAMES, names.slotCount, sizeof(uint32_t));
+    for (uint32_t i = 0; i < oldCount; i++) {
+        if (oldSlots[i] != 0) {
+            uint32_t slot = hashName(names.data + oldSlots[i] - 1) & (names.slotCount - 1);
+            while (names.slots[slot] != 0) {
+                slot = (slot + 1) & (names.slotCount - 1);
+            }
+            names.slots[slot] = oldSlots[i];
+        }
+    }
+    trackedFree(MEM_NAMES, oldSlots, oldCount * sizeof(uint32_t));
+}
+
+/*  Function: uint32_t internName(const char* str)
+    Purpose: Returns the offset of the string 'str' in the string table, adding it to the
+        table if it has not been interned before
+*/
+uint32_t internName(const char* str) {
+    uint32_t len = strlen(str) + 1;
+    uint32_t slot;
+
+    // Keep the hash table at most half full
+    if ((names.count + 1) * 2 > names.slotCount) {
+        growSlots();
+    }
+
+    // Slots hold offset + 1 so that 0 marks an empty slot
+    slot = hashName(str) & (names.slotCount - 1);
+    while (names.slots[slot] != 0) {
+        if (!strcmp(names.data + names.slots[slot] - 1, str)) {
+            return names.slots[slot] - 1;
+        }
+        slot = (slot + 1) & (names.slotCount - 1);
+    }
+
+    // Append the string to the table, doubling the table when full
+    if (names.size + len > names.capacity) {
+        uint32_t oldCapacity = names.capacity;
+        while (names.size + len > names.capacity) {
+            names.capacity = (names.capacity == 0) ? 4096 : names.capacity * 2;
+        }
+        names.data = trackedRealloc(MEM_NAMES, names.data, oldCapacity, names.capacity);
+    }
+    memcpy(names.data + names.size, str, len);
+    names.slots[slot] = names.size + 1;
+    names.size += len;
+    names.count++;
+    return names.slots[slot] - 1;
+}
+
+/*  Function: char* nameOf(uint32_t name)
+    Purpose: Returns the string stored at offset 'name' of the string table
+*/
+char* nameOf(uint32_t name) {
+    return names.data + name;
+}
+
+/*  Function: size_t nameTableBytes()
+    Purpose: Returns the number of bytes of string data held by the string table
+*/
+size_t nameTableBytes(void) {
+    return names.size;
+}
+
+/*  Function: void cleanNames()
+    Purpose: Deallocates the string table, every previously interned offset becomes invalid
+*/
+void cleanNames(void) {
+    trackedFree(MEM_NAMES, names.data, names.capacity);
+    trackedFree(MEM_NAMES, names.slots, names.slotCount * sizeof(uint32_t));
+    memset(&names, 0, sizeof(names));
+}
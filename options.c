@@ -0,0 +1,422 @@
+#include "defs.h"
+
+// Codes of options that only have a long form
+enum LongOptions { OPT_NUMA_LOCAL = 256, OPT_BENCH, OPT_HUNTERS, OPT_TURNS, OPT_LOCK, OPT_GHOST, OPT_HUNTER_WAIT, OPT_GHOST_WAIT, OPT_PACING, OPT_SPEED, OPT_EVIDENCE_CAP, OPT_EVIDENCE_TTL,
+    OPT_SAMPLES, OPT_SAMPLE_US, OPT_SAMPLE_TURNS, OPT_BRANCHES, OPT_BRANCH_AT, OPT_COORDINATE, OPT_WORKER, OPT_WORKERS, OPT_CHUNK,
+    OPT_HUNTER_POLICY, OPT_GHOST_POLICY, OPT_MEMORY, OPT_ENGINE, OPT_ROOM_ORDER, OPT_CACHE, OPT_ROSTER };
+
+/*  Function: void initOptions(OptionsType* options)
+    Purpose: Initializes the options structure found at the pointer 'options' to the
+        default behaviour of a single simulation printed to the console
+*/
+void initOptions(OptionsType* options) {
+    options->runs = 1;
+    options->seed = (uint64_t) time(NULL) ^ ((uint64_t) getpid() << 32);
+    options->rooms = 0;
+    options->roomOrder = RO_CREATION;
+    options->resultPath = NULL;
+    options->resultFormat = RF_NONE;
+    options->cachePath = NULL;
+    options->rosterPath = NULL;
+    options->affinity = AF_NONE;
+    options->numaLocal = C_FALSE;
+    options->bench = NULL;
+    options->benchHunters = 64;
+    options->benchTurns = 20000;
+    options->lockSweep = C_TRUE;
+    options->movement = MV_RANDOM;
+    options->haunting = GM_RANDOM;
+    options->hunterWait = HUNTER_WAIT;
+    options->ghostWait = GHOST_WAIT;
+    options->pacing = PC_RELATIVE;
+    options->speed = 1.0;
+    options->evidenceCapacity = EVIDENCE_CAPACITY;
+    options->evidenceTtl = 0;
+    options->samplePath = NULL;
+    options->sampleMicros = 1000;
+    options->sampleTurns = 0;
+    options->branches = 0;
+    options->branchTurn = 0;
+    options->coordinatePath = NULL;
+    options->workerPath = NULL;
+    options->workers = 0;
+    options->chunkRuns = DISTRIB_CHUNK;
+    options->hunterPolicy = NULL;
+    options->ghostPolicy = NULL;
+    options->memoryReport = C_FALSE;
+    options->engine = EN_THREADS;
+}
+
+/*  Function: int parseOptions(OptionsType* options, int argc, char** argv)
+    Purpose: Parses the command line arguments into the options structure at the pointer
+        'options', returns C_TRUE on success and C_FALSE if an argument was invalid
+*/
+int parseOptions(OptionsType* options, int argc, char** argv) {
+    static struct option longOptions[] = {
+        {"runs",   required_argument, NULL, 'n'},
+        {"seed",   required_argument, NULL, 's'},
+        {"rooms",  required_argument, NULL, 'r'},
+        {"output", required_argument, NULL, 'o'},
+        {"format", required_argument, NULL, 'f'},
+        {"affinity",   required_argument, NULL, 'a'},
+        {"movement",   required_argument, NULL, 'm'},
+        {"numa-local", no_argument,       NULL, OPT_NUMA_LOCAL},
+        {"bench",      required_argument, NULL, OPT_BENCH},
+        {"hunters",    required_argument, NULL, OPT_HUNTERS},
+        {"turns",      required_argument, NULL, OPT_TURNS},
+        {"lock",       required_argument, NULL, OPT_LOCK},
+        {"ghost",      required_argument, NULL, OPT_GHOST},
+        {"hunter-wait", required_argument, NULL, OPT_HUNTER_WAIT},
+        {"ghost-wait", required_argument, NULL, OPT_GHOST_WAIT},
+        {"pacing",     required_argument, NULL, OPT_PACING},
+        {"speed",      required_argument, NULL, OPT_SPEED},
+        {"evidence-cap", required_argument, NULL, OPT_EVIDENCE_CAP},
+        {"evidence-ttl", required_argument, NULL, OPT_EVIDENCE_TTL},
+        {"samples",    required_argument, NULL, OPT_SAMPLES},
+        {"sample-us",  required_argument, NULL, OPT_SAMPLE_US},
+        {"sample-turns", required_argument, NULL, OPT_SAMPLE_TURNS},
+        {"branches",   required_argument, NULL, OPT_BRANCHES},
+        {"branch-at",  required_argument, NULL, OPT_BRANCH_AT},
+        {"coordinate", required_argument, NULL, OPT_COORDINATE},
+        {"worker",     required_argument, NULL, OPT_WORKER},
+        {"workers",    required_argument, NULL, OPT_WORKERS},
+        {"chunk",      required_argument, NULL, OPT_CHUNK},
+        {"hunter-policy", required_argument, NULL, OPT_HUNTER_POLICY},
+        {"ghost-policy", required_argument, NULL, OPT_GHOST_POLICY},
+        {"memory",     no_argument,       NULL, OPT_MEMORY},
+        {"engine",     required_argument, NULL, OPT_ENGINE},
+        {"room-order", required_argument, NULL, OPT_ROOM_ORDER},
+        {"cache",      required_argument, NULL, OPT_CACHE},
+        {"roster",     required_argument, NULL, OPT_ROSTER},
+        {"help",   no_argument,       NULL, 'h'},
+        {NULL,     0,                 NULL, 0}
+    };
+    int opt, lanes;
+
+    // Loop over each argument and set the corresponding option
+    while ((opt = getopt_long(argc, argv, "n:s:r:o:f:a:m:h", longOptions, NULL)) != -1) {
+        switch (opt) {
+            case 'n':
+                options->runs = atoi(optarg);
+                if (options->runs < 1) {
+                    fprintf(stderr, "%s: runs must be at least 1\n", argv[0]);
+                    return C_FALSE;
+                }
+                break;
+            case 's':
+                options->seed = strtoull(optarg, NULL, 0);
+                break;
+            case 'r':
+                options->rooms = atoi(optarg);
+                if (options->rooms < 2) {
+                    fprintf(stderr, "%s: a generated house needs at least 2 rooms\n", argv[0]);
+                    return C_FALSE;
+                }
+                break;
+            case 'o':
+                options->resultPath = optarg;
+                break;
+            case 'f':
+                if (!strcmp(optarg, "csv")) {
+                    options->resultFormat = RF_CSV;
+                } else if (!strcmp(optarg, "bin")) {
+                    options->resultFormat = RF_BINARY;
+                } else {
+                    fprintf(stderr, "%s: unknown result format '%s'\n", argv[0], optarg);
+                    return C_FALSE;
+                }
+                break;
+            case 'a':
+                if (!strcmp(optarg, "none")) {
+                    options->affinity = AF_NONE;
+                } else if (!strcmp(optarg, "compact")) {
+                    options->affinity = AF_COMPACT;
+                } else if (!strcmp(optarg, "scatter")) {
+                    options->affinity = AF_SCATTER;
+                } else {
+                    fprintf(stderr, "%s: unknown affinity '%s'\n", argv[0], optarg);
+                    return C_FALSE;
+                }
+                break;
+            case 'm':
+                if (!strcmp(optarg, "random")) {
+                    options->movement = MV_RANDOM;
+                } else if (!strcmp(optarg, "evidence")) {
+                    options->movement = MV_EVIDENCE;
+                } else if (!strcmp(optarg, "van")) {
+                    options->movement = MV_VAN;
+                } else if (!strcmp(optarg, "collect")) {
+                    options->movement = MV_COLLECT;
+                } else {
+                    fprintf(stderr, "%s: unknown movement policy '%s'\n", argv[0], optarg);
+                    return C_FALSE;
+                }
+                break;
+            case OPT_NUMA_LOCAL:
+                options->numaLocal = C_TRUE;
+                break;
+            case OPT_BENCH:
+                options->bench = optarg;
+                break;
+            case OPT_HUNTERS:
+                options->benchHunters = atoi(optarg);
+                if (options->benchHunters < 1) {
+                    fprintf(stderr, "%s: hunters must be at least 1\n", argv[0]);
+                    return C_FALSE;
+                }
+                break;
+            case OPT_TURNS:
+                options->benchTurns = atoi(optarg);
+                if (options->benchTurns < 1) {
+                    fprintf(stderr, "%s: turns must be at least 1\n", argv[0]);
+                    return C_FALSE;
+                }
+                break;
+            case OPT_LOCK:
+                if (!setLockBackend(optarg)) {
+                    fprintf(stderr, "%s: unknown lock backend '%s'\n", argv[0], optarg);
+                    return C_FALSE;
+                }
+                options->lockSweep = C_FALSE;
+                break;
+            case OPT_HUNTER_WAIT:
+                options->hunterWait = atol(optarg);
+                if (options->hunterWait < 0) {
+                    fprintf(stderr, "%s: waits cannot be negative\n", argv[0]);
+                    return C_FALSE;
+                }
+                break;
+            case OPT_GHOST_WAIT:
+                options->ghostWait = atol(optarg);
+                if (options->ghostWait < 0) {
+                    fprintf(stderr, "%s: waits cannot be negative\n", argv[0]);
+                    return C_FALSE;
+                }
+                break;
+            case OPT_PACING:
+                if (!strcmp(optarg, "relative")) {
+                    options->pacing = PC_RELATIVE;
+                } else if (!strcmp(optarg, "absolute")) {
+                    options->pacing = PC_ABSOLUTE;
+                } else {
+                    fprintf(stderr, "%s: unknown pacing '%s'\n", argv[0], optarg);
+                    return C_FALSE;
+                }
+                break;
+            case OPT_SPEED:
+                options->speed = atof(optarg);
+                if (!(options->speed > 0)) {
+                    fprintf(stderr, "%s: speed must be greater than 0\n", argv[0]);
+                    return C_FALSE;
+                }
+                break;
+            case OPT_EVIDENCE_CAP:
+                options->evidenceCapacity = atoi(optarg);
+                if (options->evidenceCapacity < 0) {
+                    fprintf(stderr, "%s: evidence capacity cannot be negative\n", argv[0]);
+                    return C_FALSE;
+                }
+                break;
+            case OPT_EVIDENCE_TTL:
+                if (atol(optarg) < 0) {
+                    fprintf(stderr, "%s: evidence lifetime cannot be negative\n", argv[0]);
+                    return C_FALSE;
+                }
+                options->evidenceTtl = atol(optarg);
+                break;
+            case OPT_SAMPLES:
+                options->samplePath = optarg;
+                break;
+            case OPT_SAMPLE_US:
+                options->sampleMicros = atol(optarg);
+                if (options->sampleMicros < 1) {
+                    fprintf(stderr, "%s: sample interval must be at least 1 microsecond\n", argv[0]);
+                    return C_FALSE;
+                }
+                break;
+            case OPT_SAMPLE_TURNS:
+                options->sampleTurns = atoi(optarg);
+                if (options->sampleTurns < 0) {
+                    fprintf(stderr, "%s: sample interval cannot be negative\n", argv[0]);
+                    return C_FALSE;
+                }
+                break;
+            case OPT_BRANCHES:
+                options->branches = atoi(optarg);
+                if (options->branches < 0) {
+                    fprintf(stderr, "%s: branches cannot be negative\n", argv[0]);
+                    return C_FALSE;
+                }
+                break;
+            case OPT_BRANCH_AT:
+                if (!strcmp(optarg, "evidence")) {
+                    options->branchTurn = 0;
+                } else if (atoi(optarg) > 0) {
+                    options->branchTurn = atoi(optarg);
+                } else {
+                    fprintf(stderr, "%s: branch at 'evidence' or a ghost turn, not '%s'\n", argv[0], optarg);
+                    return C_FALSE;
+                }
+                break;
+            case OPT_COORDINATE:
+                options->coordinatePath = optarg;
+                break;
+            case OPT_WORKER:
+                options->workerPath = optarg;
+                break;
+            case OPT_WORKERS:
+                options->workers = atoi(optarg);
+                if (options->workers < 0 || options->workers > DISTRIB_WORKERS) {
+                    fprintf(stderr, "%s: workers must be between 0 and %d\n", argv[0], DISTRIB_WORKERS);
+                    return C_FALSE;
+                }
+                break;
+            case OPT_CHUNK:
+                options->chunkRuns = atoi(optarg);
+                if (options->chunkRuns < 1) {
+                    fprintf(stderr, "%s: chunks must hold at least 1 run\n", argv[0]);
+                    return C_FALSE;
+                }
+                break;
+            case OPT_HUNTER_POLICY:
+                options->hunterPolicy = optarg;
+                break;
+            case OPT_GHOST_POLICY:
+                options->ghostPolicy = optarg;
+                break;
+            case OPT_MEMORY:
+                options->memoryReport = C_TRUE;
+                break;
+            case OPT_ENGINE:
+                if (!strcmp(optarg, "threads")) {
+                    options->engine = EN_THREADS;
+                } else if (!strcmp(optarg, "lanes")) {
+                    options->engine = EN_LANES;
+                } else {
+                    fprintf(stderr, "%s: unknown engine '%s'\n", argv[0], optarg);
+                    return C_FALSE;
+                }
+                break;
+            case OPT_CACHE:
+                options->cachePath = optarg;
+                break;
+            case OPT_ROSTER:
+                options->rosterPath = optarg;
+                break;
+            case OPT_ROOM_ORDER:
+                if (!strcmp(optarg, "creation")) {
+                    options->roomOrder = RO_CREATION;
+                } else if (!strcmp(optarg, "bfs")) {
+                    options->roomOrder = RO_BFS;
+                } else if (!strcmp(optarg, "rcm")) {
+                    options->roomOrder = RO_RCM;
+                } else {
+                    fprintf(stderr, "%s: unknown room order '%s'\n", argv[0], optarg);
+                    return C_FALSE;
+                }
+                break;
+            case OPT_GHOST:
+                if (!strcmp(optarg, "random")) {
+                    options->haunting = GM_RANDOM;
+                } else if (!strcmp(optarg, "seek")) {
+                    options->haunting = GM_SEEK;
+                } else if (!strcmp(optarg, "avoid")) {
+                    options->haunting = GM_AVOID;
+                } else {
+                    fprintf(stderr, "%s: unknown ghost policy '%s'\n", argv[0], optarg);
+                    return C_FALSE;
+                }
+                break;
+            default:
+                return C_FALSE;
+        }
+    }
+
+    // Writing results defaults to csv
+    if (options->resultPath != NULL && options->resultFormat == RF_NONE) {
+        options->resultFormat = RF_CSV;
+    }
+
+    // The speed scales the waits whichever order the options came in
+    options->hunterWait = (long) (options->hunterWait / options->speed + 0.5);
+    options->ghostWait = (long) (options->ghostWait / options->speed + 0.5);
+
+    // Workers only run plain simulations
+    if (options->coordinatePath != NULL && (options->branches > 0 || options->samplePath != NULL)) {
+        fprintf(stderr, "%s: a distributed batch cannot branch or sample its runs\n", argv[0]);
+        return C_FALSE;
+    }
+
+    // Cached runs are looked up one at a time on the threaded engine
+    if (options->cachePath != NULL && (options->engine != EN_THREADS || options->branches > 0
+        || options->samplePath != NULL || options->coordinatePath != NULL)) {
+        fprintf(stderr, "%s: the result cache serves the threaded engine, without branching, sampling or distribution\n", argv[0]);
+        return C_FALSE;
+    }
+
+    // The lane engine, and the benchmarks running it, play the plain rules with random agents only
+    lanes = options->engine == EN_LANES || (options->bench != NULL && (!strcmp(options->bench, "lanes")
+        || !strcmp(options->bench, "equivalence")));
+    if (lanes && (options->movement != MV_RANDOM || options->haunting != GM_RANDOM
+        || options->hunterPolicy != NULL || options->ghostPolicy != NULL || options->evidenceTtl > 0
+        || options->evidenceCapacity < 1 || options->evidenceCapacity > LANE_EVIDENCE_MAX
+        || options->branches > 0 || options->samplePath != NULL || options->coordinatePath != NULL)) {
+        fprintf(stderr, "%s: the lane engine needs random movement and policies, no evidence lifetime, an explicit\n"
+            "--evidence-cap of 1 to %d and no branching, sampling or distribution\n", argv[0], LANE_EVIDENCE_MAX);
+        return C_FALSE;
+    }
+    return C_TRUE;
+}
+
+/*  Function: void printUsage(char* program)
+    Purpose: Prints the available command line options to the console
+*/
+void printUsage(char* program) {
+    printf("Usage: %s [options] [< data.txt]\n", program);
+    printf("  -n, --runs N         run N simulations (default 1)\n");
+    printf("  -s, --seed S         seed of the first run, run i uses S + i\n");
+    printf("  -r, --rooms N        generate a house of N connected rooms instead of the standard house\n");
+    printf("      --room-order ORDER number and allocate rooms in creation (default), bfs (from the van) or\n");
+    printf("                       rcm (reverse Cuthill-McKee) order so connected rooms sit close in memory\n");
+    printf("  -m, --movement MODE  hunter movement: random (default), evidence (head to the latest evidence)\n");
+    printf("                       van (head back to the van when afraid) or collect (head to nearby\n");
+    printf("                       evidence of their own type)\n");
+    printf("  -o, --output PATH    write one result record per run to PATH\n");
+    printf("  -f, --format FORMAT  result format, csv (default) or bin\n");
+    printf("      --cache PATH     reuse the results of runs already in the cache file PATH and add new ones\n");
+    printf("      --roster PATH    read the hunters without prompting from PATH, or stdin if '-', one per line\n");
+    printf("                       as: name equipment [room=ID] [fear=N] [boredom=N], rooms by creation order,\n");
+    printf("                       each run playing the next %d hunters of a longer roster\n", NUM_HUNTERS);
+    printf("  -a, --affinity MODE  pin agent threads to cpus: none (default), compact or scatter\n");
+    printf("      --ghost MODE     ghost movement: random (default), seek or avoid the rooms near hunters\n");
+    printf("      --hunter-policy P policy choosing hunter actions: random (default) or the path of a policy .so\n");
+    printf("      --ghost-policy P policy choosing ghost actions: random (default) or the path of a policy .so\n");
+    printf("      --hunter-wait US microseconds a hunter sleeps after each turn (default %d)\n", HUNTER_WAIT);
+    printf("      --ghost-wait US  microseconds the ghost sleeps after each turn (default %d)\n", GHOST_WAIT);
+    printf("      --pacing MODE    relative (default) sleeps the wait after each turn, absolute starts a\n");
+    printf("                       turn every wait on a fixed grid and reports how late the agents were\n");
+    printf("      --speed X        divide the hunter and ghost waits by X (default 1)\n");
+    printf("      --evidence-cap N most evidence a room holds, oldest dropped first, 0 for no limit (default)\n");
+    printf("      --evidence-ttl N ghost turns evidence lasts before it expires, 0 for forever (default)\n");
+    printf("      --samples PATH   record a time series of every run to PATH\n");
+    printf("      --sample-us N    microseconds between samples (default 1000)\n");
+    printf("      --sample-turns N sample every N ghost turns instead of by wall clock time\n");
+    printf("      --branches N     fork N continuations of each run at the branch event, seeded apart\n");
+    printf("      --branch-at WHEN branch at the ghost's first 'evidence' (default) or at a ghost turn\n");
+    printf("      --coordinate PATH hand the runs out in chunks to workers connecting to the socket PATH\n");
+    printf("      --workers N      local worker processes the coordinator starts (default 0)\n");
+    printf("      --chunk N        runs handed to a worker at a time (default %d)\n", DISTRIB_CHUNK);
+    printf("      --worker PATH    run the chunks handed out by the coordinator at the socket PATH\n");
+    printf("      --memory         count allocations per subsystem, flag leaks after each run and print a\n");
+    printf("                       memory report with the peak RSS at the end\n");
+    printf("      --engine ENGINE  threads (default) runs each simulation on its own threads, lanes runs %d\n", SIMD_LANES);
+    printf("                       simulations at once in vector lanes on virtual time, with --evidence-cap 1 to %d\n", LANE_EVIDENCE_MAX);
+    printf("      --numa-local     move each agent's state to the NUMA node it is pinned on\n");
+    printf("      --lock BACKEND   lock backend: sem (default), futex, ticket or adaptive\n");
+    printf("      --bench NAME     run a benchmark instead of simulating: contention, locks, proximity,\n");
+    printf("                       scaling, policy, lanes, locality,\n");
+    printf("                       equivalence, shared, roster or summary\n");
+    printf("      --hunters N      hunter threads used by benchmarks (default 64)\n");
+    printf("      --turns N        turns each benchmark hunter takes (default 20000)\n");
+    printf("  -h, --help           print this message\n");
+}
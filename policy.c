@@ -0,0 +1,169 @@
+#include "defs.h"
+#include <dlfcn.h>
+
+/*
+    Policies choose the action each agent takes on its turn. A policy is called with an array
+    of observations, one per agent, and fills in one action per observation, so an engine that
+    steps many agents at once pays for a single call. The threaded engine steps each agent on
+    its own thread and calls the policy with one observation at a time.
+
+    The built in random policy picks actions uniformly, exactly as the agents always have.
+    Other policies are shared objects that export a PolicyApi named POLICY_SYMBOL and may
+    decide for hunters, for the ghost or for both. Decisions are made on the agent threads,
+    so a policy's decide functions must be safe to call from several threads at once.
+*/
+
+typedef struct {
+    const PolicyApi* api;           // callbacks of the policy
+    void*            state;         // state the policy created, passed to every callback
+    void*            handle;        // shared object the policy came from, NULL if built in
+} PolicyType;
+
+/*
+    Built in random policy, draws from the calling agent's random stream.
+*/
+static void randomHunters(void* state, const ObservationType* observations, int count, uint8_t* actions) {
+    (void) state;
+    (void) observations;
+    for (int i = 0; i < count; i++) {
+        actions[i] = randomHunterAction();
+    }
+}
+
+static void randomGhosts(void* state, const ObservationType* observations, int count, uint8_t* actions) {
+    (void) state;
+    (void) observations;
+    for (int i = 0; i < count; i++) {
+        actions[i] = randomGhostAction();
+    }
+}
+
+static const PolicyApi randomPolicy = {POLICY_API_VERSION, "random", NULL, NULL, randomHunters, randomGhosts};
+
+static PolicyType policies[PR_COUNT] = {{&randomPolicy, NULL, NULL}, {&randomPolicy, NULL, NULL}};
+
+/*
+    Fills the parts of an observation read from the room the agent is in.
+*/
+static void observeRoom(HouseType* house, RoomType* room, ObservationType* observation) {
+    RoomSnapshot snapshot;
+
+    snapshotRoom(house, room, &snapshot);
+    observation->room = room->id;
+    observation->hunters = snapshot.occupancy;
+    observation->ghost = snapshot.ghost;
+    observation->evidence = snapshot.evidenceMask;
+}
+
+/*  Function: int loadPolicy(enum PolicyRole role, char* name, uint64_t seed)
+    Purpose: Selects the policy named 'name' for the agents of 'role', either "random" or the
+        path of a policy shared object, which is created with 'seed'. Returns C_FALSE if the
+        policy could not be loaded or does not decide for 'role'
+*/
+int loadPolicy(enum PolicyRole role, char* name, uint64_t seed) {
+    static char* roles[] = {"hunters", "ghosts"};
+    void* handle;
+    const PolicyApi* api;
+
+    if (!strcmp(name, "random")) {
+        return C_TRUE;
+    }
+    handle = dlopen(name, RTLD_NOW | RTLD_LOCAL);
+    if (handle == NULL) {
+        fprintf(stderr, "%s\n", dlerror());
+        return C_FALSE;
+    }
+    api = (const PolicyApi*) dlsym(handle, POLICY_SYMBOL);
+    if (api == NULL || api->apiVersion != POLICY_API_VERSION) {
+        fprintf(stderr, "%s: no %s of policy version %d\n", name, POLICY_SYMBOL, POLICY_API_VERSION);
+        dlclose(handle);
+        return C_FALSE;
+    }
+    if ((role == PR_HUNTER ? api->decideHunters : api->decideGhosts) == NULL) {
+        fprintf(stderr, "%s: policy '%s' does not decide for %s\n", name, api->name, roles[role]);
+        dlclose(handle);
+        return C_FALSE;
+    }
+
+    policies[role].api = api;
+    policies[role].state = (api->create != NULL) ? api->create(seed) : NULL;
+    policies[role].handle = handle;
+    return C_TRUE;
+}
+
+/*  Function: int loadPolicies(OptionsType* options)
+    Purpose: Loads the hunter and ghost policies named in 'options', returns C_FALSE if either
+        could not be loaded
+*/
+int loadPolicies(OptionsType* options) {
+    return (options->hunterPolicy == NULL || loadPolicy(PR_HUNTER, options->hunterPolicy, options->seed))
+        && (options->ghostPolicy == NULL || loadPolicy(PR_GHOST, options->ghostPolicy, options->seed));
+}
+
+/*  Function: const char* policyName(enum PolicyRole role)
+    Purpose: Returns the name the policy deciding for 'role' gives itself
+*/
+const char* policyName(enum PolicyRole role) {
+    return policies[role].api->name;
+}
+
+/*  Function: void decideHunters(const ObservationType* observations, int count, uint8_t* actions)
+    Purpose: Asks the hunter policy for the enum HunterActions of 'count' hunters, given their
+        observations, and stores them in 'actions'
+*/
+void decideHunters(const ObservationType* observations, int count, uint8_t* actions) {
+    policies[PR_HUNTER].api->decideHunters(policies[PR_HUNTER].state, observations, count, actions);
+}
+
+/*  Function: void decideGhosts(const ObservationType* observations, int count, uint8_t* actions)
+    Purpose: Asks the ghost policy for the enum GhostActions of 'count' ghosts, given their
+        observations, and stores them in 'actions'
+*/
+void decideGhosts(const ObservationType* observations, int count, uint8_t* actions) {
+    policies[PR_GHOST].api->decideGhosts(policies[PR_GHOST].state, observations, count, actions);
+}
+
+/*  Function: void observeHunter(HunterType* hunter, ObservationType* observation)
+    Purpose: Fills 'observation' with what the hunter at the pointer 'hunter' knows this turn
+*/
+void observeHunter(HunterType* hunter, ObservationType* observation) {
+    observeRoom(hunter->house, hunter->room, observation);
+    observation->agent = hunter->id;
+    observation->turn = hunter->turns;
+    observation->seed = hunter->seed;
+    observation->fear = hunter->fear;
+    observation->boredom = hunter->boredom;
+    observation->equipment = hunter->equipment;
+}
+
+/*  Function: void observeGhost(GhostType* ghost, ObservationType* observation)
+    Purpose: Fills 'observation' with what the ghost at the pointer 'ghost' knows this turn
+*/
+void observeGhost(GhostType* ghost, ObservationType* observation) {
+    observeRoom(ghost->house, ghost->room, observation);
+    observation->agent = ghost->id;
+    observation->turn = ghost->turns;
+    observation->seed = ghost->seed;
+    observation->fear = 0;
+    observation->boredom = ghost->boredom;
+    observation->equipment = EV_UNKNOWN;
+}
+
+/*  Function: void unloadPolicies()
+    Purpose: Destroys the state of any loaded policies, closes their shared objects and goes
+        back to the random policy
+*/
+void unloadPolicies(void) {
+    for (int role = 0; role < PR_COUNT; role++) {
+        if (policies[role].handle == NULL) {
+            continue;
+        }
+        if (policies[role].api->destroy != NULL) {
+            policies[role].api->destroy(policies[role].state);
+        }
+        dlclose(policies[role].handle);
+        policies[role].api = &randomPolicy;
+        policies[role].state = NULL;
+        policies[role].handle = NULL;
+    }
+}
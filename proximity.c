@@ -0,0 +1,151 @@
+#include "defs.h"
+
+/*
+    The proximity index answers how many hunters are near a room without searching the house.
+    Every room's neighbourhood, the rooms within PROXIMITY_HOPS hops and their distance, is
+    found once per topology and stored with the routing data. Each run then keeps, for every
+    room, the number of hunters at each distance from it. A hunter move only touches the
+    neighbourhoods of the two rooms involved, and a query reads PROXIMITY_HOPS + 1 counters.
+*/
+
+/*  Function: void buildNeighborhoods(RoutingType* routing)
+    Purpose: Finds the rooms within PROXIMITY_HOPS hops of every room of the packed topology
+        in 'routing' with a bounded breadth first search, storing them grouped by room
+*/
+void buildNeighborhoods(RoutingType* routing) {
+    uint32_t n = routing->roomCount;
+    uint32_t* seen = trackedMalloc(MEM_TOPOLOGY, n * sizeof(uint32_t));
+    RoomId* queue = trackedMalloc(MEM_TOPOLOGY, n * sizeof(RoomId));
+    uint8_t* hops = trackedMalloc(MEM_TOPOLOGY, n);
+    uint32_t capacity = n * 8, used = 0;
+
+    routing->ballOffsets = trackedMalloc(MEM_TOPOLOGY, (n + 1) * sizeof(uint32_t));
+    routing->ballRooms = trackedMalloc(MEM_TOPOLOGY, capacity * sizeof(RoomId));
+    routing->ballHops = trackedMalloc(MEM_TOPOLOGY, capacity);
+    for (uint32_t i = 0; i < n; i++) {
+        seen[i] = UINT32_MAX;
+    }
+
+    for (RoomId source = 0; source < n; source++) {
+        uint32_t head = 0, tail = 0;
+
+        // Rooms seen from this source are stamped with it, so nothing needs clearing
+        routing->ballOffsets[source] = used;
+        seen[source] = source;
+        hops[source] = 0;
+        queue[tail++] = source;
+        while (head < tail) {
+            RoomId room = queue[head++];
+
+            if (used == capacity) {
+                routing->ballRooms = trackedRealloc(MEM_TOPOLOGY, routing->ballRooms, capacity * sizeof(RoomId), 2 * capacity * sizeof(RoomId));
+                routing->ballHops = trackedRealloc(MEM_TOPOLOGY, routing->ballHops, capacity, 2 * capacity);
+                capacity *= 2;
+            }
+            routing->ballRooms[used] = room;
+            routing->ballHops[used] = hops[room];
+            used++;
+
+            if (hops[room] == PROXIMITY_HOPS) {
+                continue;
+            }
+            for (uint32_t e = routing->offsets[room]; e < routing->offsets[room + 1]; e++) {
+                RoomId next = routing->neighbors[e];
+                if (seen[next] != source) {
+                    seen[next] = source;
+                    hops[next] = hops[room] + 1;
+                    queue[tail++] = next;
+                }
+            }
+        }
+    }
+    routing->ballOffsets[n] = used;
+
+    // Trim the neighbourhoods to their size, which is all cleanRouting knows of them
+    routing->ballRooms = trackedRealloc(MEM_TOPOLOGY, routing->ballRooms, capacity * sizeof(RoomId), used * sizeof(RoomId));
+    routing->ballHops = trackedRealloc(MEM_TOPOLOGY, routing->ballHops, capacity, used);
+
+    trackedFree(MEM_TOPOLOGY, seen, n * sizeof(uint32_t));
+    trackedFree(MEM_TOPOLOGY, queue, n * sizeof(RoomId));
+    trackedFree(MEM_TOPOLOGY, hops, n);
+}
+
+/*  Function: void initProximity(HouseType* house)
+    Purpose: Allocates the empty hunter counts of the house at the pointer 'house', if its
+        routing data holds neighbourhoods
+*/
+void initProximity(HouseType* house) {
+    house->nearby = NULL;
+    if (house->routing != NULL && house->routing->ballOffsets != NULL) {
+        house->nearby = trackedCalloc(MEM_TOPOLOGY, (size_t) house->roomCount * (PROXIMITY_HOPS + 1), sizeof(_Atomic uint32_t));
+    }
+}
+
+/*  Function: void trackHunter(HouseType* house, RoomId from, RoomId to)
+    Purpose: Updates the hunter counts of the house at the pointer 'house' for a hunter moving
+        from room 'from' to room 'to', either may be ROOM_NONE when the hunter arrives or leaves
+*/
+void trackHunter(HouseType* house, RoomId from, RoomId to) {
+    RoutingType* routing;
+
+    if (house == NULL || house->nearby == NULL) {
+        return;
+    }
+    routing = house->routing;
+
+    // Counts are independent, so relaxed updates are enough and queries see each move promptly
+    if (to != ROOM_NONE) {
+        for (uint32_t e = routing->ballOffsets[to]; e < routing->ballOffsets[to + 1]; e++) {
+            size_t slot = (size_t) routing->ballRooms[e] * (PROXIMITY_HOPS + 1) + routing->ballHops[e];
+            atomic_fetch_add_explicit(&(house->nearby[slot]), 1, memory_order_relaxed);
+        }
+    }
+    if (from != ROOM_NONE) {
+        for (uint32_t e = routing->ballOffsets[from]; e < routing->ballOffsets[from + 1]; e++) {
+            size_t slot = (size_t) routing->ballRooms[e] * (PROXIMITY_HOPS + 1) + routing->ballHops[e];
+            atomic_fetch_sub_explicit(&(house->nearby[slot]), 1, memory_order_relaxed);
+        }
+    }
+}
+
+/*  Function: int huntersWithin(HouseType* house, RoomId room, int hops)
+    Purpose: Returns the number of hunters at most 'hops' hops from 'room'. Returns 0 if the
+        house keeps no proximity index and -1 if 'hops' is outside 0 to PROXIMITY_HOPS, the
+        index counts no farther
+*/
+int huntersWithin(HouseType* house, RoomId room, int hops) {
+    _Atomic uint32_t* counts;
+    int total = 0;
+
+    if (hops < 0 || hops > PROXIMITY_HOPS) {
+        return -1;
+    }
+    if (house->nearby == NULL) {
+        return 0;
+    }
+    counts = house->nearby + (size_t) room * (PROXIMITY_HOPS + 1);
+    for (int d = 0; d <= hops; d++) {
+        total += atomic_load_explicit(&counts[d], memory_order_relaxed);
+    }
+    return total;
+}
+
+/*  Function: int nearestHunter(HouseType* house, RoomId room)
+    Purpose: Returns the distance in hops from 'room' to the closest hunter, or -1 if no
+        hunter is within PROXIMITY_HOPS hops or the house keeps no proximity index. Hunters
+        farther away are not seen, the index only counts up to PROXIMITY_HOPS
+*/
+int nearestHunter(HouseType* house, RoomId room) {
+    _Atomic uint32_t* counts;
+
+    if (house->nearby == NULL) {
+        return -1;
+    }
+    counts = house->nearby + (size_t) room * (PROXIMITY_HOPS + 1);
+    for (int d = 0; d <= PROXIMITY_HOPS; d++) {
+        if (atomic_load_explicit(&counts[d], memory_order_relaxed) > 0) {
+            return d;
+        }
+    }
+    return -1;
+}
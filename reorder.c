@@ -0,0 +1,209 @@
+#include "defs.h"
+
+/*
+    Rooms are numbered and allocated in the order the house created them, so in a large house
+    connected rooms can sit far apart in the packed arrays indexed by room id and on the heap.
+    Reordering renumbers the rooms in an order that keeps connected rooms close and moves them
+    to match: every room and its connection list are allocated again, one room after another
+    in the new order, and every room reference is pointed at the moved rooms.
+
+    bfs:   breadth first order from the Van, neighbours in connection order
+    rcm:   reverse Cuthill-McKee, a breadth first order from a room on the edge of the house
+           visiting neighbours with fewer connections first, reversed. It keeps the largest id
+           distance between connected rooms (the bandwidth) small
+
+    The Van always stays room 0, which hunters start in and flee to, so under rcm the rooms
+    after it are the reversed order with the Van taken out. Reordering runs when the topology
+    is built, before any house uses it, and draws no random numbers.
+*/
+
+/*
+    Returns the number of rooms connected to 'room'.
+*/
+static uint32_t degree(RoomType* room) {
+    return room->connectedRooms.size;
+}
+
+/*
+    Appends the rooms of a breadth first search from 'start' to 'order' from position 'count' on,
+    marking each in 'seen'. Neighbours are visited in connection order, or by fewest connections
+    first when 'byDegree' is set. Returns the new count, the last room is one of the farthest.
+*/
+static uint32_t breadthFirst(RoomType* start, int byDegree, uint8_t* seen, RoomType** order, uint32_t count) {
+    uint32_t head = count;
+
+    seen[start->id] = C_TRUE;
+    order[count++] = start;
+    while (head < count) {
+        RoomType* current = order[head++];
+        uint32_t first = count;
+
+        for (RoomNode* next = current->connectedRooms.head; next != NULL; next = next->next) {
+            if (!seen[next->data->id]) {
+                seen[next->data->id] = C_TRUE;
+                order[count++] = next->data;
+            }
+        }
+
+        // Insertion sort the rooms just found by degree, stable so ties keep connection order
+        for (uint32_t i = first + 1; byDegree && i < count; i++) {
+            RoomType* room = order[i];
+            uint32_t j = i;
+            while (j > first && degree(order[j - 1]) > degree(room)) {
+                order[j] = order[j - 1];
+                j--;
+            }
+            order[j] = room;
+        }
+    }
+    return count;
+}
+
+/*
+    Finds a room on the edge of the house to start Cuthill-McKee from: searches from the Van,
+    then from the farthest room found, a few times over.
+*/
+static RoomType* peripheralRoom(TopologyType* topology, uint8_t* seen, RoomType** order) {
+    RoomType* start = topology->roomById[0];
+
+    for (int sweep = 0; sweep < 3; sweep++) {
+        memset(seen, 0, topology->roomCount);
+        start = order[breadthFirst(start, C_FALSE, seen, order, 0) - 1];
+    }
+    return start;
+}
+
+/*  Function: double neighborSpread(TopologyType* topology)
+    Purpose: Returns the average difference in id between connected rooms of the topology at the
+        pointer 'topology', the smaller it is the closer connected rooms sit in memory
+*/
+double neighborSpread(TopologyType* topology) {
+    uint64_t total = 0, links = 0;
+
+    for (RoomNode* current = topology->rooms.head; current != NULL; current = current->next) {
+        RoomId id = current->data->id;
+        for (RoomNode* next = current->data->connectedRooms.head; next != NULL; next = next->next) {
+            total += (next->data->id > id) ? next->data->id - id : id - next->data->id;
+            links++;
+        }
+    }
+    return (links > 0) ? (double) total / links : 0;
+}
+
+/*  Function: void relocateRooms(TopologyType* topology, RoomType** order)
+    Purpose: Renumbers the rooms of the indexed topology at the pointer 'topology' so that
+        'order', which lists every room once with the Van first, is their new id order. Each
+        room is allocated again next to its connection list, in the new order, and the old
+        rooms are freed. Call before any house is built on the topology
+*/
+void relocateRooms(TopologyType* topology, RoomType** order) {
+    RoomType** moved = trackedMalloc(MEM_TOPOLOGY, topology->roomCount * sizeof(RoomType*));
+    RoomId* created = trackedMalloc(MEM_TOPOLOGY, topology->roomCount * sizeof(RoomId));
+    RoomList rooms;
+
+    // Allocate each room and its connections in the new order, still linked to the old rooms
+    initRoomList(&rooms);
+    for (uint32_t i = 0; i < topology->roomCount; i++) {
+        RoomType* room = allocCacheAligned(sizeof(RoomType));
+        countAlloc(MEM_TOPOLOGY, sizeof(RoomType));
+        room->id = i;
+        room->name = order[i]->name;
+        initRoomList(&(room->connectedRooms));
+        for (RoomNode* next = order[i]->connectedRooms.head; next != NULL; next = next->next) {
+            addRoom(&(room->connectedRooms), next->data);
+        }
+        addRoom(&rooms, room);
+        moved[order[i]->id] = room;
+    }
+
+    // Note where each room went by the id it was created with, it may have been moved before
+    for (uint32_t i = 0; i < topology->roomCount; i++) {
+        created[i] = moved[(topology->createdRooms != NULL) ? topology->createdRooms[i] : i]->id;
+    }
+    trackedFree(MEM_TOPOLOGY, topology->createdRooms, topology->roomCount * sizeof(RoomId));
+    topology->createdRooms = created;
+
+    // Point the connections at the moved rooms, then free the old rooms and their index
+    for (RoomNode* current = rooms.head; current != NULL; current = current->next) {
+        for (RoomNode* next = current->data->connectedRooms.head; next != NULL; next = next->next) {
+            next->data = moved[next->data->id];
+        }
+    }
+    for (RoomNode* current = topology->rooms.head; current != NULL; current = current->next) {
+        cleanRoomList(&(current->data->connectedRooms));
+    }
+    cleanRoomData(&(topology->rooms));
+    cleanRoomList(&(topology->rooms));
+    trackedFree(MEM_TOPOLOGY, topology->roomById, topology->roomCount * sizeof(RoomType*));
+    trackedFree(MEM_TOPOLOGY, moved, topology->roomCount * sizeof(RoomType*));
+
+    topology->rooms = rooms;
+    indexRooms(topology);
+}
+
+/*  Function: void orderRooms(TopologyType* topology, enum RoomOrder order)
+    Purpose: Renumbers and moves the rooms of the indexed topology at the pointer 'topology' in
+        the given order, noting how far apart connected rooms were before
+*/
+void orderRooms(TopologyType* topology, enum RoomOrder order) {
+    RoomType** rooms;
+    uint8_t* seen;
+    uint32_t count = 0;
+
+    topology->createdSpread = neighborSpread(topology);
+    if (order == RO_CREATION || topology->roomCount < 2) {
+        return;
+    }
+    rooms = trackedMalloc(MEM_TOPOLOGY, topology->roomCount * sizeof(RoomType*));
+    seen = trackedCalloc(MEM_TOPOLOGY, topology->roomCount, 1);
+
+    if (order == RO_BFS) {
+        count = breadthFirst(topology->roomById[0], C_FALSE, seen, rooms, 0);
+    } else {
+        // Cuthill-McKee from the edge of the house, reversed
+        RoomType* start = peripheralRoom(topology, seen, rooms);
+        memset(seen, 0, topology->roomCount);
+        count = breadthFirst(start, C_TRUE, seen, rooms, 0);
+        for (uint32_t i = 0; i < count / 2; i++) {
+            RoomType* swap = rooms[i];
+            rooms[i] = rooms[count - 1 - i];
+            rooms[count - 1 - i] = swap;
+        }
+    }
+
+    // Rooms the search cannot reach keep their creation order after the others
+    for (uint32_t i = 0; i < topology->roomCount; i++) {
+        if (!seen[i]) {
+            rooms[count++] = topology->roomById[i];
+        }
+    }
+
+    // Move the Van to the front, keeping the order of the rooms before it
+    for (uint32_t i = 1; i < count; i++) {
+        if (rooms[i] == topology->roomById[0]) {
+            memmove(&rooms[1], &rooms[0], i * sizeof(RoomType*));
+            rooms[0] = topology->roomById[0];
+            break;
+        }
+    }
+    relocateRooms(topology, rooms);
+
+    trackedFree(MEM_TOPOLOGY, rooms, topology->roomCount * sizeof(RoomType*));
+    trackedFree(MEM_TOPOLOGY, seen, topology->roomCount);
+}
+
+/*  Function: RoomType* createdRoom(TopologyType* topology, RoomId id)
+    Purpose: Returns the room of the topology at the pointer 'topology' that was created as
+        room 'id', wherever the room order has moved it since
+*/
+RoomType* createdRoom(TopologyType* topology, RoomId id) {
+    return topology->roomById[(topology->createdRooms != NULL) ? topology->createdRooms[id] : id];
+}
+
+/*  Function: char* roomOrderName(enum RoomOrder order)
+    Purpose: Returns the name of the room order 'order'
+*/
+char* roomOrderName(enum RoomOrder order) {
+    static char* names[] = {"creation", "bfs", "rcm"};
+    return (order >= RO_CREATION && order <= RO_RCM) ? names[order] : "unknown";
+}
@@ -0,0 +1,266 @@
+#include "defs.h"
+
+/*
+    Result files hold one record per run.
+
+    csv:  a header line followed by one line per run
+
+    bin:  a file header followed by blocks of up to RESULT_BLOCK records stored column by column
+          header  char[4] "GHRC", uint16 version, uint16 hunters per record
+          block   uint32 rows, then each column as 'rows' packed native-endian values:
+                  seed u64, run u32, ghost u8, evidence mask u8, outcome u8, ghost boredom u16,
+                  ghost turns u32, then for each hunter: exit u8, fear u16, boredom u16, turns u32
+*/
+
+#define RESULT_VERSION  1
+#define RESULT_LINE_MAX 512
+
+/*
+    Writes the staged bytes of the writer to its file and empties the buffer. A short write is
+    reported once and marks the writer as failed, later records are dropped.
+*/
+static void flushBuffer(ResultWriter* writer) {
+    if (writer->used > 0) {
+        if (!writer->failed && fwrite(writer->buffer, 1, writer->used, writer->file) != writer->used) {
+            perror(writer->path);
+            writer->failed = C_TRUE;
+        }
+        writer->used = 0;
+    }
+}
+
+/*
+    Makes sure 'size' more bytes fit in the staging buffer, flushing it if they do not.
+*/
+static void reserveBuffer(ResultWriter* writer, size_t size) {
+    if (writer->used + size > RESULT_BUFFER) {
+        flushBuffer(writer);
+    }
+}
+
+/*
+    Appends raw bytes to the staging buffer.
+*/
+static void appendBytes(ResultWriter* writer, const void* data, size_t size) {
+    reserveBuffer(writer, size);
+    memcpy(writer->buffer + writer->used, data, size);
+    writer->used += size;
+}
+
+/*
+    Appends the decimal representation of 'value' followed by 'sep' to the staging buffer,
+    the caller must have reserved enough room for the line.
+*/
+static void appendUnsigned(ResultWriter* writer, uint64_t value, char sep) {
+    char digits[20];
+    char* dst = writer->buffer + writer->used;
+    int n = 0;
+
+    // Build digits in reverse then copy them in order, small values are the common case
+    if (value < 10) {
+        *dst++ = '0' + value;
+    } else {
+        do {
+            digits[n++] = '0' + (value % 10);
+            value /= 10;
+        } while (value > 0);
+        while (n > 0) {
+            *dst++ = digits[--n];
+        }
+    }
+    *dst++ = sep;
+    writer->used = dst - writer->buffer;
+}
+
+/*
+    Appends a short string followed by 'sep' to the staging buffer.
+*/
+static void appendString(ResultWriter* writer, const char* str, char sep) {
+    char* dst = writer->buffer + writer->used;
+    while (*str != '\0') {
+        *dst++ = *str++;
+    }
+    *dst++ = sep;
+    writer->used = dst - writer->buffer;
+}
+
+/*
+    Returns the name of a ghost class as written to csv files.
+*/
+static const char* ghostName(int ghost) {
+    static const char* names[] = {"Poltergeist", "Banshee", "Bullies", "Phantom"};
+    return (ghost >= 0 && ghost < GHOST_COUNT) ? names[ghost] : "Unknown";
+}
+
+/*
+    Returns the short name of a hunter's exit reason as written to csv files.
+*/
+static const char* exitToString(int reason) {
+    switch (reason) {
+        case LOG_FEAR:       return "FEAR";
+        case LOG_BORED:      return "BORED";
+        case LOG_EVIDENCE:   return "EVIDENCE";
+        case LOG_SUFFICIENT: return "SUFFICIENT";
+        default:             return "UNKNOWN";
+    }
+}
+
+/*
+    Writes a single column of the staged rows, 'offset' and 'size' locate the field
+    inside RunRecord.
+*/
+static void writeColumn(ResultWriter* writer, size_t offset, size_t size) {
+    char* src = (char*) writer->rows + offset;
+    char* dst;
+
+    reserveBuffer(writer, size * writer->rowCount);
+    dst = writer->buffer + writer->used;
+
+    // Gather the field from every row, using fixed size copies so each becomes a single move
+    for (int i = 0; i < writer->rowCount; i++, src += sizeof(RunRecord), dst += size) {
+        switch (size) {
+            case 1:  memcpy(dst, src, 1); break;
+            case 2:  memcpy(dst, src, 2); break;
+            case 4:  memcpy(dst, src, 4); break;
+            default: memcpy(dst, src, 8); break;
+        }
+    }
+    writer->used += size * writer->rowCount;
+}
+
+/*
+    Writes all staged rows as one columnar block.
+*/
+static void flushBlock(ResultWriter* writer) {
+    uint32_t rows = writer->rowCount;
+    if (rows == 0) {
+        return;
+    }
+
+    appendBytes(writer, &rows, sizeof(rows));
+    writeColumn(writer, offsetof(RunRecord, seed), sizeof(uint64_t));
+    writeColumn(writer, offsetof(RunRecord, run), sizeof(uint32_t));
+    writeColumn(writer, offsetof(RunRecord, ghostClass), sizeof(uint8_t));
+    writeColumn(writer, offsetof(RunRecord, evidenceMask), sizeof(uint8_t));
+    writeColumn(writer, offsetof(RunRecord, outcome), sizeof(uint8_t));
+    writeColumn(writer, offsetof(RunRecord, ghostBoredom), sizeof(uint16_t));
+    writeColumn(writer, offsetof(RunRecord, ghostTurns), sizeof(uint32_t));
+    for (int h = 0; h < NUM_HUNTERS; h++) {
+        writeColumn(writer, offsetof(RunRecord, hunterExit) + h * sizeof(uint8_t), sizeof(uint8_t));
+        writeColumn(writer, offsetof(RunRecord, hunterFear) + h * sizeof(uint16_t), sizeof(uint16_t));
+        writeColumn(writer, offsetof(RunRecord, hunterBoredom) + h * sizeof(uint16_t), sizeof(uint16_t));
+        writeColumn(writer, offsetof(RunRecord, hunterTurns) + h * sizeof(uint32_t), sizeof(uint32_t));
+    }
+    writer->rowCount = 0;
+}
+
+/*  Function: int openResultWriter(ResultWriter* writer, char* path, enum ResultFormat format)
+    Purpose: Opens the result file at 'path' and writes the header for the given format,
+        returns C_TRUE on success and C_FALSE if the file could not be opened
+*/
+int openResultWriter(ResultWriter* writer, char* path, enum ResultFormat format) {
+    writer->file = fopen(path, "wb");
+    if (writer->file == NULL) {
+        perror(path);
+        return C_FALSE;
+    }
+
+    // Writes are staged in our own large buffer, so the stream itself is left unbuffered
+    setvbuf(writer->file, NULL, _IONBF, 0);
+    writer->tally = NULL;
+    writer->format = format;
+    writer->buffer = trackedMalloc(MEM_LOGGING, RESULT_BUFFER);
+    writer->used = 0;
+    writer->rows = (format == RF_BINARY) ? trackedMalloc(MEM_LOGGING, RESULT_BLOCK * sizeof(RunRecord)) : NULL;
+    writer->rowCount = 0;
+    writer->path = path;
+    writer->failed = C_FALSE;
+
+    // Write the file header
+    if (format == RF_BINARY) {
+        uint16_t version = RESULT_VERSION;
+        uint16_t hunters = NUM_HUNTERS;
+        appendBytes(writer, "GHRC", 4);
+        appendBytes(writer, &version, sizeof(version));
+        appendBytes(writer, &hunters, sizeof(hunters));
+    } else {
+        char header[RESULT_LINE_MAX];
+        int n = sprintf(header, "run,seed,ghost,evidence_mask,outcome,ghost_boredom,ghost_turns");
+        for (int h = 0; h < NUM_HUNTERS; h++) {
+            n += sprintf(header + n, ",h%d_exit,h%d_fear,h%d_boredom,h%d_turns", h, h, h, h);
+        }
+        header[n++] = '\n';
+        appendBytes(writer, header, n);
+    }
+    return C_TRUE;
+}
+
+/*  Function: void writeResult(ResultWriter* writer, RunRecord* record)
+    Purpose: Stages the run record at the pointer 'record' in the writer, data only reaches
+        the file once the staging buffer is full or the writer is closed
+*/
+void writeResult(ResultWriter* writer, RunRecord* record) {
+    // A tallying writer only counts the record
+    if (writer->tally != NULL) {
+        tallyRun(writer->tally, record);
+    }
+    if (writer->file == NULL) {
+        return;
+    }
+
+    // Columnar blocks are written once enough rows are staged
+    if (writer->format == RF_BINARY) {
+        writer->rows[writer->rowCount++] = *record;
+        if (writer->rowCount == RESULT_BLOCK) {
+            flushBlock(writer);
+        }
+        return;
+    }
+
+    // Format the csv line directly into the staging buffer
+    reserveBuffer(writer, RESULT_LINE_MAX);
+    appendUnsigned(writer, record->run, ',');
+    appendUnsigned(writer, record->seed, ',');
+    appendString(writer, ghostName(record->ghostClass), ',');
+    appendUnsigned(writer, record->evidenceMask, ',');
+    appendString(writer, record->outcome ? "HUNTERS" : "GHOST", ',');
+    appendUnsigned(writer, record->ghostBoredom, ',');
+    appendUnsigned(writer, record->ghostTurns, NUM_HUNTERS > 0 ? ',' : '\n');
+    for (int h = 0; h < NUM_HUNTERS; h++) {
+        appendString(writer, exitToString(record->hunterExit[h]), ',');
+        appendUnsigned(writer, record->hunterFear[h], ',');
+        appendUnsigned(writer, record->hunterBoredom[h], ',');
+        appendUnsigned(writer, record->hunterTurns[h], (h == NUM_HUNTERS - 1) ? '\n' : ',');
+    }
+}
+
+/*  Function: int closeResultWriter(ResultWriter* writer)
+    Purpose: Writes any staged records, closes the result file and frees the writer's buffers.
+        Returns C_FALSE if any record could not be written
+*/
+int closeResultWriter(ResultWriter* writer) {
+    if (writer->file == NULL) {
+        return C_TRUE;
+    }
+    if (writer->format == RF_BINARY) {
+        flushBlock(writer);
+    }
+    flushBuffer(writer);
+    if (fclose(writer->file) != 0 && !writer->failed) {
+        perror(writer->path);
+        writer->failed = C_TRUE;
+    }
+    trackedFree(MEM_LOGGING, writer->buffer, RESULT_BUFFER);
+    trackedFree(MEM_LOGGING, writer->rows, RESULT_BLOCK * sizeof(RunRecord));
+    return !writer->failed;
+}
+
+/*  Function: void openResultTally(ResultWriter* writer, RunTally* tally)
+    Purpose: Opens a writer that writes no file and counts every record in the tally at the
+        pointer 'tally' instead, so an engine's runs can be compared with another's
+*/
+void openResultTally(ResultWriter* writer, RunTally* tally) {
+    memset(writer, 0, sizeof(ResultWriter));
+    writer->format = RF_NONE;
+    writer->tally = tally;
+}
@@ -6,15 +6,13 @@
 */
 RoomType* createRoom(char* name) {
     // Allocate space in heap for new room structure
-    RoomType* room = malloc(sizeof(RoomType));
+    RoomType* room = allocCacheAligned(sizeof(RoomType));
+    countAlloc(MEM_TOPOLOGY, sizeof(RoomType));
 
-    // Initialize all fields on room structure
-    strcpy(room->name, name);
+    // Initialize all fields on room structure, the id is assigned once the house is indexed
+    room->id = 0;
+    room->name = internName(name);
     initRoomList(&(room->connectedRooms));
-    initEvidenceList(&(room->evidence));
-    initHunterArray(&(room->hunters));
-    room->ghost = NULL;
-    sem_init(&(room->sem), 0, 1);
 
     // Return pointer to room structure on heap
     return room;
@@ -49,7 +47,7 @@ void connectRooms(RoomType* room1, RoomType* room2) {
 */
 void addRoom(RoomList* list, RoomType* room) {
     // Allocate memory on heap for node structure
-    RoomNode* new = malloc(sizeof(RoomNode));
+    RoomNode* new = trackedMalloc(MEM_TOPOLOGY, sizeof(RoomNode));
 
     // Set data for node to be provided room and next pointer to null
     new->data = room;
@@ -75,7 +73,7 @@ void cleanRoomData(RoomList* list) {
 
     // Loop through every node in list and free room data
     while (current != NULL) {
-        free(current->data);
+        trackedFree(MEM_TOPOLOGY, current->data, sizeof(RoomType));
         current = current->next;
     }
 }
@@ -92,7 +90,7 @@ void cleanRoomList(RoomList* list) {
     while (current != NULL) {
         temp = current;
         current = current->next;
-        free(temp);
+        trackedFree(MEM_TOPOLOGY, temp, sizeof(RoomNode));
     }
 }
 
@@ -119,3 +117,126 @@ RoomType* randomRoom(RoomList* rooms, int startIndex) {
     // return the pointer to the room at randomly choose index
     return current->data;
 }
+
+
+/*
+    Room state is a single atomic word: the hunter count in the low 32 bits, the ghost flag,
+    the evidence mask and a version in the top bits that every change bumps. Moves and
+    presence checks are plain atomic operations on that word, so rooms need no lock and a
+    reader always sees the fields of one consistent version. The words of every room sit in
+    the house of the run, indexed by room id, since rooms themselves are shared between runs.
+*/
+
+/*  Function: void enterRoom(HouseType* house, RoomType* room)
+    Purpose: Adds one hunter to the occupancy of the room at the pointer 'room' in the house
+        at the pointer 'house'
+*/
+void enterRoom(HouseType* house, RoomType* room) {
+    atomic_fetch_add(&(house->roomHot[room->id].state), ROOM_VERSION + 1);
+}
+
+/*  Function: void exitRoom(HouseType* house, RoomType* room)
+    Purpose: Removes one hunter from the occupancy of the room at the pointer 'room' in the house
+        at the pointer 'house'
+*/
+void exitRoom(HouseType* house, RoomType* room) {
+    atomic_fetch_add(&(house->roomHot[room->id].state), ROOM_VERSION - 1);
+}
+
+/*  Function: void setRoomGhost(HouseType* house, RoomType* room, int present)
+    Purpose: Sets or clears the ghost flag of the room at the pointer 'room' in the house
+        at the pointer 'house'
+*/
+void setRoomGhost(HouseType* house, RoomType* room, int present) {
+    uint64_t state = atomic_load(&(house->roomHot[room->id].state));
+    uint64_t next;
+
+    do {
+        next = ((state & ~ROOM_GHOST) | (present ? ROOM_GHOST : 0)) + ROOM_VERSION;
+    } while (!atomic_compare_exchange_weak(&(house->roomHot[room->id].state), &state, next));
+}
+
+/*  Function: void setRoomEvidence(HouseType* house, RoomType* room, int mask)
+    Purpose: Replaces the evidence mask of the room at the pointer 'room' in the house at the
+        pointer 'house', callers hold the room's evidence lock so the mask matches the evidence list
+        and the house's evidence counts and summary count each change once
+*/
+void setRoomEvidence(HouseType* house, RoomType* room, int mask) {
+    uint64_t state = atomic_load(&(house->roomHot[room->id].state));
+    uint64_t next;
+    int before;
+
+    do {
+        next = ((state & ~ROOM_EV_MASK) | ((uint64_t) mask << ROOM_EV_SHIFT)) + ROOM_VERSION;
+    } while (!atomic_compare_exchange_weak(&(house->roomHot[room->id].state), &state, next));
+
+    // Keep the rooms holding each type counted, so samples need not read every room
+    before = (state & ROOM_EV_MASK) >> ROOM_EV_SHIFT;
+    for (int e = 0; e < EV_COUNT; e++) {
+        if (((before ^ mask) >> e) & 1) {
+            atomic_fetch_add_explicit(&(house->evidenceRooms[e]), ((mask >> e) & 1) ? 1 : UINT32_MAX, memory_order_relaxed);
+        }
+    }
+    summarizeEvidence(house, room->id, before, mask);
+}
+
+/*  Function: uint32_t roomOccupancy(HouseType* house, RoomType* room)
+    Purpose: Returns the number of hunters in the room at the pointer 'room' in the house
+        at the pointer 'house'
+*/
+uint32_t roomOccupancy(HouseType* house, RoomType* room) {
+    return atomic_load_explicit(&(house->roomHot[room->id].state), memory_order_acquire) & ROOM_OCCUPANCY;
+}
+
+/*  Function: int roomHasGhost(HouseType* house, RoomType* room)
+    Purpose: Returns C_TRUE if the ghost is in the room at the pointer 'room' in the house
+        at the pointer 'house'
+*/
+int roomHasGhost(HouseType* house, RoomType* room) {
+    return (atomic_load_explicit(&(house->roomHot[room->id].state), memory_order_acquire) & ROOM_GHOST) != 0;
+}
+
+/*  Function: int roomEvidence(HouseType* house, RoomType* room)
+    Purpose: Returns the mask of evidence types lying in the room at the pointer 'room' in the house
+        at the pointer 'house'
+*/
+int roomEvidence(HouseType* house, RoomType* room) {
+    return (atomic_load_explicit(&(house->roomHot[room->id].state), memory_order_acquire) & ROOM_EV_MASK) >> ROOM_EV_SHIFT;
+}
+
+/*  Function: void snapshotRoom(HouseType* house, RoomType* room, RoomSnapshot* snapshot)
+    Purpose: Reads every field of the room state at once into 'snapshot', comparing the
+        version of two snapshots tells whether the room changed in between
+*/
+void snapshotRoom(HouseType* house, RoomType* room, RoomSnapshot* snapshot) {
+    uint64_t state = atomic_load_explicit(&(house->roomHot[room->id].state), memory_order_acquire);
+
+    snapshot->occupancy = state & ROOM_OCCUPANCY;
+    snapshot->ghost = (state & ROOM_GHOST) != 0;
+    snapshot->evidenceMask = (state & ROOM_EV_MASK) >> ROOM_EV_SHIFT;
+    snapshot->version = state / ROOM_VERSION;
+}
+
+/*  Function: EvidenceList* evidenceIn(HouseType* house, RoomType* room)
+    Purpose: Returns the list of evidence lying in the room at the pointer 'room' in the house
+        at the pointer 'house', allocating it the first time evidence is left in the room
+*/
+EvidenceList* evidenceIn(HouseType* house, RoomType* room) {
+    EvidenceList* list = atomic_load_explicit(&(house->roomEvidence[room->id]), memory_order_acquire);
+    EvidenceList* expected = NULL;
+
+    if (list != NULL) {
+        return list;
+    }
+
+    // Agents can leave evidence in a room at the same time, the first list published wins
+    list = allocCacheAligned(sizeof(EvidenceList));
+    countAlloc(MEM_EVIDENCE, sizeof(EvidenceList));
+    initEvidenceList(list);
+    if (!atomic_compare_exchange_strong(&(house->roomEvidence[room->id]), &expected, list)) {
+        cleanEvidenceList(list);
+        trackedFree(MEM_EVIDENCE, list, sizeof(EvidenceList));
+        return expected;
+    }
+    return list;
+}
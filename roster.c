@@ -0,0 +1,252 @@
+#include "defs.h"
+#include <fcntl.h>
+
+/*
+    A bulk roster lists one hunter per line, read from a file or from stdin ("--roster -")
+    without any prompts:
+
+        # name     equipment     optional fields
+        Obi-Wan    EMF
+        Ahsoka     SOUND         room=3 fear=15
+        Anakin     TEMPERATURE   boredom=80
+
+    The name and the equipment come first, the equipment being one of EMF, TEMPERATURE,
+    FINGERPRINTS, SOUND or UNKNOWN. The optional fields set the id of the room the hunter
+    starts in, in the order the house was created whatever --room-order numbers it as (the Van
+    by default), and the fear and boredom the hunter leaves at (FEAR_MAX and BOREDOM_MAX by
+    default). Fields are
+    separated by spaces or tabs, blank lines and lines starting with '#' are skipped.
+
+    Each run plays NUM_HUNTERS of the hunters, a longer roster being dealt out a slice per run
+    (see rosterHunter), so a batch of runs can play through a million hunters.
+
+    The file is read in blocks into one buffer and each line is parsed in place, so nothing is
+    allocated per hunter beyond the roster's own array. A malformed line stops the load with
+    the file and line number it is on.
+*/
+
+/*
+    Parses the decimal number in the 'length' characters at 'text' into 'value', returns
+    C_FALSE if they are not a number from 'min' to 'max'.
+*/
+static int parseField(const char* text, int length, uint32_t min, uint32_t max, uint32_t* value) {
+    uint64_t number = 0;
+
+    if (length == 0 || length > 10) {
+        return C_FALSE;
+    }
+    for (int i = 0; i < length; i++) {
+        if (text[i] < '0' || text[i] > '9') {
+            return C_FALSE;
+        }
+        number = number * 10 + (text[i] - '0');
+    }
+    *value = (uint32_t) number;
+    return number >= min && number <= max;
+}
+
+/*
+    Returns the length of the field at 'text', which ends at a space, a tab or 'end'.
+*/
+static int fieldLength(const char* text, const char* end) {
+    const char* p = text;
+
+    while (p < end && *p != ' ' && *p != '\t') {
+        p++;
+    }
+    return p - text;
+}
+
+/*
+    Parses the hunter on the line from 'line' to 'end' and adds it to 'roster'. Returns NULL,
+    or the reason the line is malformed with the offending field left at 'field'.
+*/
+static const char* parseHunter(const char* line, const char* end, uint32_t rooms, RosterType* roster, const char** field) {
+    char name[MAX_STR], tool[MAX_STR];
+    enum EvidenceType equipment;
+    HunterSpec* spec;
+    int length;
+
+    // The name, then the equipment
+    *field = line;
+    length = fieldLength(line, end);
+    if (length >= MAX_STR) {
+        return "the name is longer than 63 characters";
+    }
+    memcpy(name, line, length);
+    name[length] = '\0';
+    for (line += length; line < end && (*line == ' ' || *line == '\t'); line++);
+    *field = line;
+    length = fieldLength(line, end);
+    if (length == 0) {
+        return "the equipment is missing";
+    }
+    if (length >= MAX_STR) {
+        return "unknown equipment";
+    }
+    memcpy(tool, line, length);
+    tool[length] = '\0';
+    equipment = stringToEvidence(tool);
+    if (equipment == EV_UNKNOWN && strcmp(tool, "UNKNOWN")) {
+        return "unknown equipment";
+    }
+    addHunterSpec(roster, name, equipment);
+    spec = &(roster->hunters[roster->size - 1]);
+
+    // Then any of the optional fields
+    for (line += length; line < end; line += length) {
+        uint32_t value;
+
+        if (*line == ' ' || *line == '\t') {
+            length = 1;
+            continue;
+        }
+        *field = line;
+        length = fieldLength(line, end);
+        if (!strncmp(line, "room=", 5)) {
+            if (!parseField(line + 5, length - 5, 0, UINT32_MAX, &value)) {
+                return "the room is not a room id";
+            }
+            if (value >= rooms) {
+                return "the room is not in the house";
+            }
+            spec->room = value;
+        } else if (!strncmp(line, "fear=", 5)) {
+            if (!parseField(line + 5, length - 5, 1, UINT16_MAX, &value)) {
+                return "the fear is not a number from 1 to 65535";
+            }
+            spec->fearMax = value;
+        } else if (!strncmp(line, "boredom=", 8)) {
+            if (!parseField(line + 8, length - 8, 1, UINT16_MAX, &value)) {
+                return "the boredom is not a number from 1 to 65535";
+            }
+            spec->boredomMax = value;
+        } else {
+            return "unknown field, expected room=, fear= or boredom=";
+        }
+    }
+    return NULL;
+}
+
+/*  Function: int loadRoster(RosterType* roster, char* path, uint32_t rooms)
+    Purpose: Adds every hunter listed in the bulk roster file at 'path', or on stdin when
+        'path' is "-", to the roster at the pointer 'roster'. Start rooms must be below
+        'rooms', the number of rooms in the house. Returns C_FALSE and prints the line at
+        fault if the file cannot be read, a line is malformed or it lists no hunters
+*/
+int loadRoster(RosterType* roster, char* path, uint32_t rooms) {
+    static char buffer[ROSTER_BUFFER];
+    char field[MAX_STR];
+    const char* fault = NULL;
+    const char* at;
+    int fd = strcmp(path, "-") ? open(path, O_RDONLY) : STDIN_FILENO;
+    char* source = (fd == STDIN_FILENO) ? "stdin" : path;
+    size_t held = 0;
+    uint32_t lineNumber = 0;
+    ssize_t n = 1;
+
+    if (fd < 0) {
+        perror(path);
+        return C_FALSE;
+    }
+
+    // Read a block after the partial line the last one ended in, then parse its whole lines
+    while (fault == NULL && n > 0) {
+        char* line = buffer;
+        char* stop;
+
+        n = read(fd, buffer + held, ROSTER_BUFFER - held);
+        if (n < 0) {
+            perror(source);
+            break;
+        }
+        stop = buffer + held + n;
+        held += n;
+        if (n == 0 && held > 0 && buffer[held - 1] != '\n') {
+            buffer[held++] = '\n';          // There is always room left for the last newline
+            stop++;
+        }
+
+        while (fault == NULL) {
+            char* newline = memchr(line, '\n', stop - line);
+            char* end = newline;
+
+            if (newline == NULL) {
+                break;
+            }
+            lineNumber++;
+            if (end > line && end[-1] == '\r') {
+                end--;
+            }
+            for (; line < end && (*line == ' ' || *line == '\t'); line++);
+            if (line < end && *line != '#') {
+                fault = parseHunter(line, end, rooms, roster, &at);
+                if (fault != NULL) {
+                    snprintf(field, MAX_STR, "%.*s", fieldLength(at, end), at);
+                }
+            }
+            line = newline + 1;
+        }
+
+        // Keep the partial line for the next block, it has to fit in the buffer
+        held = stop - line;
+        memmove(buffer, line, held);
+        if (fault == NULL && held >= ROSTER_BUFFER - 1) {
+            lineNumber++;
+            fault = "the line is too long";
+            snprintf(field, MAX_STR, "%.*s", MAX_STR - 1, buffer);
+        }
+    }
+    if (fd != STDIN_FILENO) {
+        close(fd);
+    }
+
+    if (fault != NULL) {
+        fprintf(stderr, "%s:%u: %s: '%s'\n", source, lineNumber, fault, field);
+        return C_FALSE;
+    }
+    if (n < 0) {
+        return C_FALSE;
+    }
+    if (roster->size == 0) {
+        fprintf(stderr, "%s: the roster lists no hunters\n", source);
+        return C_FALSE;
+    }
+    return C_TRUE;
+}
+
+/*  Function: int rosterPlayers(RosterType* roster)
+    Purpose: Returns the number of hunters of the roster at the pointer 'roster' each run plays
+*/
+int rosterPlayers(RosterType* roster) {
+    return (roster->size < NUM_HUNTERS) ? roster->size : NUM_HUNTERS;
+}
+
+/*  Function: HunterSpec* rosterHunter(RosterType* roster, uint64_t seed, int slot)
+    Purpose: Returns the hunter of the roster at the pointer 'roster' playing in slot 'slot' of
+        the run seeded with 'seed'. A roster of up to NUM_HUNTERS hunters plays whole in every
+        run, a longer one is dealt out NUM_HUNTERS at a time, consecutive seeds taking
+        consecutive slices and the last slice wrapping round to the start. The slice follows
+        the seed rather than the run, so a cached or distributed run places the same hunters
+*/
+HunterSpec* rosterHunter(RosterType* roster, uint64_t seed, int slot) {
+    uint64_t slices = (roster->size + NUM_HUNTERS - 1) / NUM_HUNTERS;
+    return &(roster->hunters[((seed % slices) * NUM_HUNTERS + slot) % roster->size]);
+}
+
+/*  Function: int plainRoster(RosterType* roster)
+    Purpose: Returns C_TRUE if the roster at the pointer 'roster' plays whole in every run and
+        each of its hunters starts in the Van and leaves at the standard fear and boredom
+*/
+int plainRoster(RosterType* roster) {
+    if (roster->size > NUM_HUNTERS) {
+        return C_FALSE;
+    }
+    for (int i = 0; i < roster->size; i++) {
+        HunterSpec* spec = &(roster->hunters[i]);
+        if (spec->room != 0 || spec->fearMax != FEAR_MAX || spec->boredomMax != BOREDOM_MAX) {
+            return C_FALSE;
+        }
+    }
+    return C_TRUE;
+}
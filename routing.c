@@ -0,0 +1,253 @@
+#include "defs.h"
+
+/*
+    Routing data lets hunters head for a goal room instead of wandering. It is built once per
+    house topology and only read afterwards, so every run on that topology shares it.
+
+    Houses of up to ROUTING_TABLE_MAX rooms get an all-pairs next hop table: one byte per
+    (room, goal) pair holding the position of the next room in the room's connection list.
+    Larger houses store the distance from ROUTING_LANDMARKS landmark rooms to every room, and
+    a hunter steps to the neighbour with the lowest landmark distance estimate to the goal.
+*/
+
+/*
+    Breadth first search from room 'source', filling 'dist' with hop counts (UINT32_MAX when
+    unreachable) using 'queue' as scratch space.
+*/
+static void bfsDistances(RoutingType* routing, RoomId source, uint32_t* dist, RoomId* queue) {
+    uint32_t head = 0, tail = 0;
+
+    for (uint32_t i = 0; i < routing->roomCount; i++) {
+        dist[i] = UINT32_MAX;
+    }
+    dist[source] = 0;
+    queue[tail++] = source;
+    while (head < tail) {
+        RoomId room = queue[head++];
+        for (uint32_t e = routing->offsets[room]; e < routing->offsets[room + 1]; e++) {
+            RoomId next = routing->neighbors[e];
+            if (dist[next] == UINT32_MAX) {
+                dist[next] = dist[room] + 1;
+                queue[tail++] = next;
+            }
+        }
+    }
+}
+
+/*
+    Fills the next hop table, one breadth first search per goal room.
+*/
+static void buildNextHops(RoutingType* routing) {
+    uint32_t n = routing->roomCount;
+    uint32_t* dist = trackedMalloc(MEM_TOPOLOGY, n * sizeof(uint32_t));
+    RoomId* queue = trackedMalloc(MEM_TOPOLOGY, n * sizeof(RoomId));
+
+    routing->nextHop = trackedMalloc(MEM_TOPOLOGY, (size_t) n * n);
+    memset(routing->nextHop, ROUTE_NONE, (size_t) n * n);
+
+    for (RoomId goal = 0; goal < n; goal++) {
+        bfsDistances(routing, goal, dist, queue);
+
+        // The next hop from a room is any neighbour one step closer to the goal
+        for (RoomId room = 0; room < n; room++) {
+            if (room == goal || dist[room] == UINT32_MAX) {
+                continue;
+            }
+            for (uint32_t e = routing->offsets[room]; e < routing->offsets[room + 1]; e++) {
+                if (dist[routing->neighbors[e]] + 1 == dist[room]) {
+                    routing->nextHop[(size_t) room * n + goal] = e - routing->offsets[room];
+                    break;
+                }
+            }
+        }
+    }
+    trackedFree(MEM_TOPOLOGY, dist, n * sizeof(uint32_t));
+    trackedFree(MEM_TOPOLOGY, queue, n * sizeof(RoomId));
+}
+
+/*
+    Picks landmarks by farthest point selection starting from the van and stores the distance
+    from each landmark to every room.
+*/
+static void buildLandmarks(RoutingType* routing) {
+    uint32_t n = routing->roomCount;
+    uint32_t* closest = trackedMalloc(MEM_TOPOLOGY, n * sizeof(uint32_t));
+    RoomId* queue = trackedMalloc(MEM_TOPOLOGY, n * sizeof(RoomId));
+    RoomId landmark = 0;
+
+    routing->landmarkDist = trackedMalloc(MEM_TOPOLOGY, (size_t) ROUTING_LANDMARKS * n * sizeof(uint32_t));
+    for (uint32_t i = 0; i < n; i++) {
+        closest[i] = UINT32_MAX;
+    }
+
+    for (int l = 0; l < ROUTING_LANDMARKS; l++) {
+        uint32_t* row = routing->landmarkDist + (size_t) l * n;
+        bfsDistances(routing, landmark, row, queue);
+
+        // The next landmark is the room farthest from every landmark so far
+        for (uint32_t i = 0; i < n; i++) {
+            if (row[i] < closest[i]) {
+                closest[i] = row[i];
+            }
+            if (closest[i] != UINT32_MAX && closest[i] > closest[landmark]) {
+                landmark = i;
+            }
+        }
+    }
+    trackedFree(MEM_TOPOLOGY, closest, n * sizeof(uint32_t));
+    trackedFree(MEM_TOPOLOGY, queue, n * sizeof(RoomId));
+}
+
+/*  Function: void buildRouting(RoutingType* routing, HouseType* house)
+    Purpose: Builds the routing data for the topology of the indexed house at the pointer
+        'house': a packed copy of the connections, then a next hop table for small houses or
+        landmark distances for large ones
+*/
+void buildRouting(RoutingType* routing, HouseType* house) {
+    uint32_t n = house->roomCount;
+    uint32_t edges = 0;
+    int maxDegree = 0;
+
+    // Pack the connection lists into offset and neighbour arrays indexed by room id
+    routing->roomCount = n;
+    routing->offsets = trackedMalloc(MEM_TOPOLOGY, (n + 1) * sizeof(uint32_t));
+    for (RoomNode* current = house->rooms.head; current != NULL; current = current->next) {
+        routing->offsets[current->data->id] = current->data->connectedRooms.size;
+        edges += current->data->connectedRooms.size;
+        if (current->data->connectedRooms.size > maxDegree) {
+            maxDegree = current->data->connectedRooms.size;
+        }
+    }
+    for (uint32_t i = 0, sum = 0; i <= n; i++) {
+        uint32_t degree = (i < n) ? routing->offsets[i] : 0;
+        routing->offsets[i] = sum;
+        sum += degree;
+    }
+    routing->neighbors = trackedMalloc(MEM_TOPOLOGY, edges * sizeof(RoomId));
+    for (RoomNode* current = house->rooms.head; current != NULL; current = current->next) {
+        uint32_t e = routing->offsets[current->data->id];
+        for (RoomNode* next = current->data->connectedRooms.head; next != NULL; next = next->next) {
+            routing->neighbors[e++] = next->data->id;
+        }
+    }
+
+    // Small houses get exact next hops, as long as a slot fits in a byte
+    routing->nextHop = NULL;
+    routing->landmarkDist = NULL;
+    routing->ballOffsets = NULL;
+    routing->ballRooms = NULL;
+    routing->ballHops = NULL;
+    routing->clusterCount = 0;
+    routing->clusterOf = NULL;
+    routing->clusterParent = NULL;
+    routing->childOffsets = NULL;
+    routing->children = NULL;
+    if (n <= ROUTING_TABLE_MAX && maxDegree < ROUTE_NONE) {
+        buildNextHops(routing);
+    } else {
+        buildLandmarks(routing);
+    }
+}
+
+/*  Function: void prepareRouting(OptionsType* options, RoutingType* routing)
+    Purpose: Builds the house topology every run of the batch shares once, and its routing
+        data with neighbourhoods for the proximity index when the ghost needs them and the
+        evidence summary tree when hunters do. Leaves the routing data empty when hunters and
+        the ghost both move at random
+*/
+void prepareRouting(OptionsType* options, RoutingType* routing) {
+    HouseType house;
+
+    // Build the topology exactly as each run would
+    memset(routing, 0, sizeof(RoutingType));
+    seedRandom(mixSeed(options->seed, 0));
+    routing->topology = createTopology(options->rooms, options->roomOrder);
+    if (options->movement == MV_RANDOM && options->haunting == GM_RANDOM) {
+        return;
+    }
+
+    // Route over a house on the shared topology
+    initSharedHouse(&house, routing->topology);
+    buildRouting(routing, &house);
+    if (options->haunting != GM_RANDOM) {
+        buildNeighborhoods(routing);
+    }
+    if (options->movement == MV_COLLECT) {
+        buildSummary(routing);
+    }
+    cleanUp(&house);
+}
+
+/*  Function: RoomId nextHop(RoutingType* routing, RoomId room, RoomId goal)
+    Purpose: Returns the id of the room to step to from 'room' on the way to 'goal', or
+        'room' itself when it already is the goal or the goal cannot be reached
+*/
+RoomId nextHop(RoutingType* routing, RoomId room, RoomId goal) {
+    uint32_t first = routing->offsets[room];
+    uint32_t last = routing->offsets[room + 1];
+    uint32_t best = UINT32_MAX;
+    int ties = 0;
+    RoomId next = room;
+
+    if (room == goal) {
+        return room;
+    }
+
+    // Exact table lookup
+    if (routing->nextHop != NULL) {
+        uint8_t slot = routing->nextHop[(size_t) room * routing->roomCount + goal];
+        return (slot == ROUTE_NONE) ? room : routing->neighbors[first + slot];
+    }
+
+    // Step to the neighbour whose landmark lower bound on the distance to the goal is smallest,
+    // breaking ties at random so hunters do not get stuck walking back and forth
+    for (uint32_t e = first; e < last; e++) {
+        RoomId candidate = routing->neighbors[e];
+        uint32_t estimate = 0;
+        if (candidate == goal) {
+            return goal;
+        }
+        for (int l = 0; l < ROUTING_LANDMARKS; l++) {
+            uint32_t* row = routing->landmarkDist + (size_t) l * routing->roomCount;
+            uint32_t gap = (row[candidate] > row[goal]) ? row[candidate] - row[goal] : row[goal] - row[candidate];
+            if (gap > estimate) {
+                estimate = gap;
+            }
+        }
+        if (estimate < best) {
+            best = estimate;
+            next = candidate;
+            ties = 1;
+        } else if (estimate == best && randInt(0, ++ties) == 0) {
+            next = candidate;
+        }
+    }
+    return next;
+}
+
+/*  Function: void cleanRouting(RoutingType* routing)
+    Purpose: Deallocates the routing data at the pointer 'routing' and lets go of its topology
+*/
+void cleanRouting(RoutingType* routing) {
+    size_t n = routing->roomCount;
+    size_t edges = (routing->offsets != NULL) ? routing->offsets[n] : 0;
+    size_t ball = (routing->ballOffsets != NULL) ? routing->ballOffsets[n] : 0;
+    size_t clusters = routing->clusterCount;
+    size_t children = (routing->childOffsets != NULL) ? routing->childOffsets[clusters] : 0;
+
+    trackedFree(MEM_TOPOLOGY, routing->offsets, (n + 1) * sizeof(uint32_t));
+    trackedFree(MEM_TOPOLOGY, routing->neighbors, edges * sizeof(RoomId));
+    trackedFree(MEM_TOPOLOGY, routing->nextHop, n * n);
+    trackedFree(MEM_TOPOLOGY, routing->landmarkDist, ROUTING_LANDMARKS * n * sizeof(uint32_t));
+    trackedFree(MEM_TOPOLOGY, routing->ballOffsets, (n + 1) * sizeof(uint32_t));
+    trackedFree(MEM_TOPOLOGY, routing->ballRooms, ball * sizeof(RoomId));
+    trackedFree(MEM_TOPOLOGY, routing->ballHops, ball);
+    trackedFree(MEM_TOPOLOGY, routing->clusterOf, n * sizeof(uint32_t));
+    trackedFree(MEM_TOPOLOGY, routing->clusterParent, clusters * sizeof(uint32_t));
+    trackedFree(MEM_TOPOLOGY, routing->childOffsets, (clusters + 1) * sizeof(uint32_t));
+    trackedFree(MEM_TOPOLOGY, routing->children, children * sizeof(uint32_t));
+    if (routing->topology != NULL) {
+        releaseTopology(routing->topology);
+    }
+    memset(routing, 0, sizeof(RoutingType));
+}
@@ -0,0 +1,233 @@
+#include "defs.h"
+
+/*
+    The sampler records how a run evolves. Samples are taken either by a sampler thread every
+    'intervalMicros' microseconds of wall clock time, or by the ghost every 'intervalTurns'
+    of its turns. Each sample goes into ring buffers allocated before the run starts, and the
+    oldest samples are overwritten once a run takes more than SAMPLE_RING. Taking a sample
+    only reads atomics and agent counters, so it never allocates and never takes a lock.
+    The rings are written to the sample file once the run is over.
+
+    Houses of up to SAMPLE_DENSE_ROOMS rooms record the hunters in every room. Larger houses
+    only record the rooms hunters are in, at most one per hunter, so neither the ring nor a
+    sample grows with the house.
+
+    header  char[4] "GHTS", uint16 version, uint16 fear buckets, uint16 boredom buckets,
+            uint16 boredom bucket width, uint16 evidence types
+    run     uint64 seed, uint32 run, uint32 rooms, uint32 occupancy layout (0 none, 1 every
+            room, 2 occupied rooms), uint32 occupancy entries, uint32 samples kept, uint32
+            samples dropped, then the kept samples oldest first, all values packed native-endian:
+    sample  nanos since the run started u64, ghost turns u32, ghost room u32 (ROOM_NONE once
+            it left), hunters per fear value u16[], hunters per boredom bucket u16[], rooms
+            holding each evidence type u16[], evidence collected per type u16[], then for the
+            every room layout the hunters in each room u16[entries], for the occupied rooms
+            layout the occupied rooms u32[entries] (ROOM_NONE when unused) and the hunters in
+            each u16[entries]
+*/
+
+#define SAMPLE_VERSION  2
+
+/*
+    Reads an int another thread may be writing, without tearing.
+*/
+static int peekInt(int* value) {
+    return __atomic_load_n(value, __ATOMIC_RELAXED);
+}
+
+/*
+    Sampler thread, samples the house every interval until the run stops.
+*/
+static void* runSampler(void* ptr) {
+    SamplerType* sampler = (SamplerType*) ptr;
+
+    while (!waitTurn(&(sampler->house->termination), sampler->intervalMicros)) {
+        takeSample(sampler);
+    }
+    return NULL;
+}
+
+/*  Function: int openSampler(SamplerType* sampler, OptionsType* options)
+    Purpose: Opens the sample file named in 'options' and writes its header, returns C_TRUE on
+        success and C_FALSE if the file could not be opened
+*/
+int openSampler(SamplerType* sampler, OptionsType* options) {
+    uint16_t header[] = {SAMPLE_VERSION, FEAR_MAX + 1, SAMPLE_BOREDOM_BUCKETS, SAMPLE_BOREDOM_WIDTH, EV_COUNT};
+
+    sampler->file = fopen(options->samplePath, "wb");
+    if (sampler->file == NULL) {
+        perror(options->samplePath);
+        return C_FALSE;
+    }
+    sampler->intervalMicros = options->sampleMicros;
+    sampler->intervalTurns = options->sampleTurns;
+    sampler->ring = trackedMalloc(MEM_LOGGING, SAMPLE_RING * sizeof(SampleType));
+    sampler->occupancy = NULL;
+    sampler->occupied = NULL;
+    sampler->roomCount = 0;
+    sampler->entries = 0;
+    sampler->taken = 0;
+    sampler->house = NULL;
+
+    fwrite("GHTS", 1, 4, sampler->file);
+    fwrite(header, sizeof(uint16_t), sizeof(header) / sizeof(uint16_t), sampler->file);
+    return C_TRUE;
+}
+
+/*
+    Frees the occupancy rings of the sampler.
+*/
+static void freeOccupancy(SamplerType* sampler) {
+    trackedFree(MEM_LOGGING, sampler->occupancy, (size_t) SAMPLE_RING * sampler->entries * sizeof(uint16_t));
+    trackedFree(MEM_LOGGING, sampler->occupied, (size_t) SAMPLE_RING * sampler->entries * sizeof(uint32_t));
+    sampler->occupancy = NULL;
+    sampler->occupied = NULL;
+    sampler->entries = 0;
+}
+
+/*  Function: void startSampling(SamplerType* sampler, HouseType* house)
+    Purpose: Prepares the sampler for a run in the house at the pointer 'house', sizing the
+        occupancy ring for its rooms, takes the first sample and starts the sampler thread
+        when sampling by wall clock time. Runs go on without occupancy if the ring cannot be
+        allocated. Call before the agent threads start
+*/
+void startSampling(SamplerType* sampler, HouseType* house) {
+    if (sampler->roomCount != house->roomCount) {
+        uint32_t entries = (house->roomCount <= SAMPLE_DENSE_ROOMS) ? house->roomCount : NUM_HUNTERS;
+
+        freeOccupancy(sampler);
+        sampler->roomCount = house->roomCount;
+        sampler->occupancy = trackedMalloc(MEM_LOGGING, (size_t) SAMPLE_RING * entries * sizeof(uint16_t));
+        if (house->roomCount > SAMPLE_DENSE_ROOMS) {
+            sampler->occupied = trackedMalloc(MEM_LOGGING, (size_t) SAMPLE_RING * entries * sizeof(uint32_t));
+        }
+        sampler->entries = entries;
+        if (sampler->occupancy == NULL || (house->roomCount > SAMPLE_DENSE_ROOMS && sampler->occupied == NULL)) {
+            fprintf(stderr, "sampler: cannot allocate the occupancy ring, sampling without occupancy\n");
+            freeOccupancy(sampler);
+        }
+    }
+    sampler->house = house;
+    sampler->taken = 0;
+    sampler->start = nowNanos();
+    house->sampler = sampler;
+
+    takeSample(sampler);
+    if (sampler->intervalTurns == 0) {
+        pthread_create(&(sampler->thread), NULL, runSampler, sampler);
+    }
+}
+
+/*  Function: void takeSample(SamplerType* sampler)
+    Purpose: Records the current state of the sampled house in the next slot of the rings
+*/
+void takeSample(SamplerType* sampler) {
+    HouseType* house = sampler->house;
+    uint32_t slot = sampler->taken % SAMPLE_RING;
+    SampleType* sample = &(sampler->ring[slot]);
+    uint16_t* occupancy = sampler->occupancy + (size_t) slot * sampler->entries;
+    int dense = sampler->entries > 0 && sampler->occupied == NULL;
+
+    memset(sample, 0, sizeof(SampleType));
+    sample->nanos = nowNanos() - sampler->start;
+    sample->ghostTurns = (house->ghost != NULL) ? peekInt(&(house->ghost->turns)) : 0;
+    sample->ghostRoom = ROOM_NONE;
+
+    // Fear, boredom and for large houses the rooms of the hunters still in the house
+    if (!dense) {
+        for (uint32_t i = 0; i < sampler->entries; i++) {
+            sampler->occupied[(size_t) slot * sampler->entries + i] = ROOM_NONE;
+            occupancy[i] = 0;
+        }
+    }
+    for (int i = 0; i < house->hunters.size; i++) {
+        HunterType* hunter = house->hunters.elements[i];
+        int fear = peekInt(&(hunter->fear));
+        int boredom = peekInt(&(hunter->boredom));
+        if (peekInt((int*) &(hunter->exitReason)) != LOG_UNKNOWN) {
+            continue;
+        }
+        sample->fear[(fear < FEAR_MAX) ? fear : FEAR_MAX]++;
+        sample->boredom[(boredom < BOREDOM_MAX) ? boredom / SAMPLE_BOREDOM_WIDTH : SAMPLE_BOREDOM_BUCKETS - 1]++;
+        if (!dense && sampler->entries > 0) {
+            uint32_t* rooms = sampler->occupied + (size_t) slot * sampler->entries;
+            RoomId room = __atomic_load_n(&(hunter->room), __ATOMIC_RELAXED)->id;
+            uint32_t e = 0;
+            while (e < sampler->entries - 1 && rooms[e] != ROOM_NONE && rooms[e] != room) {
+                e++;
+            }
+            rooms[e] = room;
+            occupancy[e]++;
+        }
+    }
+
+    // Small houses record every room's hunters from its state word, which also flags the ghost
+    if (dense) {
+        for (uint32_t i = 0; i < house->roomCount; i++) {
+            uint64_t state = atomic_load_explicit(&(house->roomHot[i].state), memory_order_relaxed);
+            occupancy[i] = state & ROOM_OCCUPANCY;
+            if (state & ROOM_GHOST) {
+                sample->ghostRoom = i;
+            }
+        }
+    } else if (house->ghost != NULL) {
+        RoomType* room = __atomic_load_n(&(house->ghost->room), __ATOMIC_RELAXED);
+        if (room != NULL && roomHasGhost(house, room)) {
+            sample->ghostRoom = room->id;
+        }
+    }
+    for (int e = 0; e < EV_COUNT; e++) {
+        sample->evidenceRooms[e] = atomic_load_explicit(&(house->evidenceRooms[e]), memory_order_relaxed);
+        sample->collected[e] = atomic_load_explicit(&(house->collected[e]), memory_order_relaxed);
+    }
+    sampler->taken++;
+}
+
+/*  Function: void stopSampling(SamplerType* sampler, uint64_t seed, uint32_t run)
+    Purpose: Stops the sampler thread once the run is over, takes the final sample and writes
+        the run's samples to the sample file. Call after the agent threads finished
+*/
+void stopSampling(SamplerType* sampler, uint64_t seed, uint32_t run) {
+    uint32_t header[6];
+    uint32_t kept;
+
+    if (sampler->intervalTurns == 0) {
+        pthread_join(sampler->thread, NULL);
+    }
+    takeSample(sampler);
+    kept = (sampler->taken < SAMPLE_RING) ? sampler->taken : SAMPLE_RING;
+    header[0] = run;
+    header[1] = sampler->roomCount;
+    header[2] = (sampler->entries == 0) ? 0 : (sampler->occupied == NULL) ? 1 : 2;
+    header[3] = sampler->entries;
+    header[4] = kept;
+    header[5] = sampler->taken - kept;
+
+    // Write the rings oldest first, field by field so struct padding never reaches the file
+    fwrite(&seed, sizeof(seed), 1, sampler->file);
+    fwrite(header, sizeof(uint32_t), 6, sampler->file);
+    for (uint64_t i = sampler->taken - kept; i < sampler->taken; i++) {
+        SampleType* sample = &(sampler->ring[i % SAMPLE_RING]);
+        fwrite(&(sample->nanos), sizeof(uint64_t), 1, sampler->file);
+        fwrite(&(sample->ghostTurns), sizeof(uint32_t), 1, sampler->file);
+        fwrite(&(sample->ghostRoom), sizeof(uint32_t), 1, sampler->file);
+        fwrite(sample->fear, sizeof(uint16_t), FEAR_MAX + 1, sampler->file);
+        fwrite(sample->boredom, sizeof(uint16_t), SAMPLE_BOREDOM_BUCKETS, sampler->file);
+        fwrite(sample->evidenceRooms, sizeof(uint16_t), EV_COUNT, sampler->file);
+        fwrite(sample->collected, sizeof(uint16_t), EV_COUNT, sampler->file);
+        if (sampler->occupied != NULL) {
+            fwrite(sampler->occupied + (i % SAMPLE_RING) * sampler->entries, sizeof(uint32_t), sampler->entries, sampler->file);
+        }
+        fwrite(sampler->occupancy + (i % SAMPLE_RING) * sampler->entries, sizeof(uint16_t), sampler->entries, sampler->file);
+    }
+    sampler->house->sampler = NULL;
+    sampler->house = NULL;
+}
+
+/*  Function: void closeSampler(SamplerType* sampler)
+    Purpose: Closes the sample file and frees the rings of the sampler at the pointer 'sampler'
+*/
+void closeSampler(SamplerType* sampler) {
+    fclose(sampler->file);
+    trackedFree(MEM_LOGGING, sampler->ring, SAMPLE_RING * sizeof(SampleType));
+    freeOccupancy(sampler);
+}
@@ -0,0 +1,199 @@
+#include "defs.h"
+
+/*  Function: void initRoster(RosterType* roster)
+    Purpose: Initializes the roster structure found at the pointer 'roster' as an empty
+        array of hunter specifications
+*/
+void initRoster(RosterType* roster) {
+    roster->hunters = NULL;
+    roster->size = 0;
+    roster->capacity = 0;
+}
+
+/*  Function: void addHunterSpec(RosterType* roster, char* name, enum EvidenceType equipment)
+    Purpose: Adds a hunter specification with the provided name and equipment to the back
+        of the roster at the pointer 'roster', growing the array when it is full
+*/
+void addHunterSpec(RosterType* roster, char* name, enum EvidenceType equipment) {
+    // Double the capacity of the array when full
+    if (roster->size == roster->capacity) {
+        int oldCapacity = roster->capacity;
+        roster->capacity = (roster->capacity == 0) ? NUM_HUNTERS : roster->capacity * 2;
+        roster->hunters = trackedRealloc(MEM_AGENTS, roster->hunters, oldCapacity * sizeof(HunterSpec), roster->capacity * sizeof(HunterSpec));
+    }
+
+    // Copy the specification to the back of the array
+    strncpy(roster->hunters[roster->size].name, name, MAX_STR - 1);
+    roster->hunters[roster->size].name[MAX_STR - 1] = '\0';
+    roster->hunters[roster->size].equipment = equipment;
+    roster->hunters[roster->size].room = 0;
+    roster->hunters[roster->size].fearMax = FEAR_MAX;
+    roster->hunters[roster->size].boredomMax = BOREDOM_MAX;
+    roster->size++;
+}
+
+/*  Function: void readRoster(RosterType* roster)
+    Purpose: Prompts for the name and equipment of each hunter on the console and adds
+        them to the roster at the pointer 'roster'
+*/
+void readRoster(RosterType* roster) {
+    char name[MAX_STR];
+    char equipment[MAX_STR];
+
+    // Loop to read all the hunters
+    for (int i = 0; i < NUM_HUNTERS; i++) {
+        printf("Enter the name of hunter #%d: \n", i + 1);
+        scanf("%63s", name);
+        while ((getchar()) != '\n');
+
+        printf("What type of data should %s collect (EMF, TEMPERATURE, FINGERPRINTS, SOUND, UNKNOWN): \n", name);
+        scanf("%63s", equipment);
+        while ((getchar()) != '\n');
+
+        addHunterSpec(roster, name, stringToEvidence(equipment));
+    }
+}
+
+/*  Function: void cleanRoster(RosterType* roster)
+    Purpose: Deallocates the memory in the heap used by the roster at the pointer 'roster'
+*/
+void cleanRoster(RosterType* roster) {
+    trackedFree(MEM_AGENTS, roster->hunters, roster->capacity * sizeof(HunterSpec));
+    initRoster(roster);
+}
+
+/*  Function: void setupSimulation(OptionsType* options, RosterType* roster, RoutingType* routing, uint64_t seed, HouseType* house, GhostType** ghost)
+    Purpose: Builds the house at the pointer 'house' as described by 'options' and places the
+        ghost and the hunters from 'roster' in it, ready to run with the agents seeded from 'seed'.
+        The house is built on the topology shared through 'routing' when there is one, and
+        hunters are routed with its routing data when it was built
+*/
+void setupSimulation(OptionsType* options, RosterType* roster, RoutingType* routing, uint64_t seed, HouseType* house, GhostType** ghost) {
+    HunterType* hunter;
+
+    // Generated houses share one topology across the batch
+    if (routing->topology != NULL) {
+        initSharedHouse(house, routing->topology);
+    } else {
+        seedRandom(mixSeed(options->seed, 0));
+        initHouse(house, options->rooms, options->roomOrder);
+    }
+    if (routing->roomCount == house->roomCount) {
+        house->routing = routing;
+        house->movement = options->movement;
+        house->haunting = options->haunting;
+    }
+    house->hunterWait = options->hunterWait;
+    house->ghostWait = options->ghostWait;
+    house->pacing = options->pacing;
+    house->evidenceCapacity = options->evidenceCapacity;
+    house->evidenceTtl = options->evidenceTtl;
+    initProximity(house);
+    initSummary(house);
+
+    // The rest of the setup on this thread draws from the run's own stream
+    seedRandom(mixSeed(seed, 0));
+    initGhost(house, ghost);
+    (*ghost)->seed = mixSeed(seed, 1);
+
+    // Create the run's hunters in their start rooms, the van unless the roster says otherwise
+    for (int i = 0; i < rosterPlayers(roster); i++) {
+        HunterSpec* spec = rosterHunter(roster, seed, i);
+        initHunter(house, createdRoom(house->topology, spec->room), spec->equipment, spec->name, &hunter);
+        hunter->fearMax = spec->fearMax;
+        hunter->boredomMax = spec->boredomMax;
+        hunter->id = i;
+        hunter->seed = mixSeed(seed, i + 2);
+        hunter->termination = &(house->termination);
+        trackHunter(house, ROOM_NONE, hunter->room->id);
+        addHunter(&(house->hunters), hunter);
+    }
+    (*ghost)->id = house->hunters.size;
+    initTermination(&(house->termination), house->hunters.size);
+}
+
+/*  Function: void recordRun(HouseType* house, uint64_t seed, uint32_t run, RunRecord* record)
+    Purpose: Stores the outcome of the finished simulation in the house at the pointer 'house'
+        in 'record'
+*/
+void recordRun(HouseType* house, uint64_t seed, uint32_t run, RunRecord* record) {
+    enum EvidenceType uniqueEvidence[EV_COUNT] = {0};
+    HunterType* hunter;
+
+    memset(record, 0, sizeof(RunRecord));
+    memset(record->hunterExit, LOG_UNKNOWN, sizeof(record->hunterExit));
+    record->seed = seed;
+    record->run = run;
+    record->ghostClass = house->ghost->type;
+    record->evidenceMask = evidenceMask(&(house->evidence));
+    record->ghostBoredom = house->ghost->boredom;
+    record->ghostTurns = house->ghost->turns;
+    for (int i = 0; i < house->hunters.size; i++) {
+        hunter = house->hunters.elements[i];
+        record->hunterExit[i] = hunter->exitReason;
+        record->hunterFear[i] = hunter->fear;
+        record->hunterBoredom[i] = hunter->boredom;
+        record->hunterTurns[i] = hunter->turns;
+    }
+    for (int i = 0; i < EV_COUNT; i++) {
+        uniqueEvidence[i] = (record->evidenceMask >> i) & 1;
+    }
+    record->outcome = huntersWin(house, uniqueEvidence);
+}
+
+/*  Function: void runSimulation(OptionsType* options, RosterType* roster, RoutingType* routing, SamplerType* sampler, uint64_t seed, uint32_t run, RunRecord* record, int print)
+    Purpose: Builds a house as described by 'options', places the ghost and the hunters from 'roster'
+        in it, runs one threaded simulation seeded with 'seed' and stores its outcome in 'record'.
+        Hunters are routed with the shared 'routing' data when it was built, and the run is
+        recorded by 'sampler' unless it is NULL. Prints the results to the console when 'print'
+        is true
+*/
+void runSimulation(OptionsType* options, RosterType* roster, RoutingType* routing, SamplerType* sampler, uint64_t seed, uint32_t run, RunRecord* record, int print) {
+    HouseType house;
+    GhostType* ghost;
+    pthread_t threadIDS[NUM_HUNTERS + NUM_GHOSTS];
+    MemoryTotals before;
+
+    // Note what is allocated before the run, so whatever cleanUp misses shows as a leak
+    if (memoryAccounting()) {
+        memoryTotals(&before);
+    }
+    setupSimulation(options, roster, routing, seed, &house, &ghost);
+
+    // Report the memory layout once at startup
+    if (run == 0) {
+        printLayout(&house);
+    }
+
+    // Create threads for the hunters and the ghost, sampling from before they start
+    if (sampler != NULL) {
+        startSampling(sampler, &house);
+    }
+    pthread_create(threadIDS, NULL, runGhost, ghost);
+    for (int i = 0; i < house.hunters.size; i++) {
+        pthread_create(threadIDS + i + 1, NULL, runHunter, house.hunters.elements[i]);
+    }
+
+    // Wait for all threads to finish
+    for (int i = 0; i < house.hunters.size + NUM_GHOSTS; i++) {
+        pthread_join(threadIDS[i], NULL);
+    }
+    if (sampler != NULL) {
+        stopSampling(sampler, seed, run);
+    }
+
+    // Record the outcome of the run
+    recordRun(&house, seed, run, record);
+
+    // Print results to the console
+    if (print) {
+        printResults(&house);
+    }
+    reportPacing(&house, run, print);
+
+    // Clean up all memory used in the heap
+    cleanUp(&house);
+    if (memoryAccounting()) {
+        reportLeaks(&before, run);
+    }
+}
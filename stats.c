@@ -0,0 +1,305 @@
+#include "defs.h"
+#include <math.h>
+
+/*
+    Run tallies count the outcomes of a batch the way the result file would record them, so two
+    engines, or two builds of one engine, can be checked for playing the same game. The hunter
+    win rate is compared with a two proportion z test, why hunters left, how many evidence
+    types were found and the ghost class with a chi-square test of homogeneity, and run lengths
+    with a two sample Kolmogorov-Smirnov test on their distributions.
+
+    The run is the unit of every test. The hunters of one run share its ghost and its end, so
+    their exits and turns are not independent observations: a run is tallied by the pattern
+    of reasons its hunters left for and by the mean turns they took.
+
+    Each test gives the probability of seeing a difference at least as large if both engines
+    played the same game. A test fails when that probability falls below the significance level
+    divided by the number of tests (Bonferroni), so two engines playing the same game fail the
+    comparison at most that often by chance, while a change to the rules shows up once the
+    batches are large enough to see it.
+*/
+
+#define TALLY_TESTS     6               // tests compareTallies runs
+
+/*
+    Returns the regularized upper incomplete gamma function Q(s, x), by its series below s + 1
+    and its continued fraction above.
+*/
+static double upperGamma(double s, double x) {
+    double front;
+
+    if (x <= 0) {
+        return 1;
+    }
+    front = exp(s * log(x) - x - lgamma(s));
+    if (x < s + 1) {
+        double term = 1 / s, sum = term;
+        for (int n = 1; n < 1000 && term > sum * 1e-15; n++) {
+            term *= x / (s + n);
+            sum += term;
+        }
+        return 1 - sum * front;
+    } else {
+        double b = x + 1 - s, c = 1e300, d = 1 / b, h = d;
+        for (int n = 1; n < 1000; n++) {
+            double a = -n * (n - s), delta;
+            b += 2;
+            d = a * d + b;
+            d = (fabs(d) < 1e-300) ? 1e-300 : d;
+            c = b + a / c;
+            c = (fabs(c) < 1e-300) ? 1e-300 : c;
+            d = 1 / d;
+            delta = d * c;
+            h *= delta;
+            if (fabs(delta - 1) < 1e-15) {
+                break;
+            }
+        }
+        return h * front;
+    }
+}
+
+/*
+    Returns the chi-square terms of a category counted 'countA' and 'countB' times, of sides
+    with 'totalA' and 'totalB' counts in all.
+*/
+static double chiTerm(double countA, double countB, double totalA, double totalB) {
+    double expectA = (countA + countB) * totalA / (totalA + totalB);
+    double expectB = (countA + countB) * totalB / (totalA + totalB);
+    return (countA - expectA) * (countA - expectA) / expectA + (countB - expectB) * (countB - expectB) / expectB;
+}
+
+/*
+    Chi-square test of homogeneity of two count vectors of 'k' categories. Neighbouring
+    categories are merged until each side expects at least 5 counts, any left over joining the
+    last merged one, so the asymptotic p-value holds. Sets 'statistic' and returns the p-value.
+*/
+static double chiSquare(const uint32_t* a, const uint32_t* b, int k, double* statistic) {
+    double totalA = 0, totalB = 0, smaller, binA = 0, binB = 0, lastA = 0, lastB = 0;
+    int categories = 0;
+
+    for (int i = 0; i < k; i++) {
+        totalA += a[i];
+        totalB += b[i];
+    }
+    *statistic = 0;
+    if (totalA == 0 || totalB == 0) {
+        return 1;
+    }
+
+    // A merged category is added once the next one fills, so the remainder can still join it
+    smaller = fmin(totalA, totalB) / (totalA + totalB);
+    for (int i = 0; i < k; i++) {
+        binA += a[i];
+        binB += b[i];
+        if ((binA + binB) * smaller >= 5) {
+            if (categories++ > 0) {
+                *statistic += chiTerm(lastA, lastB, totalA, totalB);
+            }
+            lastA = binA;
+            lastB = binB;
+            binA = binB = 0;
+        }
+    }
+    *statistic += chiTerm(lastA + binA, lastB + binB, totalA, totalB);
+    return (categories < 2) ? 1 : upperGamma((categories - 1) / 2.0, *statistic / 2);
+}
+
+/*
+    Two sample Kolmogorov-Smirnov test of two histograms of 'k' buckets. Sets 'statistic' to the
+    largest distance between their distribution functions and returns the asymptotic p-value.
+*/
+static double kolmogorovSmirnov(const uint32_t* a, const uint32_t* b, int k, double* statistic) {
+    double totalA = 0, totalB = 0, sumA = 0, sumB = 0, n, lambda, p = 0;
+
+    for (int i = 0; i < k; i++) {
+        totalA += a[i];
+        totalB += b[i];
+    }
+    *statistic = 0;
+    if (totalA == 0 || totalB == 0) {
+        return 1;
+    }
+    for (int i = 0; i < k; i++) {
+        sumA += a[i];
+        sumB += b[i];
+        *statistic = fmax(*statistic, fabs(sumA / totalA - sumB / totalB));
+    }
+
+    n = totalA * totalB / (totalA + totalB);
+    lambda = (sqrt(n) + 0.12 + 0.11 / sqrt(n)) * *statistic;
+    if (lambda < 0.2) {
+        return 1;
+    }
+    for (int j = 1; j <= 100; j++) {
+        double term = 2 * ((j % 2) ? 1 : -1) * exp(-2.0 * j * j * lambda * lambda);
+        p += term;
+        if (fabs(term) < 1e-12) {
+            break;
+        }
+    }
+    return fmin(fmax(p, 0), 1);
+}
+
+/*
+    Two proportion z test of 'winsA' of 'runsA' against 'winsB' of 'runsB'. Sets 'statistic' and
+    returns the two sided p-value.
+*/
+static double twoProportions(double winsA, double runsA, double winsB, double runsB, double* statistic) {
+    double pooled = (winsA + winsB) / (runsA + runsB);
+    double spread = sqrt(pooled * (1 - pooled) * (1 / runsA + 1 / runsB));
+
+    *statistic = (spread > 0) ? (winsA / runsA - winsB / runsB) / spread : 0;
+    return erfc(fabs(*statistic) / sqrt(2));
+}
+
+/*
+    Returns the share of category 'i' among counts of 'k' categories.
+*/
+static double share(const uint32_t* counts, int k, int i) {
+    double total = 0;
+
+    for (int j = 0; j < k; j++) {
+        total += counts[j];
+    }
+    return (total > 0) ? counts[i] / total : 0;
+}
+
+/*
+    Returns the mean of a histogram of 'k' buckets.
+*/
+static double histogramMean(const uint32_t* counts, int k) {
+    double total = 0, sum = 0;
+
+    for (int i = 0; i < k; i++) {
+        total += counts[i];
+        sum += (double) i * counts[i];
+    }
+    return (total > 0) ? sum / total : 0;
+}
+
+/*
+    Prints one row of the comparison and returns C_TRUE if its p-value passes 'alpha'.
+*/
+static int reportTest(const char* metric, const char* test, double statistic, double p, double reference, double candidate, double alpha) {
+    int pass = !(p < alpha);
+    printf("%s,%s,%.4f,%.6f,%.4f,%.4f,%s\n", metric, test, statistic, p, reference, candidate, pass ? "pass" : "FAIL");
+    return pass;
+}
+
+/*
+    Returns the number of ways to choose 'k' of 'n' things.
+*/
+static uint64_t choose(uint32_t n, uint32_t k) {
+    uint64_t ways = 1;
+
+    if (k > n) {
+        return 0;
+    }
+    for (uint32_t i = 1; i <= k; i++) {
+        ways = ways * (n - k + i) / i;
+    }
+    return ways;
+}
+
+/*
+    Returns the index of the pattern of exit reasons of the hunters in 'record', the same for
+    any order of the hunters. The reasons are sorted, unused slots last, and ranked as a
+    multiset in the combinatorial number system, which numbers the patterns from 0 without gaps.
+*/
+static uint32_t exitPattern(RunRecord* record) {
+    uint32_t reasons[NUM_HUNTERS];
+    uint64_t rank = 0;
+
+    for (int h = 0; h < NUM_HUNTERS; h++) {
+        uint32_t reason = (record->hunterExit[h] <= LOG_UNKNOWN) ? record->hunterExit[h] : LOG_UNKNOWN;
+        int i = h;
+        for (; i > 0 && reasons[i - 1] > reason; i--) {
+            reasons[i] = reasons[i - 1];
+        }
+        reasons[i] = reason;
+    }
+    for (int i = 0; i < NUM_HUNTERS; i++) {
+        rank += choose(reasons[i] + i, i + 1);
+    }
+    return (rank < TALLY_PATTERNS) ? rank : TALLY_PATTERNS - 1;
+}
+
+/*  Function: void initTally(RunTally* tally)
+    Purpose: Initializes the tally at the pointer 'tally' with no runs counted
+*/
+void initTally(RunTally* tally) {
+    memset(tally, 0, sizeof(RunTally));
+}
+
+/*  Function: void tallyRun(RunTally* tally, RunRecord* record)
+    Purpose: Counts the outcome of the run in 'record' in the tally at the pointer 'tally'.
+        Hunter slots the run did not use, marked with the exit reason LOG_UNKNOWN, are not counted
+        as hunters
+*/
+void tallyRun(RunTally* tally, RunRecord* record) {
+    uint64_t hunterTurns = 0;
+    int types = 0, hunters = 0;
+
+    tally->runs++;
+    tally->outcomes[record->outcome ? 1 : 0]++;
+    tally->ghosts[record->ghostClass < GHOST_COUNT ? record->ghostClass : 0]++;
+    for (int i = 0; i < EV_COUNT; i++) {
+        types += (record->evidenceMask >> i) & 1;
+    }
+    tally->evidenceTypes[types]++;
+    tally->ghostTurns[record->ghostTurns < TALLY_TURNS ? record->ghostTurns : TALLY_TURNS - 1]++;
+    for (int h = 0; h < NUM_HUNTERS; h++) {
+        if (record->hunterExit[h] == LOG_UNKNOWN) {
+            continue;
+        }
+        tally->exits[record->hunterExit[h] <= LOG_UNKNOWN ? record->hunterExit[h] : LOG_UNKNOWN]++;
+        hunterTurns += record->hunterTurns[h];
+        hunters++;
+    }
+    tally->exitPatterns[exitPattern(record)]++;
+    if (hunters > 0) {
+        uint64_t mean = (hunterTurns + hunters / 2) / hunters;
+        tally->hunterTurns[mean < TALLY_TURNS ? mean : TALLY_TURNS - 1]++;
+    }
+}
+
+/*  Function: int compareTallies(RunTally* reference, RunTally* candidate, double alpha)
+    Purpose: Tests whether the runs of the 'candidate' tally could come from the same game as
+        those of the 'reference' tally and prints a csv row per test, at a significance level
+        of 'alpha' over all the tests. Each row also shows a summary of both sides: the win
+        rate, the share of hunters leaving in fear, the mean evidence types found, the share of
+        poltergeists, the mean ghost turns and the mean of the runs' mean hunter turns. Returns
+        the number of tests that failed
+*/
+int compareTallies(RunTally* reference, RunTally* candidate, double alpha) {
+    double each = alpha / TALLY_TESTS;
+    double statistic, p;
+    int failed = 0;
+
+    printf("metric,test,statistic,p_value,reference,candidate,result\n");
+    p = twoProportions(reference->outcomes[1], reference->runs, candidate->outcomes[1], candidate->runs, &statistic);
+    failed += !reportTest("hunter_win_rate", "z", statistic, p, (double) reference->outcomes[1] / reference->runs,
+        (double) candidate->outcomes[1] / candidate->runs, each);
+
+    p = chiSquare(reference->exitPatterns, candidate->exitPatterns, TALLY_PATTERNS, &statistic);
+    failed += !reportTest("hunter_exit_reason", "chi2", statistic, p, share(reference->exits, LOG_UNKNOWN + 1, LOG_FEAR),
+        share(candidate->exits, LOG_UNKNOWN + 1, LOG_FEAR), each);
+
+    p = chiSquare(reference->evidenceTypes, candidate->evidenceTypes, EV_COUNT + 1, &statistic);
+    failed += !reportTest("evidence_types", "chi2", statistic, p, histogramMean(reference->evidenceTypes, EV_COUNT + 1),
+        histogramMean(candidate->evidenceTypes, EV_COUNT + 1), each);
+
+    p = chiSquare(reference->ghosts, candidate->ghosts, GHOST_COUNT, &statistic);
+    failed += !reportTest("ghost_class", "chi2", statistic, p, share(reference->ghosts, GHOST_COUNT, POLTERGEIST),
+        share(candidate->ghosts, GHOST_COUNT, POLTERGEIST), each);
+
+    p = kolmogorovSmirnov(reference->ghostTurns, candidate->ghostTurns, TALLY_TURNS, &statistic);
+    failed += !reportTest("ghost_turns", "ks", statistic, p, histogramMean(reference->ghostTurns, TALLY_TURNS),
+        histogramMean(candidate->ghostTurns, TALLY_TURNS), each);
+
+    p = kolmogorovSmirnov(reference->hunterTurns, candidate->hunterTurns, TALLY_TURNS, &statistic);
+    failed += !reportTest("hunter_turns", "ks", statistic, p, histogramMean(reference->hunterTurns, TALLY_TURNS),
+        histogramMean(candidate->hunterTurns, TALLY_TURNS), each);
+    return failed;
+}
@@ -0,0 +1,339 @@
+#include "defs.h"
+
+/*
+    The evidence summary tells a hunter where the evidence it can collect lies without
+    searching the house. The rooms are grouped into clusters of at most SUMMARY_FANOUT
+    connected rooms, those clusters into clusters of at most SUMMARY_FANOUT neighbouring
+    clusters, and so on up to a single root. The tree is built once per topology and stored
+    with the routing data. Each run then keeps, for every cluster, the number of its rooms
+    holding each evidence type, and the types with a count above zero are the cluster's
+    evidence mask. Leaving or collecting evidence touches one count per level, and a query
+    climbs from a room to the smallest cluster holding the type and walks back down to a room.
+*/
+
+/*
+    Groups the 'count' nodes of the graph in 'offsets' and 'neighbors' into clusters of at most
+    SUMMARY_FANOUT nodes, each grown breadth first from the lowest unassigned node. Clusters
+    left smaller than SUMMARY_SMALL, whose neighbours were taken first, are then pooled by a
+    neighbouring cluster of full size, so a hub with many leaves does not stall the levels
+    above. Sets the cluster of each node in 'assign', lists the nodes cluster by cluster in
+    'members' with each cluster's start in 'starts', and returns the number of clusters.
+    Without 'neighbors' the nodes are grouped in id order.
+*/
+static uint32_t growClusters(uint32_t count, const uint32_t* offsets, const uint32_t* neighbors,
+    uint32_t* assign, uint32_t* members, uint32_t* starts) {
+    uint32_t* sizes = trackedMalloc(MEM_TOPOLOGY, count * sizeof(uint32_t));
+    uint32_t* pools = trackedMalloc(MEM_TOPOLOGY, count * sizeof(uint32_t));
+    uint32_t* remap = trackedMalloc(MEM_TOPOLOGY, count * sizeof(uint32_t));
+    uint32_t* order = trackedMalloc(MEM_TOPOLOGY, count * sizeof(uint32_t));
+    uint32_t grown = 0, clusters = 0, used = 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+        assign[i] = ROOM_NONE;
+    }
+    for (uint32_t source = 0; source < count; source++) {
+        uint32_t head, first = used;
+
+        if (assign[source] != ROOM_NONE) {
+            continue;
+        }
+        head = used;
+        assign[source] = grown;
+        members[used++] = source;
+
+        // The members list doubles as the queue of the search
+        while (head < used && used - first < SUMMARY_FANOUT) {
+            uint32_t node = members[head++];
+
+            if (neighbors == NULL) {
+                if (node + 1 < count && assign[node + 1] == ROOM_NONE) {
+                    assign[node + 1] = grown;
+                    members[used++] = node + 1;
+                }
+                continue;
+            }
+            for (uint32_t e = offsets[node]; e < offsets[node + 1] && used - first < SUMMARY_FANOUT; e++) {
+                uint32_t next = neighbors[e];
+                if (assign[next] == ROOM_NONE) {
+                    assign[next] = grown;
+                    members[used++] = next;
+                }
+            }
+        }
+        sizes[grown++] = used - first;
+    }
+
+    // Pool each small cluster with the others beside the same full cluster, 'starts' holding sizes
+    for (uint32_t c = 0; c < grown; c++) {
+        pools[c] = ROOM_NONE;
+    }
+    for (uint32_t c = 0, i = 0; c < grown; i += sizes[c++]) {
+        uint32_t pool = c;
+
+        for (uint32_t m = i; neighbors != NULL && sizes[c] < SUMMARY_SMALL && m < i + sizes[c] && pool == c; m++) {
+            for (uint32_t e = offsets[members[m]]; e < offsets[members[m] + 1]; e++) {
+                if (sizes[assign[neighbors[e]]] >= SUMMARY_SMALL) {
+                    pool = assign[neighbors[e]];
+                    break;
+                }
+            }
+        }
+        if (pool == c || pools[pool] == ROOM_NONE || starts[pools[pool]] + sizes[c] > SUMMARY_FANOUT) {
+            pools[pool] = clusters;
+            starts[clusters++] = 0;
+        }
+        remap[c] = pools[pool];
+        starts[remap[c]] += sizes[c];
+    }
+
+    // List the members by their final cluster, then turn the sizes into starts
+    for (uint32_t c = 0, sum = 0; c < clusters; c++) {
+        uint32_t size = starts[c];
+        starts[c] = sum;
+        sum += size;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t cluster = remap[assign[members[i]]];
+        order[starts[cluster]++] = members[i];
+    }
+    for (uint32_t c = clusters; c > 0; c--) {
+        starts[c] = starts[c - 1];
+    }
+    starts[0] = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        members[i] = order[i];
+        assign[members[i]] = remap[assign[members[i]]];
+    }
+
+    trackedFree(MEM_TOPOLOGY, sizes, count * sizeof(uint32_t));
+    trackedFree(MEM_TOPOLOGY, pools, count * sizeof(uint32_t));
+    trackedFree(MEM_TOPOLOGY, remap, count * sizeof(uint32_t));
+    trackedFree(MEM_TOPOLOGY, order, count * sizeof(uint32_t));
+    return clusters;
+}
+
+/*
+    Contracts the graph of 'count' nodes in 'offsets' and 'neighbors' into the graph of the
+    'clusters' clusters in 'assign', 'members' and 'starts', two clusters being neighbours
+    when any of their nodes are. Sets 'nextOffsets' and 'nextNeighbors' to the new graph.
+*/
+static void contractClusters(uint32_t count, const uint32_t* offsets, const uint32_t* neighbors,
+    uint32_t clusters, const uint32_t* assign, const uint32_t* members, const uint32_t* starts,
+    uint32_t** nextOffsets, uint32_t** nextNeighbors) {
+    uint32_t* stamp = trackedMalloc(MEM_TOPOLOGY, clusters * sizeof(uint32_t));
+    uint32_t edges = offsets[count], used = 0;
+
+    // A cluster has no more neighbours than its nodes have edges, so the old edges bound the new
+    *nextOffsets = trackedMalloc(MEM_TOPOLOGY, (clusters + 1) * sizeof(uint32_t));
+    *nextNeighbors = trackedMalloc(MEM_TOPOLOGY, (edges + 1) * sizeof(uint32_t));
+    for (uint32_t c = 0; c < clusters; c++) {
+        stamp[c] = ROOM_NONE;
+    }
+    for (uint32_t c = 0; c < clusters; c++) {
+        (*nextOffsets)[c] = used;
+        stamp[c] = c;
+        for (uint32_t m = starts[c]; m < starts[c + 1]; m++) {
+            for (uint32_t e = offsets[members[m]]; e < offsets[members[m] + 1]; e++) {
+                uint32_t other = assign[neighbors[e]];
+                if (stamp[other] != c) {
+                    stamp[other] = c;
+                    (*nextNeighbors)[used++] = other;
+                }
+            }
+        }
+    }
+    (*nextOffsets)[clusters] = used;
+    *nextNeighbors = trackedRealloc(MEM_TOPOLOGY, *nextNeighbors, (edges + 1) * sizeof(uint32_t), (used + 1) * sizeof(uint32_t));
+    trackedFree(MEM_TOPOLOGY, stamp, clusters * sizeof(uint32_t));
+}
+
+/*  Function: void buildSummary(RoutingType* routing)
+    Purpose: Builds the cluster tree of the evidence summary over the packed topology in
+        'routing', level by level until one cluster holds the whole house. Clusters are
+        numbered from the lowest level up, so the root is the last
+*/
+void buildSummary(RoutingType* routing) {
+    uint32_t n = routing->roomCount;
+    const uint32_t* offsets = routing->offsets;
+    const uint32_t* neighbors = routing->neighbors;
+    uint32_t* graphOffsets = NULL;
+    uint32_t* graphNeighbors = NULL;
+    uint32_t* assign = trackedMalloc(MEM_TOPOLOGY, n * sizeof(uint32_t));
+    uint32_t* members = trackedMalloc(MEM_TOPOLOGY, n * sizeof(uint32_t));
+    uint32_t* starts = trackedMalloc(MEM_TOPOLOGY, (n + 1) * sizeof(uint32_t));
+    uint32_t count = n, base = 0, below = 0, used = 0, levels = 0;
+    uint32_t capacity = n / 4 + 2, childCapacity = n + capacity;
+
+    routing->clusterOf = trackedMalloc(MEM_TOPOLOGY, n * sizeof(uint32_t));
+    routing->clusterParent = trackedMalloc(MEM_TOPOLOGY, capacity * sizeof(uint32_t));
+    routing->childOffsets = trackedMalloc(MEM_TOPOLOGY, (capacity + 1) * sizeof(uint32_t));
+    routing->children = trackedMalloc(MEM_TOPOLOGY, childCapacity * sizeof(uint32_t));
+
+    while (C_TRUE) {
+        uint32_t clusters = growClusters(count, offsets, neighbors, assign, members, starts);
+
+        // A level that merged nothing is grouped by id, so the tree always reaches a root
+        if (clusters == count && count > 1) {
+            clusters = growClusters(count, NULL, NULL, assign, members, starts);
+        }
+        if (base + clusters + 1 > capacity) {
+            uint32_t grown = 2 * (base + clusters + 1);
+            routing->clusterParent = trackedRealloc(MEM_TOPOLOGY, routing->clusterParent, capacity * sizeof(uint32_t), grown * sizeof(uint32_t));
+            routing->childOffsets = trackedRealloc(MEM_TOPOLOGY, routing->childOffsets, (capacity + 1) * sizeof(uint32_t), (grown + 1) * sizeof(uint32_t));
+            capacity = grown;
+        }
+        if (used + count > childCapacity) {
+            uint32_t grown = 2 * (used + count);
+            routing->children = trackedRealloc(MEM_TOPOLOGY, routing->children, childCapacity * sizeof(uint32_t), grown * sizeof(uint32_t));
+            childCapacity = grown;
+        }
+
+        // Record the level: the children of each cluster, then the parent of each node below
+        for (uint32_t c = 0; c < clusters; c++) {
+            routing->childOffsets[base + c] = used + starts[c];
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            routing->children[used + i] = (levels == 0) ? members[i] : below + members[i];
+            if (levels == 0) {
+                routing->clusterOf[i] = base + assign[i];
+            } else {
+                routing->clusterParent[below + i] = base + assign[i];
+            }
+        }
+        used += count;
+        if (levels++ == 0) {
+            routing->leafClusters = clusters;
+        }
+        if (clusters == 1) {
+            routing->clusterParent[base++] = ROOM_NONE;
+            break;
+        }
+
+        // The clusters are the nodes of the next level
+        {
+            uint32_t* nextOffsets;
+            uint32_t* nextNeighbors;
+            contractClusters(count, offsets, neighbors, clusters, assign, members, starts, &nextOffsets, &nextNeighbors);
+            if (graphOffsets != NULL) {
+                trackedFree(MEM_TOPOLOGY, graphNeighbors, (graphOffsets[count] + 1) * sizeof(uint32_t));
+                trackedFree(MEM_TOPOLOGY, graphOffsets, (count + 1) * sizeof(uint32_t));
+            }
+            offsets = graphOffsets = nextOffsets;
+            neighbors = graphNeighbors = nextNeighbors;
+        }
+        below = base;
+        base += clusters;
+        count = clusters;
+    }
+    routing->childOffsets[base] = used;
+    routing->clusterCount = base;
+    routing->summaryLevels = levels;
+
+    // Trim the tree to its size, which is all cleanRouting knows of it
+    routing->clusterParent = trackedRealloc(MEM_TOPOLOGY, routing->clusterParent, capacity * sizeof(uint32_t), base * sizeof(uint32_t));
+    routing->childOffsets = trackedRealloc(MEM_TOPOLOGY, routing->childOffsets, (capacity + 1) * sizeof(uint32_t), (base + 1) * sizeof(uint32_t));
+    routing->children = trackedRealloc(MEM_TOPOLOGY, routing->children, childCapacity * sizeof(uint32_t), used * sizeof(uint32_t));
+
+    if (graphOffsets != NULL) {
+        trackedFree(MEM_TOPOLOGY, graphNeighbors, (graphOffsets[count] + 1) * sizeof(uint32_t));
+        trackedFree(MEM_TOPOLOGY, graphOffsets, (count + 1) * sizeof(uint32_t));
+    }
+    trackedFree(MEM_TOPOLOGY, assign, n * sizeof(uint32_t));
+    trackedFree(MEM_TOPOLOGY, members, n * sizeof(uint32_t));
+    trackedFree(MEM_TOPOLOGY, starts, (n + 1) * sizeof(uint32_t));
+}
+
+/*  Function: void initSummary(HouseType* house)
+    Purpose: Allocates the empty evidence counts of the house at the pointer 'house', if its
+        routing data holds a cluster tree
+*/
+void initSummary(HouseType* house) {
+    house->clusterEvidence = NULL;
+    if (house->routing != NULL && house->routing->clusterCount > 0) {
+        house->clusterEvidence = trackedCalloc(MEM_EVIDENCE, (size_t) house->routing->clusterCount * EV_COUNT, sizeof(_Atomic uint32_t));
+    }
+}
+
+/*  Function: void summarizeEvidence(HouseType* house, RoomId room, int before, int after)
+    Purpose: Updates the evidence counts of the house at the pointer 'house' for the evidence
+        mask of 'room' changing from 'before' to 'after'. Callers hold the room's evidence
+        lock, so each change of a room is counted once
+*/
+void summarizeEvidence(HouseType* house, RoomId room, int before, int after) {
+    RoutingType* routing;
+    int changed = before ^ after;
+
+    if (house->clusterEvidence == NULL || changed == 0) {
+        return;
+    }
+    routing = house->routing;
+
+    // Counts are independent, so relaxed updates are enough and queries see each change promptly
+    for (int type = 0; type < EV_COUNT; type++) {
+        uint32_t delta = ((after >> type) & 1) ? 1 : UINT32_MAX;
+        if (!((changed >> type) & 1)) {
+            continue;
+        }
+        for (uint32_t c = routing->clusterOf[room]; c != ROOM_NONE; c = routing->clusterParent[c]) {
+            atomic_fetch_add_explicit(&(house->clusterEvidence[(size_t) c * EV_COUNT + type]), delta, memory_order_relaxed);
+        }
+    }
+}
+
+/*
+    Returns C_TRUE if evidence of 'type' lies in 'room'.
+*/
+static int roomHolds(HouseType* house, RoomId room, int type) {
+    uint64_t state = atomic_load_explicit(&(house->roomHot[room].state), memory_order_relaxed);
+    return (((state & ROOM_EV_MASK) >> ROOM_EV_SHIFT) >> type) & 1;
+}
+
+/*  Function: RoomId findEvidence(HouseType* house, RoomId from, EvidenceType type)
+    Purpose: Returns the id of a room holding evidence of 'type' in the smallest cluster
+        around 'from' that has any, so the room is near though not always the nearest. With
+        'from' ROOM_NONE any room holding the type is returned. Returns ROOM_NONE if no room
+        holds it or the house keeps no summary
+*/
+RoomId findEvidence(HouseType* house, RoomId from, EvidenceType type) {
+    RoutingType* routing = house->routing;
+    _Atomic uint32_t* counts = house->clusterEvidence;
+    uint32_t cluster;
+
+    if (counts == NULL || type >= EV_COUNT) {
+        return ROOM_NONE;
+    }
+    if (from != ROOM_NONE && roomHolds(house, from, type)) {
+        return from;
+    }
+
+    // Climb to the smallest cluster holding the type
+    cluster = (from == ROOM_NONE) ? routing->clusterCount - 1 : routing->clusterOf[from];
+    while (atomic_load_explicit(&(counts[(size_t) cluster * EV_COUNT + type]), memory_order_relaxed) == 0) {
+        cluster = routing->clusterParent[cluster];
+        if (cluster == ROOM_NONE) {
+            return ROOM_NONE;
+        }
+    }
+
+    // Then walk down through the first child holding it, down to its room
+    while (cluster >= routing->leafClusters) {
+        uint32_t next = ROOM_NONE;
+        for (uint32_t e = routing->childOffsets[cluster]; e < routing->childOffsets[cluster + 1]; e++) {
+            uint32_t child = routing->children[e];
+            if (atomic_load_explicit(&(counts[(size_t) child * EV_COUNT + type]), memory_order_relaxed) > 0) {
+                next = child;
+                break;
+            }
+        }
+        if (next == ROOM_NONE) {
+            return ROOM_NONE;               // The evidence was collected while walking down
+        }
+        cluster = next;
+    }
+    for (uint32_t e = routing->childOffsets[cluster]; e < routing->childOffsets[cluster + 1]; e++) {
+        if (roomHolds(house, routing->children[e], type)) {
+            return routing->children[e];
+        }
+    }
+    return ROOM_NONE;
+}
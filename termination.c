@@ -0,0 +1,121 @@
+#include "defs.h"
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+/*
+    A simulation is over once its outcome can no longer change: a hunter found sufficient
+    evidence, or every hunter has left the house. The termination tracks the agents still in
+    the house and, once the outcome is decided, raises a stop flag and wakes every agent
+    sleeping between turns through a futex on that flag.
+*/
+
+/*  Function: void initTermination(TerminationType* termination, int hunters)
+    Purpose: Initializes the termination at the pointer 'termination' for a simulation with
+        'hunters' hunters and the ghost, a simulation without hunters is stopped from the start
+*/
+void initTermination(TerminationType* termination, int hunters) {
+    atomic_init(&(termination->stopped), hunters == 0);
+    atomic_init(&(termination->activeHunters), hunters);
+    atomic_init(&(termination->activeGhosts), NUM_GHOSTS);
+}
+
+/*  Function: void stopSimulation(TerminationType* termination)
+    Purpose: Marks the outcome of the simulation as decided and wakes every sleeping agent
+*/
+void stopSimulation(TerminationType* termination) {
+    if (atomic_exchange(&(termination->stopped), C_TRUE) == C_FALSE) {
+        syscall(SYS_futex, &(termination->stopped), FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+    }
+}
+
+/*  Function: int simulationStopped(TerminationType* termination)
+    Purpose: Returns C_TRUE once the outcome of the simulation is decided
+*/
+int simulationStopped(TerminationType* termination) {
+    return atomic_load_explicit(&(termination->stopped), memory_order_acquire);
+}
+
+/*  Function: void hunterLeft(TerminationType* termination)
+    Purpose: Records that a hunter left the house, stopping the simulation when it was the last
+*/
+void hunterLeft(TerminationType* termination) {
+    if (atomic_fetch_sub(&(termination->activeHunters), 1) == 1) {
+        stopSimulation(termination);
+    }
+}
+
+/*  Function: void ghostLeft(TerminationType* termination)
+    Purpose: Records that a ghost left the house, hunters may still collect what it left behind
+*/
+void ghostLeft(TerminationType* termination) {
+    atomic_fetch_sub(&(termination->activeGhosts), 1);
+}
+
+/*
+    Sleeps on the stop flag until the monotonic time 'deadline' in nanoseconds, so early
+    wakeups do not shorten the sleep. Returns C_TRUE if the simulation has stopped.
+*/
+static int sleepUntil(TerminationType* termination, uint64_t deadline) {
+    struct timespec until = {deadline / 1000000000, deadline % 1000000000};
+
+    while (!simulationStopped(termination) && nowNanos() < deadline) {
+        syscall(SYS_futex, &(termination->stopped), FUTEX_WAIT_BITSET_PRIVATE, C_FALSE, &until, NULL, FUTEX_BITSET_MATCH_ANY);
+    }
+    return simulationStopped(termination);
+}
+
+/*  Function: int waitTurn(TerminationType* termination, long micros)
+    Purpose: Sleeps for 'micros' microseconds unless the simulation stops first, returns
+        C_TRUE if the simulation has stopped
+*/
+int waitTurn(TerminationType* termination, long micros) {
+    if (micros <= 0) {
+        return simulationStopped(termination);
+    }
+    return sleepUntil(termination, nowNanos() + (uint64_t) micros * 1000);
+}
+
+/*  Function: int paceTurn(TerminationType* termination, PacerType* pacer, long micros, enum PacingMode mode)
+    Purpose: Ends an agent's turn. Relative pacing sleeps 'micros' microseconds like waitTurn.
+        Absolute pacing sleeps until the next deadline on a grid 'micros' microseconds apart,
+        so time spent in the turn does not push later turns back, and records how late the
+        agent woke in the pacer at the pointer 'pacer'. Returns C_TRUE if the simulation has
+        stopped
+*/
+int paceTurn(TerminationType* termination, PacerType* pacer, long micros, enum PacingMode mode) {
+    uint64_t period = (uint64_t) micros * 1000;
+    uint64_t now, late;
+
+    if (mode == PC_RELATIVE || micros <= 0) {
+        return waitTurn(termination, micros);
+    }
+
+    // The grid starts one period after the end of the agent's first turn
+    now = nowNanos();
+    pacer->ticks++;
+    if (pacer->next == 0) {
+        pacer->next = now + period;
+    } else if (now >= pacer->next) {
+        // The turn ran past its deadline. Start the next turn at once while it is less than a
+        // period late, so the agent catches up, and drop the deadlines it missed beyond that
+        // rather than rushing through a burst of turns
+        uint64_t missed = (now - pacer->next) / period;
+        pacer->overruns++;
+        pacer->skipped += missed;
+        pacer->next += (missed + 1) * period;
+        return simulationStopped(termination);
+    }
+
+    if (sleepUntil(termination, pacer->next)) {
+        return C_TRUE;
+    }
+    late = nowNanos() - pacer->next;
+    pacer->wakeups++;
+    pacer->jitterNanos += late;
+    if (late > pacer->jitterMax) {
+        pacer->jitterMax = late;
+    }
+    pacer->next += period;
+    return C_FALSE;
+}
@@ -0,0 +1,126 @@
+#include "defs.h"
+
+/*
+    Turn statistics are kept per agent, so recording a turn never touches shared memory, and
+    merged once the agents have finished. Latencies go into a log linear histogram with eight
+    buckets per power of two nanoseconds, which places percentiles within an eighth of their
+    value in a fixed amount of memory.
+*/
+
+/*
+    Returns the histogram bucket of a latency of 'nanos' nanoseconds.
+*/
+static int turnBucket(uint64_t nanos) {
+    int exponent;
+
+    if (nanos < 8) {
+        return nanos;
+    }
+    exponent = 63 - __builtin_clzll(nanos);
+    return (exponent - 2) * 8 + ((nanos >> (exponent - 3)) & 7);
+}
+
+/*
+    Returns the smallest latency in nanoseconds that falls in histogram bucket 'bucket'.
+*/
+static uint64_t bucketStart(int bucket) {
+    if (bucket < 8) {
+        return bucket;
+    }
+    return (uint64_t) (8 + bucket % 8) << (bucket / 8 - 1);
+}
+
+/*  Function: uint64_t nowNanos()
+    Purpose: Returns the current monotonic time in nanoseconds
+*/
+uint64_t nowNanos(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/*  Function: void initTurnStats(TurnStatsType* stats)
+    Purpose: Initializes the turn statistics at the pointer 'stats' with no turns recorded
+*/
+void initTurnStats(TurnStatsType* stats) {
+    memset(stats, 0, sizeof(TurnStatsType));
+}
+
+/*  Function: void recordTurn(TurnStatsType* stats, uint64_t nanos, uint64_t lockNanos)
+    Purpose: Adds a turn that took 'nanos' nanoseconds, 'lockNanos' of them spent waiting for
+        locks, to the turn statistics at the pointer 'stats'
+*/
+void recordTurn(TurnStatsType* stats, uint64_t nanos, uint64_t lockNanos) {
+    stats->turns++;
+    stats->busyNanos += nanos;
+    stats->lockNanos += lockNanos;
+    stats->histogram[turnBucket(nanos)]++;
+}
+
+/*  Function: void mergeTurnStats(TurnStatsType* into, TurnStatsType* from)
+    Purpose: Adds every turn recorded in the statistics 'from' to the statistics 'into'
+*/
+void mergeTurnStats(TurnStatsType* into, TurnStatsType* from) {
+    into->turns += from->turns;
+    into->busyNanos += from->busyNanos;
+    into->lockNanos += from->lockNanos;
+    for (int i = 0; i < TURN_BUCKETS; i++) {
+        into->histogram[i] += from->histogram[i];
+    }
+}
+
+/*  Function: uint64_t turnPercentile(TurnStatsType* stats, double fraction)
+    Purpose: Returns the latency in nanoseconds that 'fraction' of the recorded turns took at
+        most, rounded down to the start of its histogram bucket
+*/
+uint64_t turnPercentile(TurnStatsType* stats, double fraction) {
+    uint64_t rank = (uint64_t) (fraction * stats->turns);
+    uint64_t seen = 0;
+
+    for (int i = 0; i < TURN_BUCKETS; i++) {
+        seen += stats->histogram[i];
+        if (seen > rank) {
+            return bucketStart(i);
+        }
+    }
+    return (stats->turns > 0) ? bucketStart(TURN_BUCKETS - 1) : 0;
+}
+
+/*
+    Prints one agent's pacing.
+*/
+static void printPacer(char* agent, PacerType* pacer) {
+    printf("[PACING] %-12s %6llu turns, %4llu overruns, %4llu skipped, jitter mean %llu us, max %llu us\n", agent,
+        (unsigned long long) pacer->ticks, (unsigned long long) pacer->overruns, (unsigned long long) pacer->skipped,
+        (unsigned long long) (pacer->wakeups > 0 ? pacer->jitterNanos / pacer->wakeups / 1000 : 0),
+        (unsigned long long) (pacer->jitterMax / 1000));
+}
+
+/*  Function: void reportPacing(HouseType* house, uint32_t run, int print)
+    Purpose: Reports how well the agents of the finished run 'run' in the house at the pointer
+        'house' kept to their absolute turn deadlines. Prints every agent when 'print' is true,
+        otherwise prints a line only when some turn overran its deadline
+*/
+void reportPacing(HouseType* house, uint32_t run, int print) {
+    PacerType total = house->ghost->pacer;
+
+    if (house->pacing != PC_ABSOLUTE) {
+        return;
+    }
+    if (print) {
+        printPacer("Ghost", &(house->ghost->pacer));
+    }
+    for (int i = 0; i < house->hunters.size; i++) {
+        PacerType* pacer = &(house->hunters.elements[i]->pacer);
+        if (print) {
+            printPacer(nameOf(house->hunters.elements[i]->name), pacer);
+        }
+        total.ticks += pacer->ticks;
+        total.overruns += pacer->overruns;
+        total.skipped += pacer->skipped;
+    }
+    if (!print && total.overruns > 0) {
+        printf("[PACING] run %u: %llu of %llu turns overran their deadline, %llu deadlines skipped\n", run,
+            (unsigned long long) total.overruns, (unsigned long long) total.ticks, (unsigned long long) total.skipped);
+    }
+}
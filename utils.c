@@ -1,18 +1,21 @@
 #include "defs.h"
 
 /*
-    Returns a pseudo randomly generated number, in the range min to (max - 1), inclusively
+    Returns a pseudo randomly generated number, in the range min to (max - 1), inclusively.
+    The float in between can round up to 'max' itself, which is pulled back into the range
 */
 int randInt(int min, int max) {
-    return (int) randFloat(min, max);
+    int value = (int) randFloat(min, max);
+    return (value >= max && max > min) ? max - 1 : value;
 }
 
 /*
     Returns a pseudo randomly generated floating point number.
     A few tricks to make this thread safe, just to reduce any chance of issues using random
 */
+static __thread unsigned int seed = 0;
+
 float randFloat(float min, float max) {
-    static __thread unsigned int seed = 0;
     if (seed == 0) {
         seed = (unsigned int)time(NULL) ^ (unsigned int)pthread_self();
     }
@@ -23,6 +26,25 @@ float randFloat(float min, float max) {
     return min + r;
 }
 
+/*
+    Seeds the calling thread's random stream, a seed of 0 falls back to a time based seed.
+*/
+void seedRandom(unsigned int value) {
+    seed = value;
+}
+
+/*
+    Derives a well mixed seed for stream 'stream' of a run seeded with 'runSeed' (splitmix64),
+    never returns 0 so the stream is never reseeded from the clock
+*/
+unsigned int mixSeed(uint64_t runSeed, unsigned int stream) {
+    uint64_t z = runSeed + 0x9E3779B97F4A7C15ULL * (stream + 1);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z = z ^ (z >> 31);
+    return ((unsigned int) z) | 1;
+}
+
 /*
     Returns the enum EvidenceType representation of the given string.
 */
@@ -110,7 +132,7 @@ void printHunters(HouseType* house) {
     // Loop though each hunter and print
     printf("Hunters:\n");
     for (int i = 0; i < house->hunters.size; i++) {
-        printf("    * %s has fear %d and boredom %d\n", house->hunters.elements[i]->name, house->hunters.elements[i]->fear, house->hunters.elements[i]->boredom);
+        printf("    * %s has fear %d and boredom %d\n", nameOf(house->hunters.elements[i]->name), house->hunters.elements[i]->fear, house->hunters.elements[i]->boredom);
     }
     printf("----------------------------------------\n");
 }
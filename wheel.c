@@ -0,0 +1,107 @@
+#include "defs.h"
+
+/*
+    Evidence expiry runs on a hierarchical timing wheel ticked once per ghost turn. Level 0 has
+    one slot per tick, and each level above has slots WHEEL_SLOTS times as wide. Evidence is
+    filed in the lowest level whose span covers its remaining time. When a slot of a higher
+    level comes due, its evidence is filed again into the levels below. A tick therefore only
+    touches the evidence that is due, plus each piece of evidence at most once per level.
+
+    Only the ghost thread schedules evidence and advances the wheel, so the wheel has no lock.
+    Hunters never touch it: evidence they collect stays filed and is freed when it comes due.
+*/
+
+#define WHEEL_MASK      (WHEEL_SLOTS - 1)
+#define WHEEL_HORIZON   (1U << (WHEEL_BITS * WHEEL_LEVELS))
+
+/*
+    Files the evidence 'node' in the slot of the wheel covering its expiry tick.
+*/
+static void fileEvidence(TimingWheel* wheel, EvidenceNode* node) {
+    uint32_t remaining = node->expires - wheel->now;
+    int level = 0;
+    int slot;
+
+    while (level < WHEEL_LEVELS - 1 && remaining >= (1U << (WHEEL_BITS * (level + 1)))) {
+        level++;
+    }
+    slot = (node->expires >> (WHEEL_BITS * level)) & WHEEL_MASK;
+    node->wheelNext = wheel->slots[level][slot];
+    wheel->slots[level][slot] = node;
+}
+
+/*  Function: void initWheel(TimingWheel* wheel)
+    Purpose: Initializes the timing wheel at the pointer 'wheel' empty, at tick 0
+*/
+void initWheel(TimingWheel* wheel) {
+    memset(wheel, 0, sizeof(TimingWheel));
+}
+
+/*  Function: void scheduleEvidence(TimingWheel* wheel, EvidenceNode* node, uint32_t ticks)
+    Purpose: Schedules the evidence 'node' to expire 'ticks' ticks from now, the wheel frees it
+        when it comes due
+*/
+void scheduleEvidence(TimingWheel* wheel, EvidenceNode* node, uint32_t ticks) {
+    if (ticks >= WHEEL_HORIZON) {
+        ticks = WHEEL_HORIZON - 1;
+    }
+    node->expires = wheel->now + ticks;
+    fileEvidence(wheel, node);
+    wheel->pending++;
+}
+
+/*  Function: EvidenceNode* advanceWheel(TimingWheel* wheel)
+    Purpose: Advances the timing wheel at the pointer 'wheel' by one tick, returns the evidence
+        due at the new tick chained through 'wheelNext', or NULL if none is
+*/
+EvidenceNode* advanceWheel(TimingWheel* wheel) {
+    EvidenceNode* due;
+
+    wheel->now++;
+
+    // Once the levels below wrap around, the next slot of a level comes due and is filed lower
+    for (int level = 1; level < WHEEL_LEVELS; level++) {
+        if ((wheel->now & ((1U << (WHEEL_BITS * level)) - 1)) != 0) {
+            break;
+        }
+        int slot = (wheel->now >> (WHEEL_BITS * level)) & WHEEL_MASK;
+        EvidenceNode* current = wheel->slots[level][slot];
+        wheel->slots[level][slot] = NULL;
+        while (current != NULL) {
+            EvidenceNode* next = current->wheelNext;
+            fileEvidence(wheel, current);
+            current = next;
+        }
+    }
+
+    // Everything in the level 0 slot of this tick expires now
+    due = wheel->slots[0][wheel->now & WHEEL_MASK];
+    wheel->slots[0][wheel->now & WHEEL_MASK] = NULL;
+    for (EvidenceNode* current = due; current != NULL; current = current->wheelNext) {
+        wheel->pending--;
+    }
+    return due;
+}
+
+/*  Function: void cleanWheel(TimingWheel* wheel)
+    Purpose: Frees the scheduled evidence at the wheel 'wheel' that was already collected or
+        dropped from its room, evidence still in a room is freed with the room's list
+*/
+void cleanWheel(TimingWheel* wheel) {
+    for (int level = 0; level < WHEEL_LEVELS; level++) {
+        for (int slot = 0; slot < WHEEL_SLOTS; slot++) {
+            EvidenceNode* current = wheel->slots[level][slot];
+            while (current != NULL) {
+                EvidenceNode* next = current->wheelNext;
+                if (current->collected) {
+                    trackedFree(MEM_EVIDENCE, current, sizeof(EvidenceNode));
+                } else {
+                    current->timed = C_FALSE;   // the room's list owns it again
+                }
+                current = next;
+            }
+            wheel->slots[level][slot] = NULL;
+        }
+    }
+    wheel->pending = 0;
+}